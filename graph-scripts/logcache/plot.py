@@ -1,5 +1,6 @@
 from utils import to_json_list, to_result_list
 from utils import parse_file_name
+from stats_reader import read_stats
 import glob
 import os 
 import sys
@@ -49,19 +50,20 @@ if __name__ == '__main__':
     traceClassName = os.path.basename(os.path.dirname(os.path.dirname(outfiles_pattern)))
     # print(traceClassName)
     
-    file_list=glob.glob(outfiles_pattern)
+    # stats.format为csv/bin时输出文件的后缀为.csv/.bin
+    file_list=[]
+    for ext in ['out', 'csv', 'bin']:
+        file_list+=glob.glob(args.outfiles_path+'/*.'+ext)
     for file in file_list:
         # print(file)
         print(os.path.basename(file))
         config=parse_file_name(os.path.basename(file))
         # print(config)
-        with open(file, 'r') as f:
-            content = f.read()
-            json_list=to_json_list(content)
-            request_count_list, miss_ratio_list, write_amp_list, capacity_util_list = to_result_list(json_list)
-            print(len(request_count_list),len(miss_ratio_list),len(write_amp_list),len(capacity_util_list))
-            print('\n')
-            result_list.append((config, miss_ratio_list, write_amp_list, capacity_util_list))
+        json_list=read_stats(file)
+        request_count_list, miss_ratio_list, write_amp_list, capacity_util_list = to_result_list(json_list)
+        print(len(request_count_list),len(miss_ratio_list),len(write_amp_list),len(capacity_util_list))
+        print('\n')
+        result_list.append((config, miss_ratio_list, write_amp_list, capacity_util_list))
 
     miss_ratio_lines=[]
     write_amp_lines=[]
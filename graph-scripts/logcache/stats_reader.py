@@ -0,0 +1,93 @@
+import struct
+
+from utils import to_json_list
+
+'''
+读取模拟器的统计输出（stats.outputFile），按stats.format分为三种：
+
+json: 每次输出一个缩进的JSON对象（默认格式）
+csv:  表头行为各计数器的路径（如 global/totalAccesses、log/children/<name>/<counter>），
+      之后每行一次快照；出现新的计数器时会再写一行表头
+bin:  8字节文件头 LSCSTAT1，之后是一系列记录：
+      'H' + uint32 列数 + 每列(uint16 名字长度 + 名字)   表头
+      'R' + uint32 列数 + 每列int64                     一次快照
+
+read_stats把三种格式都还原成与json格式相同的嵌套字典列表，可以直接交给utils.to_result_list；
+某次快照中还不存在的计数器不会出现在字典中，与json格式一致。
+'''
+
+BINARY_MAGIC = b'LSCSTAT1'
+
+
+def _to_entry(names, values):
+    entry = {}
+    for name, value in zip(names, values):
+        node = entry
+        parts = name.split('/')
+        for part in parts[:-1]:
+            node = node.setdefault(part, {})
+        node[parts[-1]] = value
+    return entry
+
+
+def _read_csv(f):
+    entries = []
+    names = None
+    for line in f:
+        line = line.rstrip('\n')
+        if not line:
+            continue
+        fields = line.split(',')
+        # 计数器路径不会是数字，据此区分表头和数据行
+        try:
+            values = [int(x) for x in fields]
+        except ValueError:
+            names = fields
+            continue
+        entries.append(_to_entry(names, values))
+    return entries
+
+
+def _read_binary(f):
+    if f.read(len(BINARY_MAGIC)) != BINARY_MAGIC:
+        raise ValueError('not a binary stats file')
+    entries = []
+    names = None
+    while True:
+        tag = f.read(1)
+        if not tag:
+            break
+        (n,) = struct.unpack('<I', f.read(4))
+        if tag == b'H':
+            names = []
+            for _ in range(n):
+                (length,) = struct.unpack('<H', f.read(2))
+                names.append(f.read(length).decode())
+        elif tag == b'R':
+            values = struct.unpack(f'<{n}q', f.read(8 * n))
+            entries.append(_to_entry(names, values))
+        else:
+            raise ValueError(f'bad record tag {tag!r}')
+    return entries
+
+
+def read_stats(path):
+    with open(path, 'rb') as f:
+        magic = f.read(len(BINARY_MAGIC))
+    if magic == BINARY_MAGIC:
+        with open(path, 'rb') as f:
+            return _read_binary(f)
+    with open(path, 'r') as f:
+        first = f.read(1)
+        f.seek(0)
+        if first == '{':
+            return to_json_list(f.read())
+        return _read_csv(f)
+
+
+if __name__ == '__main__':
+    import sys
+    entries = read_stats(sys.argv[1])
+    print(f'Found {len(entries)} entries')
+    if entries:
+        print(entries[-1])
@@ -80,27 +80,91 @@ def zipf(exp, alphas):
         exp2.name += f'-zipf{alpha}'
         exp2.cfg['trace.totalKAccesses'] = 10000
         exp2.cfg['trace.alpha'] = alpha
-        exp2.cfg['trace.numObjects'] = 1000
+        exp2.cfg['trace.numKObjects'] = 1000
         exp2.cfg['trace.format'] = 'Zipf'
         out.append(exp2)
     return out
 
-def churn(exp):
-    exp.name += '-churn'
+# 合成负载的公共参数，与Zipf负载相同
+def synthetic(exp, fmt):
+    exp.name += f'-{fmt}'
     exp.cfg['trace.totalKAccesses'] = 10000
     exp.cfg['trace.alpha'] = 0.8
-    exp.cfg['trace.numObjects'] = 1000
-    exp.cfg['trace.numActiveObjects'] = 10
-    exp.cfg['trace.format'] = 'Churn'
-     
+    exp.cfg['trace.numKObjects'] = 1000
+    exp.cfg['trace.format'] = fmt
+    return exp
+
+# 流行度漂移：每个请求以churn的概率用一个新对象替换活跃集合中的一个对象
+def churn(exp, probs=[ 0., 0.01, 0.05, 0.1 ]):
+    synthetic(exp, 'Churn')
+    exp.cfg['trace.numKObjects'] = 10
+
     out = []
-    for prob in [ 0., 0.01, 0.05, 0.1 ]:
+    for prob in probs:
         exp2 = exp.clone()
         exp2.name += f'{prob:.2}'
         exp2.cfg['trace.churn'] = prob
         out.append(exp2)
     return out
 
+# 周期性的顺序扫描，scan_lengths为每次扫描的LBA数/K个
+def scan(exp, scan_lengths, period_k=1000):
+    synthetic(exp, 'Scan')
+
+    out = []
+    for length in scan_lengths:
+        exp2 = exp.clone()
+        exp2.name += f'{length}K'
+        exp2.cfg['trace.scanPeriodK'] = period_k
+        exp2.cfg['trace.scanLengthK'] = int(length)
+        out.append(exp2)
+    return out
+
+# 周期性的均匀随机写风暴，storm_lengths为每次写风暴的请求数/K个
+def write_storm(exp, storm_lengths, period_k=1000):
+    synthetic(exp, 'WriteStorm')
+    exp.cfg['trace.writeRatio'] = 0.1
+
+    out = []
+    for length in storm_lengths:
+        exp2 = exp.clone()
+        exp2.name += f'{length}K'
+        exp2.cfg['trace.stormPeriodK'] = period_k
+        exp2.cfg['trace.stormLengthK'] = int(length)
+        exp2.cfg['trace.stormWriteRatio'] = 1.0
+        out.append(exp2)
+    return out
+
+# 读写比例交替变化的多个阶段，write_ratios为各阶段的写比例
+def phases(exp, write_ratios, phase_length_k=1000):
+    synthetic(exp, 'Phases')
+    exp.cfg['trace.phaseLengthK'] = phase_length_k
+    exp.cfg['trace.phaseWriteRatios'] = ','.join(str(r) for r in write_ratios)
+    return [exp]
+
+# 工作集随时间线性增长，growths为最终对象数相对初始对象数的倍数
+def growing_wss(exp, growths, newest_hot=False):
+    synthetic(exp, 'GrowingWSS')
+    exp.cfg['trace.newestHot'] = newest_hot
+
+    out = []
+    for growth in growths:
+        exp2 = exp.clone()
+        exp2.name += f'{growth}x'
+        exp2.cfg['trace.finalKObjects'] = int(exp2.cfg['trace.numKObjects'] * growth)
+        out.append(exp2)
+    return out
+
+# 标准合成压力测试集：每种合成负载各取一组有代表性的参数
+def synthetic_suite(exp):
+    out = []
+    out.extend(churn(exp.clone(), [ 0.01 ]))
+    out.extend(scan(exp.clone(), [ 100 ]))
+    out.extend(write_storm(exp.clone(), [ 100 ]))
+    out.extend(phases(exp.clone(), [ 0.05, 0.5, 0.95 ]))
+    out.extend(growing_wss(exp.clone(), [ 10 ]))
+    return out
+
 def random_admission_pre_log(exp, ratios):
     if 'log' not in exp.cfg:
         return []
@@ -306,10 +370,14 @@ def fb_tao_simple(exp, scaling):
         out.append(exp2)
     return out
 
-def stat_outfile(exp, dirpath, stats_interval=None):
-    exp.cfg['stats.outputFile'] = f'{dirpath}/output/{exp.name}.out'
+def stat_outfile(exp, dirpath, stats_interval=None, stats_format=None):
+    # csv/bin格式由后台线程写出，适合很小的统计间隔
+    ext = 'out' if stats_format in (None, 'json') else stats_format
+    exp.cfg['stats.outputFile'] = f'{dirpath}/output/{exp.name}.{ext}'
     if stats_interval:
         exp.cfg['stats.collectionIntervalPower'] = stats_interval
+    if stats_format:
+        exp.cfg['stats.format'] = stats_format
     return [exp]
 
 def generate_base_exps(args):
@@ -384,6 +452,19 @@ def add_traces(exps, trace_args):
     if 'zipf' in trace_args:# 将zipf负载配置添加到现有配置，组成新的配置，并把新配置添加到新配置列表末尾
         new_exps.extend(expand(exps, zipf, trace_args['zipf']))
 
+    if 'churn' in trace_args:
+        new_exps.extend(expand(exps, churn, trace_args['churn']))
+    if 'scan' in trace_args:
+        new_exps.extend(expand(exps, scan, trace_args['scan']))
+    if 'write_storm' in trace_args:
+        new_exps.extend(expand(exps, write_storm, trace_args['write_storm']))
+    if 'phases' in trace_args:
+        new_exps.extend(expand(exps, phases, trace_args['phases']))
+    if 'growing_wss' in trace_args:
+        new_exps.extend(expand(exps, growing_wss, trace_args['growing_wss']))
+    if 'synthetic_suite' in trace_args:
+        new_exps.extend(expand(exps, synthetic_suite))
+
     if 'scaling' not in trace_args:
         trace_args['scaling'] = [1]
 
@@ -503,6 +584,9 @@ def arg_parser():
     # 统计信息的输出间隔，使用--stats-interval来指定
     parser.add_argument('--stats-interval', help='10**(STATS_INTERVAL)', type=int)
 
+    # 统计信息的输出格式，使用--stats-format来指定
+    parser.add_argument('--stats-format', choices=['json', 'csv', 'bin'], help='defaults to json')
+
     # 负载类型
     traces = parser.add_argument_group('trace types (at least one required)')
     # facebook tao负载
@@ -510,6 +594,19 @@ def arg_parser():
     # zipf负载，之后可以指定多个alpha值，默认为0.8
     traces.add_argument('--zipf', dest='traces', action=LayeredAction, 
             const='zipf', default=[0.8], nargs='*', type=float, metavar='alpha', help='defaults to .8')
+    # 合成压力负载，参数见对应的配置生成函数
+    traces.add_argument('--churn', dest='traces', action=LayeredAction,
+            const='churn', default=[0., 0.01, 0.05, 0.1], nargs='*', type=float, metavar='prob')
+    traces.add_argument('--scan', dest='traces', action=LayeredAction,
+            const='scan', default=[100], nargs='*', type=int, metavar='scanLengthK', help='defaults to 100K LBAs')
+    traces.add_argument('--write-storm', dest='traces', action=LayeredAction,
+            const='write_storm', default=[100], nargs='*', type=int, metavar='stormLengthK', help='defaults to 100K requests')
+    traces.add_argument('--phases', dest='traces', action=LayeredAction,
+            const='phases', default=[0.05, 0.5, 0.95], nargs='*', type=float, metavar='writeRatio')
+    traces.add_argument('--growing-wss', dest='traces', action=LayeredAction,
+            const='growing_wss', default=[10], nargs='*', type=float, metavar='growth', help='defaults to 10x')
+    # 标准合成压力测试集，包含以上每种合成负载
+    traces.add_argument('--synthetic-suite', dest='traces', action=LayeredAction, const='synthetic_suite')
     # 限制最多读取多少个请求
     traces.add_argument('--limit-requests', dest='traces', action=LayeredAction, const='limit_requests', 
             nargs=1, metavar='numKRequests')
@@ -583,10 +680,7 @@ def main():
         dirname = '.'
     (Path(dirname)/'configs').mkdir(exist_ok=True, parents=True)
     (Path(dirname)/'output').mkdir(exist_ok=True)
-    if args.stats_interval:
-        exps = expand(exps, stat_outfile, dirname, args.stats_interval)
-    else: 
-        exps = expand(exps, stat_outfile, dirname)
+    exps = expand(exps, stat_outfile, dirname, args.stats_interval, args.stats_format)
 
     for exp in exps:
         print(f'{dirname}/configs/{exp.name}.cfg', '...')
@@ -3,6 +3,7 @@
 
 #include "admission/admission.hpp"
 #include "config_reader.hpp"
+#include "admission/learned_admission.hpp"
 #include "admission/random_admission.hpp"
 #include "admission/threshold.hpp"
 
@@ -31,6 +32,10 @@ namespace admission
         {
             return new Threshold(settings, sets, log, admission_stats);
         }
+        else if (policyType == "Learned") // 在线学习的准入，预测对象在flash中是否会被再次访问
+        {
+            return new LearnedAdmission(settings, sets, log, admission_stats);
+        }
         else
         {
             std::cerr << "Unknown admission policy: " << policyType << std::endl;
@@ -40,39 +45,53 @@ namespace admission
         return NULL;
     }
 
-    // 给定一批对象，将各个对象按其映射到的set分组，返回分组情况：<组号，组内对象列表>
-    std::unordered_map<uint64_t, std::vector<candidate_t>> Policy::groupBasic(std::vector<candidate_t> items)
+    // 给定一批对象，将各个对象按其映射到的set分组，返回按set号排序的分组：每段连续对象属于同一个set
+    flashCache::SetBatch Policy::groupBasic(const std::vector<candidate_t> &items)
     {
         assert(_sets); // give more helpful error than segfault
-        // 各个对象对应的不同set
-        std::unordered_map<uint64_t, std::vector<candidate_t>> grouped;
-        for (auto item : items) // 遍历对象
-        {
-            // 返回对象可以映射到的一组setNum，取第一个
-            uint64_t setNum = *(_sets->findSetNums(item).begin());
-            grouped[setNum].push_back(item);
-        }
-        return grouped;
+        return flashCache::groupBySet(_sets, items);
     }
 
-    void Policy::trackPossibleAdmits(std::vector<candidate_t> items)
+    void Policy::trackPossibleAdmits(const std::vector<candidate_t> &items)
+    {
+        trackPossibleAdmits(items.data(), items.data() + items.size());
+    }
+
+    void Policy::trackPossibleAdmits(const candidate_t *first, const candidate_t *last)
     { // 记录有多少对象执行了准入判断，用于计算准入比例
         _admission_stats["trackPossibleAdmitsCalls"]++;
-        for (auto item : items)
+        if (first == last)
+        {
+            return;
+        }
+        uint64_t size = 0;
+        for (auto it = first; it != last; ++it)
         {
-            _admission_stats["numPossibleAdmits"]++;
-            _admission_stats["sizePossibleAdmits"] += item.obj_size;
+            size += it->obj_size;
         }
+        _admission_stats["numPossibleAdmits"] += last - first;
+        _admission_stats["sizePossibleAdmits"] += size;
+    }
+
+    void Policy::trackAdmitted(const std::vector<candidate_t> &items)
+    {
+        trackAdmitted(items.data(), items.data() + items.size());
     }
 
-    void Policy::trackAdmitted(std::vector<candidate_t> items)
+    void Policy::trackAdmitted(const candidate_t *first, const candidate_t *last)
     { // 记录实际准入了多少对象
         _admission_stats["trackAdmittedCalls"]++;
-        for (auto item : items)
+        if (first == last)
+        {
+            return;
+        }
+        uint64_t size = 0;
+        for (auto it = first; it != last; ++it)
         {
-            _admission_stats["numAdmits"]++;
-            _admission_stats["sizeAdmits"] += item.obj_size;
+            size += it->obj_size;
         }
+        _admission_stats["numAdmits"] += last - first;
+        _admission_stats["sizeAdmits"] += size;
     }
 
     double Policy::byteRatioAdmitted()
@@ -16,9 +16,13 @@ namespace admission
         Policy(stats::LocalStatsCollector &admission_stats, flashCache::SetsAbstract *sets = nullptr,
                flashCache::LogAbstract *log = nullptr);
         virtual ~Policy() {}
-        virtual std::unordered_map<uint64_t, std::vector<candidate_t>> admit(std::vector<candidate_t> items) = 0;
+        /* admitted items grouped by set, runs in ascending set order */
+        virtual flashCache::SetBatch admit(std::vector<candidate_t> items) = 0;
         virtual std::vector<candidate_t> admit_simple(std::vector<candidate_t> items) = 0;
 
+        /* request stream hook for policies that learn online, no-op by default */
+        virtual void trackAccess(candidate_t item, parser::req_op_e op) {}
+
         /* the settings here is assumed to just be for the specific admission policy
          * since multiple admission policies are possible and the cache should decide how
          * to concatenate them */
@@ -33,11 +37,13 @@ namespace admission
 
         /* Very simple group, just takes first possible set for object,
          * works perfectly for one hash, TODO: implemeent something better for multihash */
-        std::unordered_map<uint64_t, std::vector<candidate_t>> groupBasic(std::vector<candidate_t> items);
+        flashCache::SetBatch groupBasic(const std::vector<candidate_t> &items);
 
         /* Useful stats tracking for derived classes */
-        void trackPossibleAdmits(std::vector<candidate_t> items);
-        void trackAdmitted(std::vector<candidate_t> items);
+        void trackPossibleAdmits(const std::vector<candidate_t> &items);
+        void trackPossibleAdmits(const candidate_t *first, const candidate_t *last);
+        void trackAdmitted(const std::vector<candidate_t> &items);
+        void trackAdmitted(const candidate_t *first, const candidate_t *last);
 
         /* not all policies (eg random) need these so they can be nullptrs all this level */
         flashCache::SetsAbstract *_sets;
@@ -0,0 +1,291 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <unordered_map>
+
+#include "admission/admission.hpp"
+#include "candidate.hpp"
+#include "common/logging.h"
+#include "config_reader.hpp"
+#include "stats/stats.hpp"
+
+namespace admission
+{
+
+    /* Flashield-style learned admission: an online logistic regression over
+     * cheap per-object features predicts whether an object will be accessed
+     * again before it would leave flash; only predicted-reused objects are
+     * written. Every admission decision becomes a training sample, labelled
+     * positive if the object is accessed again within labelHorizonK thousand
+     * accesses and negative otherwise, so rejected objects are labelled too.
+     * The model is retrained every retrainInterval labelled samples and admits
+     * everything until the first training round. Per-object features are kept
+     * for at most maxTrackedObjectsK thousand objects: each retraining drops
+     * the objects idle for longer than featureHorizonK thousand accesses, and
+     * a full table keeps only its most recently accessed 3/4. */
+    class LearnedAdmission : public virtual Policy
+    {
+    public:
+        LearnedAdmission(const libconfig::Setting &settings, flashCache::SetsAbstract *sets,
+                         flashCache::LogAbstract *log, stats::LocalStatsCollector &admission_stats) : Policy(admission_stats, sets, log)
+        {
+            misc::ConfigReader cfg(settings);
+            _admit_threshold = cfg.read<float>("admitThreshold", 0.5);              // 预测概率超过该值时准入
+            _learning_rate = cfg.read<float>("learningRate", 0.05);                 // SGD学习率
+            _train_epochs = cfg.read<int>("trainEpochs", 2);                        // 每次训练遍历样本窗口的轮数
+            _retrain_interval = (uint64_t)cfg.read<int>("retrainInterval", 100000); // 每累计多少个带标签样本重新训练一次
+            _label_horizon = (uint64_t)cfg.read<int>("labelHorizonK", 1000) * 1000; // 样本标签的观察窗口，单位为访问次数
+            _max_objects = (uint64_t)cfg.read<int>("maxTrackedObjectsK", 1000) * 1000;                 // 最多记录特征的对象数
+            _feature_horizon = (uint64_t)cfg.read<int>("featureHorizonK", 8 * _label_horizon / 1000) * 1000; // 超过该访问次数未被访问的对象在重新训练时丢弃
+            assert(_retrain_interval > 0 && _label_horizon > 0 && _max_objects > 0);
+            for (int i = 0; i < NUM_FEATURES; i++)
+            {
+                _weights[i] = 0;
+            }
+            _samples.reserve(_retrain_interval);
+        }
+
+        flashCache::SetBatch admit(std::vector<candidate_t> items)
+        {
+            flashCache::SetBatch ret = groupBasic(items);
+            std::vector<candidate_t> evicted;
+            for (auto &run : ret.runs)
+            {
+                trackPossibleAdmits(ret.begin(run), ret.end(run));
+            }
+            ret.filter([this](const flashCache::SetBatch::Run &, const candidate_t &item)
+                       { return _decide(item); },
+                       evicted);
+            for (auto &run : ret.runs)
+            {
+                trackAdmitted(ret.begin(run), ret.end(run));
+            }
+            performReadmission(evicted);
+            return ret;
+        }
+
+        std::vector<candidate_t> admit_simple(std::vector<candidate_t> items)
+        {
+            std::vector<candidate_t> admitted;
+            admitted.reserve(items.size());
+            trackPossibleAdmits(items);
+            for (auto item : items)
+            {
+                if (_decide(item))
+                {
+                    admitted.push_back(item);
+                }
+            }
+            trackAdmitted(admitted);
+            return admitted;
+        }
+
+        void trackAccess(candidate_t item, parser::req_op_e op)
+        {
+            _vtime++;
+            _expireSamples();
+
+            // 在观察窗口内被再次访问，标记为正样本
+            auto pending = _pending.find(item.id);
+            if (pending != _pending.end())
+            {
+                _label(pending->second, true);
+                _pending.erase(pending);
+            }
+
+            if (_objects.size() >= _max_objects && _objects.find(item.id) == _objects.end())
+            {
+                _trimObjects(_max_objects * 3 / 4);
+            }
+            auto &obj = _objects[item.id];
+            obj.reuse_time = obj.access_count ? _vtime - obj.last_access : 0;
+            obj.last_access = _vtime;
+            obj.access_count++;
+            obj.is_write = (op == parser::OP_SET);
+        }
+
+    private:
+        static const int NUM_FEATURES = 6;
+
+        struct ObjFeatures
+        {
+            uint64_t last_access = 0;
+            uint64_t reuse_time = 0;
+            uint32_t access_count = 0;
+            bool is_write = false;
+        };
+
+        struct Sample
+        {
+            float x[NUM_FEATURES];
+            uint64_t decided_at;
+            bool predicted;
+            bool by_model; // 是否由训练后的模型做出判断，只统计这部分的准确率
+            bool label;
+        };
+
+        /* features: bias, log access count, log reuse time, log time since
+         * last access, log size, write flag; logs are scaled to ~[0, 1] */
+        void _extract(const candidate_t &item, float *x)
+        {
+            ObjFeatures feat;
+            auto it = _objects.find(item.id);
+            if (it != _objects.end())
+            {
+                feat = it->second;
+            }
+            x[0] = 1;
+            x[1] = std::log2(1. + feat.access_count) / 32;
+            x[2] = std::log2(1. + feat.reuse_time) / 64;
+            x[3] = std::log2(1. + (feat.access_count ? _vtime - feat.last_access : _vtime)) / 64;
+            x[4] = std::log2(1. + item.obj_size) / 32;
+            x[5] = feat.is_write ? 1 : 0;
+        }
+
+        double _predict(const float *x)
+        {
+            double z = 0;
+            for (int i = 0; i < NUM_FEATURES; i++)
+            {
+                z += _weights[i] * x[i];
+            }
+            return 1. / (1. + std::exp(-z));
+        }
+
+        bool _decide(const candidate_t &item)
+        {
+            Sample sample;
+            _extract(item, sample.x);
+            sample.decided_at = _vtime;
+            sample.by_model = _trained;
+            sample.predicted = !_trained || _predict(sample.x) >= _admit_threshold;
+            if (!sample.predicted)
+            {
+                _admission_stats["flashBytesSaved"] += item.obj_size; // 拒绝写入flash的字节数
+            }
+
+            // 同一对象有未完成的样本时覆盖旧样本
+            _pending[item.id] = sample;
+            _pending_order.push_back({item.id, _vtime});
+            return sample.predicted;
+        }
+
+        // 超过观察窗口仍未被访问的样本，标记为负样本
+        void _expireSamples()
+        {
+            while (!_pending_order.empty() && _pending_order.front().second + _label_horizon < _vtime)
+            {
+                auto expired = _pending_order.front();
+                _pending_order.pop_front();
+                auto it = _pending.find(expired.first);
+                if (it != _pending.end() && it->second.decided_at == expired.second)
+                {
+                    _label(it->second, false);
+                    _pending.erase(it);
+                }
+            }
+        }
+
+        void _label(Sample &sample, bool label)
+        {
+            sample.label = label;
+            if (sample.by_model)
+            {
+                if (sample.predicted)
+                {
+                    _admission_stats[label ? "truePositives" : "falsePositives"]++;
+                }
+                else
+                {
+                    _admission_stats[label ? "falseNegatives" : "trueNegatives"]++;
+                }
+            }
+            _samples.push_back(sample);
+            if (_samples.size() >= _retrain_interval)
+            {
+                _train();
+            }
+        }
+
+        // 只保留最近访问的keep个对象的特征
+        void _trimObjects(uint64_t keep)
+        {
+            std::vector<uint64_t> last_access;
+            last_access.reserve(_objects.size());
+            for (auto &obj : _objects)
+            {
+                last_access.push_back(obj.second.last_access);
+            }
+            auto nth = last_access.end() - keep;
+            std::nth_element(last_access.begin(), nth, last_access.end());
+            _dropObjectsBefore(*nth);
+        }
+
+        void _dropObjectsBefore(uint64_t vtime)
+        {
+            for (auto it = _objects.begin(); it != _objects.end();)
+            {
+                if (it->second.last_access < vtime)
+                {
+                    it = _objects.erase(it);
+                }
+                else
+                {
+                    ++it;
+                }
+            }
+            _admission_stats["trackedObjects"] = _objects.size();
+        }
+
+        // 在最近一个样本窗口上做若干轮SGD，然后丢弃该窗口
+        void _train()
+        {
+            // 长时间未被访问的对象不再记录特征
+            if (_vtime > _feature_horizon)
+            {
+                _dropObjectsBefore(_vtime - _feature_horizon);
+            }
+
+            for (int epoch = 0; epoch < _train_epochs; epoch++)
+            {
+                for (auto &sample : _samples)
+                {
+                    double err = (sample.label ? 1. : 0.) - _predict(sample.x);
+                    for (int i = 0; i < NUM_FEATURES; i++)
+                    {
+                        _weights[i] += _learning_rate * err * sample.x[i];
+                    }
+                }
+            }
+            _samples.clear();
+            _trained = true;
+            _admission_stats["numRetrains"]++;
+
+            double tp = _admission_stats["truePositives"];
+            double fp = _admission_stats["falsePositives"];
+            double fn = _admission_stats["falseNegatives"];
+            INFO("learned admission retrained, precision %lf, recall %lf, flash bytes saved %ld\n",
+                 tp + fp > 0 ? tp / (tp + fp) : 0., tp + fn > 0 ? tp / (tp + fn) : 0.,
+                 (long)_admission_stats["flashBytesSaved"]);
+        }
+
+        float _admit_threshold;
+        float _learning_rate;
+        int _train_epochs;
+        uint64_t _retrain_interval;
+        uint64_t _label_horizon;
+        uint64_t _max_objects;
+        uint64_t _feature_horizon;
+
+        double _weights[NUM_FEATURES];
+        bool _trained = false;
+        uint64_t _vtime = 0;
+
+        std::unordered_map<uint64_t, ObjFeatures> _objects;
+        std::unordered_map<uint64_t, Sample> _pending;
+        std::deque<std::pair<uint64_t, uint64_t>> _pending_order; // <对象id，做出判断的时间>
+        std::vector<Sample> _samples;
+    };
+
+} // admission namespace
@@ -23,30 +23,22 @@ namespace admission
         }
 
         // 先把对象按照映射到的set分组，然后执行准入，未准入的对象将被刷新到set映射flash缓存？，或者直接丢弃
-        std::unordered_map<uint64_t, std::vector<candidate_t>> admit(std::vector<candidate_t> items)
+        flashCache::SetBatch admit(std::vector<candidate_t> items)
         {
-            // 获取分组情况
-            std::unordered_map<uint64_t, std::vector<candidate_t>> ret = groupBasic(items);
-            // 按比例分配驱逐对象数组
-            std::vector<candidate_t> evicted(int(_admit_ratio * items.size()) + 1);
-            // 遍历当前这些对象映射到的各个set
-            for (auto &bin : ret)
+            // 获取分组情况，同一set的对象在批中连续存放
+            flashCache::SetBatch ret = groupBasic(items);
+            std::vector<candidate_t> evicted;
+            for (auto &run : ret.runs)
             {
-                trackPossibleAdmits(bin.second);
-                // 每个set中分别包括哪些对象
-                for (auto it = bin.second.begin(); it != bin.second.end();)
-                {
-                    if (_rand_gen.next() > _admit_threshold) // 若生成的随机数超过了准入阈值
-                    {
-                        evicted.push_back(*it);
-                        it = bin.second.erase(it);
-                    }
-                    else
-                    {
-                        ++it;
-                    }
-                }
-                trackAdmitted(bin.second);
+                trackPossibleAdmits(ret.begin(run), ret.end(run));
+            }
+            // 生成的随机数超过准入阈值的对象不被准入
+            ret.filter([this](const flashCache::SetBatch::Run &, const candidate_t &)
+                       { return _rand_gen.next() <= _admit_threshold; },
+                       evicted);
+            for (auto &run : ret.runs)
+            {
+                trackAdmitted(ret.begin(run), ret.end(run));
             }
             performReadmission(evicted);
             return ret; // 过滤掉未准入对象后剩下的对象
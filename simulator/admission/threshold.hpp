@@ -20,25 +20,21 @@ namespace admission
             _admission_stats["thresholdValue"] = threshold;
         }
 
-        std::unordered_map<uint64_t, std::vector<candidate_t>> admit(std::vector<candidate_t> items)
+        flashCache::SetBatch admit(std::vector<candidate_t> items)
         {
-            std::unordered_map<uint64_t, std::vector<candidate_t>> ret = groupBasic(items);
+            flashCache::SetBatch ret = groupBasic(items);
             std::vector<candidate_t> evicted;
-            // 遍历当前这些对象映射到的各个set
-            for (auto it = ret.begin(); it != ret.end();)
+            for (auto &run : ret.runs)
             {
-                trackPossibleAdmits(it->second);
-                // 包含对象数量小于阈值的set不被准入
-                if (it->second.size() < (uint)threshold)
-                {
-                    evicted.insert(evicted.end(), it->second.begin(), it->second.end());
-                    it = ret.erase(it);
-                }
-                else
-                {
-                    trackAdmitted(it->second);
-                    ++it;
-                }
+                trackPossibleAdmits(ret.begin(run), ret.end(run));
+            }
+            // 包含对象数量小于阈值的set不被准入
+            ret.filter([this](const flashCache::SetBatch::Run &run, const candidate_t &)
+                       { return run.size() >= (uint)threshold; },
+                       evicted);
+            for (auto &run : ret.runs)
+            {
+                trackAdmitted(ret.begin(run), ret.end(run));
             }
             performReadmission(evicted);
             return ret;
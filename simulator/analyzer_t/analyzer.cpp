@@ -3,13 +3,25 @@
 //
 
 #include <algorithm>  // std::make_heap, std::pop_heap, std::push_heap, std::sort_heap
+#include <queue>   // std::priority_queue
 #include <vector>  // std::vector
 
 #include "analyzer.h"
+#include "common/mem_usage.hpp"
 
 // 初始化
 void traceAnalyzer::TraceAnalyzer::initialize() {
-    obj_map_.reserve(DEFAULT_PREALLOC_N_OBJ);  // 预分配空间
+    // 预分配空间，由各个分片平分；溢出模式下每个元数据表只保存一个分区的对象
+    obj_maps_.resize(n_shards_);
+    shard_sum_obj_size_.assign(n_shards_, 0);
+    shard_obj_stats_.assign(n_shards_, obj_stat());
+    uint64_t prealloc_n_obj = DEFAULT_PREALLOC_N_OBJ / n_shards_;
+    if (!spill_dir_.empty()) {
+        prealloc_n_obj = DEFAULT_PREALLOC_N_OBJ / n_spill_partitions_;
+    }
+    for (auto& obj_map : obj_maps_) {
+        obj_map.reserve(prealloc_n_obj);
+    }
 
     // 对操作类型信息进行统计
     op_stat_ = new OpStat();
@@ -70,6 +82,12 @@ void traceAnalyzer::TraceAnalyzer::initialize() {
         lifespan_stat_ = new LifespanDistribution(output_path_, time_window_);
     }
 
+    // 是否用草图估计每个时间窗口和滑动窗口内的不重复对象数和字节数
+    if (option_.working_set) {
+        working_set_stat_ =
+            new WorkingSet(output_path_, time_window_, wss_sliding_windows_);
+    }
+
     // scan_detector_ = new ScanDetector(reader_, output_path, 100);
 }
 
@@ -89,6 +107,7 @@ void traceAnalyzer::TraceAnalyzer::cleanup() {
     delete create_future_reuse_;
     delete size_change_distribution_;
     delete lifespan_stat_;
+    delete working_set_stat_;
 
     // delete write_reuse_stat_;
     // delete write_future_reuse_stat_;
@@ -117,7 +136,90 @@ void traceAnalyzer::TraceAnalyzer::run() {
     int32_t curr_time_window_idx = 0;
     int next_time_window_ts = time_window_;
 
-    int64_t n = 0;
+    // 各个统计模块的add_req，按原来的调用顺序
+    modules_.clear();
+    modules_.push_back([this](parser::Request* r) { op_stat_->add_req(r); });
+    if (ttl_stat_ != nullptr)
+        modules_.push_back([this](parser::Request* r) { ttl_stat_->add_req(r); });
+    if (req_rate_stat_ != nullptr)
+        modules_.push_back([this](parser::Request* r) { req_rate_stat_->add_req(r); });
+    if (size_stat_ != nullptr)
+        modules_.push_back([this](parser::Request* r) { size_stat_->add_req(r); });
+    if (reuse_stat_ != nullptr)
+        modules_.push_back([this](parser::Request* r) { reuse_stat_->add_req(r); });
+    if (access_stat_ != nullptr)
+        modules_.push_back([this](parser::Request* r) { access_stat_->add_req(r); });
+    if (popularity_decay_stat_ != nullptr)
+        modules_.push_back([this](parser::Request* r) { popularity_decay_stat_->add_req(r); });
+    if (prob_at_age_ != nullptr)
+        modules_.push_back([this](parser::Request* r) { prob_at_age_->add_req(r); });
+    if (lifetime_stat_ != nullptr)
+        modules_.push_back([this](parser::Request* r) { lifetime_stat_->add_req(r); });
+    if (create_future_reuse_ != nullptr)
+        modules_.push_back([this](parser::Request* r) { create_future_reuse_->add_req(r); });
+    if (size_change_distribution_ != nullptr)
+        modules_.push_back([this](parser::Request* r) { size_change_distribution_->add_req(r); });
+    if (scan_detector_ != nullptr)
+        modules_.push_back([this](parser::Request* r) { scan_detector_->add_req(r); });
+    if (lifespan_stat_ != nullptr)
+        modules_.push_back([this](parser::Request* r) { lifespan_stat_->add_req(r); });
+    if (working_set_stat_ != nullptr)
+        modules_.push_back([this](parser::Request* r) { working_set_stat_->add_req(r); });
+
+    /* the main thread reads and annotates requests (obj_maps_ are only
+     * touched there, or by the shard threads) and broadcasts copies to one
+     * worker thread per module; the parser keeps state in req, so it is
+     * never handed out itself */
+    utils::BroadcastRing<parser::Request>* ring = nullptr;
+    std::vector<std::thread> workers;
+    auto start_modules = [&]() {
+        if (module_threads_ && modules_.size() > 1) {
+            ring = new utils::BroadcastRing<parser::Request>(ring_size_, modules_.size());
+            for (int i = 0; i < (int)modules_.size(); i++) {
+                workers.emplace_back([this, ring, i]() { ring->consume(i, modules_[i]); });
+            }
+            INFO("analyzing with %zu module threads\n", modules_.size());
+        }
+    };
+    // 将标注好的请求交给各个统计模块
+    auto feed_modules = [this, &ring](parser::Request* r) {
+        if (ring != nullptr) {
+            *ring->claim() = *r;
+            ring->publish();
+        } else {
+            for (auto& module : modules_) {
+                module(r);
+            }
+        }
+    };
+
+    /* with several shards, requests are annotated by the thread owning
+     * their object and come back in trace order, batch by batch, before
+     * they are fed to the modules */
+    utils::ShardPipeline<parser::Request>* shards = nullptr;
+
+    /* out of core, the requests only go to the partition files of their
+     * objects here; the modules start after the partitions are annotated */
+    std::vector<utils::SpillFile*> spill_files;
+    if (!spill_dir_.empty()) {
+        uint64_t buffer_bytes = utils::spillBufferBytes(n_spill_partitions_);
+        for (int p = 0; p < n_spill_partitions_; p++) {
+            spill_files.push_back(
+                new utils::SpillFile(spill_path("req", p), "wb", buffer_bytes));
+        }
+        INFO("spilling requests to %d partitions in %s\n", n_spill_partitions_,
+             spill_dir_.c_str());
+    } else {
+        start_modules();
+        if (n_shards_ > 1) {
+            shards = new utils::ShardPipeline<parser::Request>(
+                n_shards_, SHARD_BATCH_SIZE, SHARD_PIPELINE_DEPTH,
+                [this](int shard, parser::Request* r) { annotate_req(shard, r); },
+                feed_modules);
+            INFO("analyzing with %d object shards\n", n_shards_);
+        }
+    }
+
     /* going through the trace */
     do {
         DEBUG_ASSERT(req->req_size != 0);
@@ -152,159 +254,44 @@ void traceAnalyzer::TraceAnalyzer::run() {
 
         sum_obj_size_req += req->req_size;
 
-        auto it = obj_map_.find(req->id);
-        // 根据当前对象是否出现过，初始化一些请求和对象信息
-        if (it == obj_map_.end()) {
-            /* the first request to the object */
-
-            // 当前请求标记为强制不命中
-            req->compulsory_miss =
-                true; /* whether the object is seen for the first time */
-            // 新对象，非覆写
-            req->overwrite = false;
-            // 当前对象在当前时间窗口是第一次出现
-            req->first_seen_in_window = true;
-            // 当前请求的对象的创建时间为当前请求的时间戳
-            req->create_rtime = (int32_t)req->time;
-            req->create_vtime = (int32_t)req->req_num;
-
-            // 当前对象之前的大小
-            req->prev_size = -1;
-            // req->last_seen_window_idx = curr_time_window_idx;
-
-            // 当前对象的访问时间间隔(逻辑时间和实际时间)
-            req->vtime_since_last_access = -1;
-            req->rtime_since_last_access = -1;
-            req->vtime_since_last_update = -1;
-            req->rtime_since_last_update = -1;
-
-            struct obj_info obj_info;
-            // 对象的创建时间
-            obj_info.create_rtime = (int32_t)req->time;
-            obj_info.create_vtime = (int32_t)req->req_num;
-
-            // 对象的访问频次
-            obj_info.freq = 1;
-            // 对象的大小
-            obj_info.obj_size = (obj_size_t)req->req_size;
-            // 对象的最后访问时间(逻辑时间和实际时间)
-            obj_info.last_access_rtime = (int32_t)req->time;
-            obj_info.last_access_vtime = n_req_;
-
-            obj_info.last_update_rtime = (int32_t)req->time;
-            obj_info.last_update_vtime = (int32_t)req->req_num;
-
-            // 将对象信息加入到对象map中
-            obj_map_[req->id] = obj_info;
-            // 不重复对象的总大小，WSS
-            sum_obj_size_obj += req->req_size;
-        } else  // 当前对象出现过
-        {
-            // 非强制不命中
-            req->compulsory_miss = false;
-            // 当前对象在当前时间窗口是否第一次出现
-            req->first_seen_in_window =
-                (time_to_window_idx(it->second.last_access_rtime) !=
-                 curr_time_window_idx);
-            // 当前请求的对象的创建时间
-
-            req->create_rtime = it->second.create_rtime;
-            req->create_vtime = it->second.create_vtime;
-
-            // 计算当前请求的对象的更新时间间隔(逻辑时间和实际时间)
-            req->rtime_since_last_update =
-                (int64_t)req->time - it->second.last_update_rtime;
-            req->vtime_since_last_update =
-                (int64_t)req->req_num - it->second.last_update_vtime;
-
-            // 计算当前请求的对象的访问时间间隔(逻辑时间和实际时间)
-            req->vtime_since_last_access =
-                (int64_t)n_req_ - it->second.last_access_vtime;
-            req->rtime_since_last_access =
-                (int64_t)(req->time) - it->second.last_access_rtime;
-
-            // 若为写入，则是覆写请求
-            if (req->type == parser::OP_SET ||
-                req->type == parser::OP_REPLACE ||
-                req->type == parser::OP_CAS) {
-                req->overwrite = true;
-
-                it->second.last_update_rtime = (int32_t)req->time;
-                it->second.last_update_vtime = (int32_t)req->req_num;
-            } else  // 否则不是覆写请求
-            {
-                req->overwrite = false;
-            }
-
-            assert(req->vtime_since_last_access > 0);
-            assert(req->rtime_since_last_access >= 0);
-
-            // 对象之前的大小
-            req->prev_size = it->second.obj_size;
-            // 对象的当前的大小
-            it->second.obj_size = req->req_size;
-            // 对象的访问频次加1
-            it->second.freq += 1;
-            // 对象的最后访问时间(逻辑时间和实际时间)
-            it->second.last_access_vtime = n_req_;
-            it->second.last_access_rtime = (int32_t)(req->time);
-        }
-
-        // 将当前请求计入到各个统计中
-
-        op_stat_->add_req(req);
-
-        if (ttl_stat_ != nullptr) {
-            ttl_stat_->add_req(req);
-        }
-
-        if (req_rate_stat_ != nullptr) {
-            req_rate_stat_->add_req(req);
-        }
-
-        if (size_stat_ != nullptr) {
-            size_stat_->add_req(req);
-        }
-
-        if (reuse_stat_ != nullptr) {
-            reuse_stat_->add_req(req);
-        }
-
-        if (access_stat_ != nullptr) {
-            access_stat_->add_req(req);
-        }
-
-        if (popularity_decay_stat_ != nullptr) {
-            popularity_decay_stat_->add_req(req);
-        }
-
-        if (prob_at_age_ != nullptr) {
-            prob_at_age_->add_req(req);
-        }
-
-        if (lifetime_stat_ != nullptr) {
-            lifetime_stat_->add_req(req);
-        }
-
-        if (create_future_reuse_ != nullptr) {
-            create_future_reuse_->add_req(req);
-        }
-
-        if (size_change_distribution_ != nullptr) {
-            size_change_distribution_->add_req(req);
-        }
-        if (scan_detector_ != nullptr) {
-            scan_detector_->add_req(req);
-        }
-
-        if (lifespan_stat_ != nullptr) {
-            lifespan_stat_->add_req(req);
+        // 标注当前请求，并计入到各个统计中
+        if (!spill_files.empty()) {
+            utils::SpillReq r;
+            utils::toSpill(req, &r);
+            spill_files[spill_partition_of(req->id)]->write(r);
+        } else if (shards != nullptr) {
+            *shards->add(shard_of(req->id)) = *req;
+        } else {
+            annotate_req(0, req);
+            feed_modules(req);
         }
 
         // 读取下一个请求，直到读取到的请求无效，即读取到文件末尾
         parser_->read_one_req(req);
     } while (req->valid);
 
+    if (!spill_files.empty()) {
+        std::vector<std::string> partitions;
+        for (auto file : spill_files) {
+            partitions.push_back(file->path());
+            delete file;
+        }
+        annotate_spilled(partitions);
+        start_modules();
+        merge_spilled(partitions, feed_modules);
+    }
+    if (shards != nullptr) {
+        shards->finish();
+        delete shards;
+    }
+    if (ring != nullptr) {
+        ring->close();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        delete ring;
+    }
+
     // 结束时间戳赋值为最后一个请求的时间戳
     end_ts_ = req->time + start_ts_;
 
@@ -374,30 +361,233 @@ void traceAnalyzer::TraceAnalyzer::run() {
         lifespan_stat_->dump(output_path_);
     }
 
+    if (working_set_stat_ != nullptr) {
+        working_set_stat_->dump(output_path_);
+    }
+
     has_run_ = true;
 }
 
+// 根据对象元数据表标注请求（首次访问、覆写、距上次访问/更新的时间等），并更新元数据
+// 只访问请求所在分片的元数据，req->req_num为全局的请求序号
+void traceAnalyzer::TraceAnalyzer::annotate_req(int shard, parser::Request* req) {
+    obj_info_map_type& obj_map = obj_maps_[shard];
+    int32_t curr_time_window_idx = time_to_window_idx(req->time);
+    auto it = obj_map.find(req->id);
+    // 根据当前对象是否出现过，初始化一些请求和对象信息
+    if (it == obj_map.end()) {
+        /* the first request to the object */
+
+        // 当前请求标记为强制不命中
+        req->compulsory_miss =
+            true; /* whether the object is seen for the first time */
+        // 新对象，非覆写
+        req->overwrite = false;
+        // 当前对象在当前时间窗口是第一次出现
+        req->first_seen_in_window = true;
+        // 当前请求的对象的创建时间为当前请求的时间戳
+        req->create_rtime = (int32_t)req->time;
+        req->create_vtime = (int32_t)req->req_num;
+
+        // 当前对象之前的大小
+        req->prev_size = -1;
+        // req->last_seen_window_idx = curr_time_window_idx;
+
+        // 当前对象的访问时间间隔(逻辑时间和实际时间)
+        req->vtime_since_last_access = -1;
+        req->rtime_since_last_access = -1;
+        req->vtime_since_last_update = -1;
+        req->rtime_since_last_update = -1;
+
+        struct obj_info obj_info;
+        // 对象的创建时间
+        obj_info.create_rtime = (int32_t)req->time;
+        obj_info.create_vtime = (int32_t)req->req_num;
+
+        // 对象的访问频次
+        obj_info.freq = 1;
+        // 对象的大小
+        obj_info.obj_size = (obj_size_t)req->req_size;
+        // 对象的最后访问时间(逻辑时间和实际时间)
+        obj_info.last_access_rtime = (int32_t)req->time;
+        obj_info.last_access_vtime = req->req_num;
+
+        obj_info.last_update_rtime = (int32_t)req->time;
+        obj_info.last_update_vtime = (int32_t)req->req_num;
+
+        // 将对象信息加入到对象map中
+        obj_map[req->id] = obj_info;
+        // 不重复对象的总大小，WSS
+        shard_sum_obj_size_[shard] += req->req_size;
+    } else  // 当前对象出现过
+    {
+        // 非强制不命中
+        req->compulsory_miss = false;
+        // 当前对象在当前时间窗口是否第一次出现
+        req->first_seen_in_window =
+            (time_to_window_idx(it->second.last_access_rtime) !=
+             curr_time_window_idx);
+        // 当前请求的对象的创建时间
+
+        req->create_rtime = it->second.create_rtime;
+        req->create_vtime = it->second.create_vtime;
+
+        // 计算当前请求的对象的更新时间间隔(逻辑时间和实际时间)
+        req->rtime_since_last_update =
+            (int64_t)req->time - it->second.last_update_rtime;
+        req->vtime_since_last_update =
+            (int64_t)req->req_num - it->second.last_update_vtime;
+
+        // 计算当前请求的对象的访问时间间隔(逻辑时间和实际时间)
+        req->vtime_since_last_access =
+            (int64_t)req->req_num - it->second.last_access_vtime;
+        req->rtime_since_last_access =
+            (int64_t)(req->time) - it->second.last_access_rtime;
+
+        // 若为写入，则是覆写请求
+        if (req->type == parser::OP_SET ||
+            req->type == parser::OP_REPLACE ||
+            req->type == parser::OP_CAS) {
+            req->overwrite = true;
+
+            it->second.last_update_rtime = (int32_t)req->time;
+            it->second.last_update_vtime = (int32_t)req->req_num;
+        } else  // 否则不是覆写请求
+        {
+            req->overwrite = false;
+        }
+
+        assert(req->vtime_since_last_access > 0);
+        assert(req->rtime_since_last_access >= 0);
+
+        // 对象之前的大小
+        req->prev_size = it->second.obj_size;
+        // 对象的当前的大小
+        it->second.obj_size = req->req_size;
+        // 对象的访问频次加1
+        it->second.freq += 1;
+        // 对象的最后访问时间(逻辑时间和实际时间)
+        it->second.last_access_vtime = req->req_num;
+        it->second.last_access_rtime = (int32_t)(req->time);
+    }
+}
+
+/* out-of-core annotation: each shard thread takes the partitions p with
+ * p % n_shards_ == shard in turn, annotates the requests of one partition
+ * with a metadata map of only that partition's objects, writes them to an
+ * annotated partition and clears the map. partitions holds the annotated
+ * files afterwards */
+void traceAnalyzer::TraceAnalyzer::annotate_spilled(
+    std::vector<std::string>& partitions) {
+    std::vector<std::string> annotated(partitions.size());
+    auto annotate_partitions = [&](int shard) {
+        parser::Request req{};
+        utils::SpillReq r;
+        for (int p = shard; p < (int)partitions.size(); p += n_shards_) {
+            utils::SpillFile in(partitions[p], "rb");
+            annotated[p] = spill_path("annotated", p);
+            utils::SpillFile out(annotated[p], "wb");
+            while (in.read(r)) {
+                utils::fromSpill(&r, &req);
+                annotate_req(shard, &req);
+                utils::toSpill(&req, &r);
+                out.write(r);
+            }
+            in.remove();
+            // 分区中的对象不会再出现，统计之后清空元数据表
+            collect_obj_stats(shard);
+            obj_maps_[shard].clear();
+        }
+    };
+
+    if (n_shards_ == 1) {
+        annotate_partitions(0);
+    } else {
+        std::vector<std::thread> threads;
+        for (int s = 0; s < n_shards_; s++) {
+            threads.emplace_back(annotate_partitions, s);
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    }
+    partitions.swap(annotated);
+}
+
+// 按请求序号多路归并已标注的分区，按原来的请求顺序交给各个统计模块，之后删除分区文件
+void traceAnalyzer::TraceAnalyzer::merge_spilled(
+    std::vector<std::string>& partitions,
+    const std::function<void(parser::Request*)>& feed) {
+    typedef std::pair<int64_t, int> head_t;  // (请求序号, 分区)
+    std::priority_queue<head_t, std::vector<head_t>, std::greater<head_t>> heap;
+    std::vector<utils::SpillFile*> files;
+    std::vector<utils::SpillReq> heads(partitions.size());
+    uint64_t buffer_bytes = utils::spillBufferBytes(partitions.size());
+    for (int p = 0; p < (int)partitions.size(); p++) {
+        files.push_back(new utils::SpillFile(partitions[p], "rb", buffer_bytes));
+        if (files[p]->read(heads[p])) {
+            heap.push(head_t((int64_t)heads[p].req_num, p));
+        }
+    }
+
+    parser::Request req{};
+    while (!heap.empty()) {
+        int p = heap.top().second;
+        heap.pop();
+        utils::fromSpill(&heads[p], &req);
+        feed(&req);
+        if (files[p]->read(heads[p])) {
+            heap.push(head_t((int64_t)heads[p].req_num, p));
+        }
+    }
+
+    for (auto file : files) {
+        file->remove();
+        delete file;
+    }
+}
+
+// 将分片元数据表中对象的访问频次等计入该分片的统计
+void traceAnalyzer::TraceAnalyzer::collect_obj_stats(int shard) {
+    obj_info_map_type& obj_map = obj_maps_[shard];
+    obj_stat& stat = shard_obj_stats_[shard];
+    stat.n_hit.resize(track_n_hit_, 0);
+    stat.n_obj += obj_map.size();
+    for (auto& it : obj_map) {
+        if (it.second.freq <= track_n_hit_) {
+            stat.n_hit[it.second.freq - 1] += 1;
+        }
+        if (option_.popularity) {
+            stat.freq_cnt[it.second.freq] += 1;
+        }
+    }
+    // 扁平hash表，含探测缓冲区
+    uint64_t map_bytes =
+        obj_map.calcNumBytesTotal(obj_map.calcNumElementsWithBuffer(obj_map.mask() + 1));
+    stat.map_bytes = std::max(stat.map_bytes, map_bytes);
+}
+
 string traceAnalyzer::TraceAnalyzer::gen_stat_str() {
     // 清空字符串流
     stat_ss_.clear();
     // 强制对象缺失率
-    double cold_miss_ratio = (double)obj_map_.size() / (double)n_req_;
+    double cold_miss_ratio = (double)n_obj_ / (double)n_req_;
     // 强制字节缺失率
     double byte_cold_miss_ratio =
         (double)sum_obj_size_obj / (double)sum_obj_size_req;
     // 请求大小(包含重复对象)和对象大小(不包含重复对象)的平均值
     int mean_obj_size_req = (int)((double)sum_obj_size_req / (double)n_req_);
     int mean_obj_size_obj =
-        (int)((double)sum_obj_size_obj / (double)obj_map_.size());
+        (int)((double)sum_obj_size_obj / (double)n_obj_);
     // 每个对象的平均访问频次
-    double freq_mean = (double)n_req_ / (double)obj_map_.size();
+    double freq_mean = (double)n_req_ / (double)n_obj_;
     // 实际时间戳跨度
     int64_t time_span = end_ts_ - start_ts_;
 
     stat_ss_ << setprecision(4) << fixed << "dat: " << parser_->trace_path_
              << "\n"
              << "number of requests: " << n_req_
-             << ", number of objects: " << obj_map_.size() << "\n"
+             << ", number of objects: " << n_obj_ << "\n"
              << "number of req GiB: " << (double)sum_obj_size_req / (double)GiB
              << ", number of obj GiB: "
              << (double)sum_obj_size_obj / (double)GiB << "\n"
@@ -409,6 +599,17 @@ string traceAnalyzer::TraceAnalyzer::gen_stat_str() {
     stat_ss_ << "time span: " << time_span << "("
              << (double)(end_ts_ - start_ts_) / 3600 / 24 << " day)\n";
 
+    // 对象元数据表占用的内存与进程RSS对比，溢出模式下为各分片处理过的最大分区之和
+    uint64_t obj_map_bytes = 0;
+    for (auto& stat : shard_obj_stats_) {
+        obj_map_bytes += stat.map_bytes;
+    }
+    stat_ss_ << "obj_map memory" << (spill_dir_.empty() ? "" : " (peak, spilled)")
+             << ": " << (double)obj_map_bytes / (double)MiB
+             << " MiB (" << (double)obj_map_bytes / (double)n_obj_
+             << " bytes/obj), process RSS: "
+             << (double)misc::processRssBytes() / (double)MiB << " MiB\n";
+
     // 输出各个统计信息
     stat_ss_ << *op_stat_;
     if (ttl_stat_ != nullptr) {
@@ -422,7 +623,7 @@ string traceAnalyzer::TraceAnalyzer::gen_stat_str() {
     stat_ss_ << "X-hit (number of obj accessed X times): ";
     for (int i = 0; i < track_n_hit_; i++) {
         stat_ss_ << n_hit_cnt_[i] << "("
-                 << (double)n_hit_cnt_[i] / (double)obj_map_.size() << "), ";
+                 << (double)n_hit_cnt_[i] / (double)n_obj_ << "), ";
     }
     stat_ss_ << "\n";
 
@@ -451,21 +652,37 @@ void traceAnalyzer::TraceAnalyzer::post_processing() {
     memset(n_hit_cnt_, 0, sizeof(uint64_t) * track_n_hit_);
     memset(popular_cnt_, 0, sizeof(uint64_t) * track_n_popular_);
 
-    // 统计对象的访问频次分布
-    for (auto it : obj_map_) {
-        if (it.second.freq <= track_n_hit_) {
-            n_hit_cnt_[it.second.freq - 1] += 1;
+    // 统计对象的访问频次分布，溢出模式下已在标注各个分区时统计
+    if (spill_dir_.empty()) {
+        for (int s = 0; s < n_shards_; s++) {
+            collect_obj_stats(s);
+        }
+    }
+
+    // 合并各个分片：对象数、不重复对象的总大小、访问频次分布和各访问频次的对象数
+    n_obj_ = 0;
+    sum_obj_size_obj = 0;
+    freq_cnt_map_type freq_cnt;
+    for (int s = 0; s < n_shards_; s++) {
+        obj_stat& stat = shard_obj_stats_[s];
+        n_obj_ += stat.n_obj;
+        sum_obj_size_obj += shard_sum_obj_size_[s];
+        for (int i = 0; i < (int)stat.n_hit.size(); i++) {
+            n_hit_cnt_[i] += stat.n_hit[i];
+        }
+        for (auto& it : stat.freq_cnt) {
+            freq_cnt[it.first] += it.second;
         }
+        stat.freq_cnt.clear();
     }
 
     // 统计对象流行度，统计包括访问频率和排名遵从的zipf分布参数，以及各个访问频率的出现次数
     if (option_.popularity) {
-        popularity_stat_ = new Popularity(obj_map_);
-        // 获取对象访问频率的排序列表
-        auto sorted_freq = popularity_stat_->get_sorted_freq();
+        popularity_stat_ = new Popularity(std::move(freq_cnt));
         // 统计最受欢迎的n个对象的访问频率
-        for (int i = 0; i < track_n_popular_; i++) {
-            popular_cnt_[i] = sorted_freq[i];
+        auto top_freq = popularity_stat_->get_top_freq(track_n_popular_);
+        for (int i = 0; i < (int)top_freq.size(); i++) {
+            popular_cnt_[i] = top_freq[i];
         }
     }
 }
@@ -9,8 +9,11 @@
 #include <inttypes.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <sys/resource.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <functional>
 #include <iostream>
 #include <sstream>
 #include <string>
@@ -18,11 +21,15 @@
 #include <utility>
 #include <vector>
 
+#include "common/hash.hpp"
 #include "common/logging.h"
 #include "common/macro.h"
 
 #include "parsers/parser.hpp"
 
+#include "utils/broadcastRing.h"
+#include "utils/shardPipeline.h"
+#include "utils/spill.h"
 #include "utils/struct.h"
 
 #include "stats/accessPattern.h"
@@ -34,6 +41,7 @@
 #include "stats/reuse.h"
 #include "stats/size.h"
 #include "stats/ttl.h"
+#include "stats/workingSet.h"
 
 /* experimental module */
 #include "experimental/createFutureReuseCCDF.h"
@@ -70,6 +78,8 @@ typedef struct analysis_option {
     bool size_change;  // 是否统计覆写对象的大小变化分布情况
 
     bool lifespan;
+
+    bool working_set;  // 是否用基数估计草图统计每个时间窗口的工作集大小
 } analysis_option_t;
 
 typedef struct analysis_param {
@@ -80,6 +90,22 @@ typedef struct analysis_param {
     int warmup_time;
     double access_pattern_sample_ratio;
     int access_pattern_sample_ratio_inv;
+    /* the sliding window of the working set estimates, in time windows */
+    int wss_sliding_windows;
+    /* run each enabled module on its own thread, fed by a broadcast ring of
+     * annotated requests, instead of calling them one after another */
+    bool module_threads;
+    int ring_size;
+    /* partition objects by id hash into n_shards metadata maps, each
+     * annotated by its own thread; modules still see requests in trace
+     * order, so per-window statistics are unchanged */
+    int n_shards;
+    /* out-of-core mode when not empty: requests are spilled to
+     * n_spill_partitions files in spill_dir by object id, each partition is
+     * annotated with only its own objects in memory, and the annotated
+     * partitions are merged back in trace order for the modules */
+    std::string spill_dir;
+    int n_spill_partitions;
 } analysis_param_t;
 
 static analysis_param_t default_param() {
@@ -90,6 +116,12 @@ static analysis_param_t default_param() {
     param.warmup_time = 86400;
     param.access_pattern_sample_ratio = 0.01;
     param.access_pattern_sample_ratio_inv = 101;
+    param.wss_sliding_windows = 12;
+    param.module_threads = true;
+    param.ring_size = 1 << 16;
+    param.n_shards = 1;
+    param.spill_dir = "";
+    param.n_spill_partitions = 16;
 
     return param;
 };
@@ -107,6 +139,7 @@ static struct analysis_option default_option() {
     option.prob_at_age = false;
     option.size_change = false;
     option.lifetime = false;
+    option.working_set = false;
 
     return option;
 };
@@ -127,7 +160,24 @@ class TraceAnalyzer {
           track_n_popular_(params.track_n_popular),
           track_n_hit_(params.track_n_hit),
           time_window_(params.time_window),
-          warmup_time_(params.warmup_time) {
+          warmup_time_(params.warmup_time),
+          wss_sliding_windows_(params.wss_sliding_windows),
+          module_threads_(params.module_threads),
+          ring_size_(params.ring_size),
+          n_shards_(std::max(params.n_shards, 1)),
+          spill_dir_(params.spill_dir),
+          n_spill_partitions_(std::max(params.n_spill_partitions, 1)) {
+        // 溢出模式下，每个分片线程依次标注一部分分区
+        if (!spill_dir_.empty()) {
+            n_shards_ = std::min(n_shards_, n_spill_partitions_);
+            // 第一遍和归并时所有分区文件同时打开
+            struct rlimit lim;
+            if (getrlimit(RLIMIT_NOFILE, &lim) == 0 &&
+                (rlim_t)n_spill_partitions_ + utils::SPILL_RESERVED_FDS > lim.rlim_cur) {
+                ERROR("spillPartitions %d exceeds the open file limit %lu (%d kept in reserve)\n",
+                      n_spill_partitions_, (unsigned long)lim.rlim_cur, utils::SPILL_RESERVED_FDS);
+            }
+        }
         if (warmup_time_ % time_window_ != 0) {
             /* the popularityDecay computation needs warmup time to be multiple
              * of time_window */
@@ -165,9 +215,21 @@ class TraceAnalyzer {
     int track_n_hit_;
     // the sampling ratio used in access pattern analysis
     int access_pattern_sample_ratio_inv_;
+    // the number of time windows in the sliding working set estimate
+    int wss_sliding_windows_;
+    // one thread per module, and the number of requests the ring buffers
+    bool module_threads_;
+    int ring_size_;
+    // the number of object shards, each with its own metadata map
+    int n_shards_;
+    // the directory of the spill files (empty: everything in memory) and
+    // the number of object partitions spilled
+    std::string spill_dir_;
+    int n_spill_partitions_;
 
     /* stat */
     int64_t n_req_ = 0;
+    uint64_t n_obj_ = 0;
 
     /* number of one-hit, two-hit ... */
     uint64_t* n_hit_cnt_ = nullptr;
@@ -181,7 +243,19 @@ class TraceAnalyzer {
      * an object is requested, we ignore for now */
     //  uint64_t sum_req_size_req = 0, sum_req_size_obj = 0;
 
-    obj_info_map_type obj_map_;  // 对象id->对象元数据
+    // 对象id->对象元数据，按id哈希分片，每个分片只由一个线程访问
+    std::vector<obj_info_map_type> obj_maps_;
+    // 各分片中不重复对象的总大小
+    std::vector<uint64_t> shard_sum_obj_size_;
+
+    // 一个分片中对象的统计，溢出模式下累加该分片处理过的所有分区
+    struct obj_stat {
+        uint64_t n_obj = 0;
+        std::vector<uint64_t> n_hit;  // 访问1次、2次...的对象数
+        freq_cnt_map_type freq_cnt;   // 各访问频次的对象数，统计流行度时才收集
+        uint64_t map_bytes = 0;       // 元数据表占用的最大内存
+    };
+    std::vector<obj_stat> shard_obj_stats_;
 
    private:
     parser::Parser* parser_ = nullptr;
@@ -198,6 +272,7 @@ class TraceAnalyzer {
     Popularity* popularity_stat_ = nullptr;
     PopularityDecay* popularity_decay_stat_ = nullptr;
     LifespanDistribution* lifespan_stat_ = nullptr;
+    WorkingSet* working_set_stat_ = nullptr;
 
     ProbAtAge* prob_at_age_ = nullptr;
     LifetimeDistribution* lifetime_stat_ = nullptr;
@@ -210,6 +285,36 @@ class TraceAnalyzer {
 
     string output_path_;
 
+    /* add_req of every enabled module, in the order they used to be called.
+     * Modules only read the request and share no state, so each can run on
+     * its own thread */
+    std::vector<std::function<void(parser::Request*)>> modules_;
+
+    void annotate_req(int shard, parser::Request* req);
+
+    inline int shard_of(uint64_t id) {
+        return misc::fastRange(misc::mix64(id, SHARD_SEED), n_shards_);
+    }
+    inline int spill_partition_of(uint64_t id) {
+        return misc::fastRange(misc::mix64(id, SPILL_SEED), n_spill_partitions_);
+    }
+    static constexpr uint64_t SHARD_SEED = 0x2545f4914f6cdd1dULL;
+    static constexpr uint64_t SPILL_SEED = 0x9e3779b97f4a7c15ULL;
+    static constexpr uint64_t SHARD_BATCH_SIZE = 4096;  // 每批请求数
+    static constexpr int SHARD_PIPELINE_DEPTH = 4;      // 同时在处理的批次数
+
+    void collect_obj_stats(int shard);
+
+    void annotate_spilled(std::vector<std::string>& partitions);
+
+    void merge_spilled(std::vector<std::string>& partitions,
+                       const std::function<void(parser::Request*)>& feed);
+
+    inline std::string spill_path(const char* kind, int partition) {
+        return spill_dir_ + "/analyzer." + std::to_string(getpid()) + "." +
+               kind + "." + std::to_string(partition);
+    }
+
     void post_processing();
 
     string gen_stat_str();
@@ -65,10 +65,10 @@ namespace traceAnalyzer
         case parser::OP_GETS:
         case parser::OP_HEAD:
             // reuse_rtime_req_cnt_read_[pos_rt] += 1;
-            rlifespan_readprob[rlifetime] += 1;
-            rlifespan2_readprob[rlifetime_since_last_update] += 1;
-            vlifespan_readprob[vlifetime] += 1;
-            vlifespan2_readprob[vlifetime_since_last_update] += 1;
+            rlifespan_readprob.add(rlifetime);
+            rlifespan2_readprob.add(rlifetime_since_last_update);
+            vlifespan_readprob.add(vlifetime);
+            vlifespan2_readprob.add(vlifetime_since_last_update);
             break;
         // 写入操作
         case parser::OP_SET:
@@ -76,17 +76,17 @@ namespace traceAnalyzer
         case parser::OP_REPLACE:
         case parser::OP_CAS:
             // reuse_rtime_req_cnt_write_[pos_rt] += 1;
-            rlifespan_writeprob[rlifetime] += 1;
-            rlifespan2_writeprob[rlifetime_since_last_update] += 1;
-            vlifespan_writeprob[vlifetime] += 1;
-            vlifespan2_writeprob[vlifetime_since_last_update] += 1;
+            rlifespan_writeprob.add(rlifetime);
+            rlifespan2_writeprob.add(rlifetime_since_last_update);
+            vlifespan_writeprob.add(vlifetime);
+            vlifespan2_writeprob.add(vlifetime_since_last_update);
             break;
         case parser::OP_DELETE:
             // reuse_rtime_req_cnt_delete_[pos_rt] += 1;
-            rlifespan_deleteprob[rlifetime] += 1;
-            rlifespan2_deleteprob[rlifetime_since_last_update] += 1;
-            vlifespan_deleteprob[vlifetime] += 1;
-            vlifespan2_deleteprob[vlifetime_since_last_update] += 1;
+            rlifespan_deleteprob.add(rlifetime);
+            rlifespan2_deleteprob.add(rlifetime_since_last_update);
+            vlifespan_deleteprob.add(vlifetime);
+            vlifespan2_deleteprob.add(vlifetime_since_last_update);
             break;
         default:
             break;
@@ -117,16 +117,10 @@ namespace traceAnalyzer
         ofs1 << "# " << path_base << "\n";
 
         ofs1 << "# read rlifespan1\n";
-        for (auto &p : rlifespan_readprob)
-        {
-            ofs1 << p.first << ":" << p.second << "\n";
-        }
+        rlifespan_readprob.dump(ofs1);
 
         ofs1 << "# read rlifespan2\n";
-        for (auto &p : rlifespan2_readprob)
-        {
-            ofs1 << p.first << ":" << p.second << "\n";
-        }
+        rlifespan2_readprob.dump(ofs1);
 
         ofs1.close();
 
@@ -134,16 +128,10 @@ namespace traceAnalyzer
         ofs2 << "# " << path_base << "\n";
 
         ofs2 << "# read vlifespan1\n";
-        for (auto &p : vlifespan_readprob)
-        {
-            ofs2 << p.first << ":" << p.second << "\n";
-        }
+        vlifespan_readprob.dump(ofs2);
 
         ofs2 << "# read vlifespan2\n";
-        for (auto &p : vlifespan2_readprob)
-        {
-            ofs2 << p.first << ":" << p.second << "\n";
-        }
+        vlifespan2_readprob.dump(ofs2);
 
         ofs2.close();
 
@@ -151,16 +139,10 @@ namespace traceAnalyzer
         ofs3 << "# " << path_base << "\n";
 
         ofs3 << "# write rlifespan1\n";
-        for (auto &p : rlifespan_writeprob)
-        {
-            ofs3 << p.first << ":" << p.second << "\n";
-        }
+        rlifespan_writeprob.dump(ofs3);
 
         ofs3 << "# write rlifespan2\n";
-        for (auto &p : rlifespan2_writeprob)
-        {
-            ofs3 << p.first << ":" << p.second << "\n";
-        }
+        rlifespan2_writeprob.dump(ofs3);
 
         ofs3.close();
 
@@ -168,16 +150,10 @@ namespace traceAnalyzer
         ofs4 << "# " << path_base << "\n";
 
         ofs4 << "# write vlifespan1\n";
-        for (auto &p : vlifespan_writeprob)
-        {
-            ofs4 << p.first << ":" << p.second << "\n";
-        }
+        vlifespan_writeprob.dump(ofs4);
 
         ofs4 << "# write vlifespan2\n";
-        for (auto &p : vlifespan2_writeprob)
-        {
-            ofs4 << p.first << ":" << p.second << "\n";
-        }
+        vlifespan2_writeprob.dump(ofs4);
 
         ofs4.close();
 
@@ -185,16 +161,10 @@ namespace traceAnalyzer
         ofs5 << "# " << path_base << "\n";
 
         ofs5 << "# delete rlifespan1\n";
-        for (auto &p : rlifespan_deleteprob)
-        {
-            ofs5 << p.first << ":" << p.second << "\n";
-        }
+        rlifespan_deleteprob.dump(ofs5);
 
         ofs5 << "# delete rlifespan2\n";
-        for (auto &p : rlifespan2_deleteprob)
-        {
-            ofs5 << p.first << ":" << p.second << "\n";
-        }
+        rlifespan2_deleteprob.dump(ofs5);
 
         ofs5.close();
 
@@ -202,16 +172,10 @@ namespace traceAnalyzer
         ofs6 << "# " << path_base << "\n";
 
         ofs6 << "# delete vlifespan1\n";
-        for (auto &p : vlifespan_deleteprob)
-        {
-            ofs6 << p.first << ":" << p.second << "\n";
-        }
+        vlifespan_deleteprob.dump(ofs6);
 
         ofs6 << "# delete vlifespan2\n";
-        for (auto &p : vlifespan2_deleteprob)
-        {
-            ofs6 << p.first << ":" << p.second << "\n";
-        }
+        vlifespan2_deleteprob.dump(ofs6);
 
         ofs6.close();
 
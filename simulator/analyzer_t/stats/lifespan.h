@@ -9,6 +9,7 @@
 #include <vector>
 
 #include "analyzer_t/utils/struct.h"
+#include "common/hdr_histogram.hpp"
 #include "common/macro.h"
 #include "parsers/parser.hpp"
 // #include "analyzer/utils/utils.h"
@@ -37,14 +38,12 @@ class LifespanDistribution {
 
    private:
     /* request count for reuse rtime/vtime */
-    std::unordered_map<int32_t, uint32_t>
-        reuse_rtime_req_cnt_;  // 总体实际重用时间间隔分布
-    std::unordered_map<int32_t, uint32_t>
-        reuse_vtime_req_cnt_;  // 总体逻辑重用时间间隔分布
+    misc::HdrHistogram reuse_rtime_req_cnt_;  // 总体实际重用时间间隔分布
+    misc::HdrHistogram reuse_vtime_req_cnt_;  // 总体逻辑重用时间间隔分布
 
-    std::unordered_map<int32_t, uint32_t> reuse_rtime_req_cnt_read_;
-    std::unordered_map<int32_t, uint32_t> reuse_rtime_req_cnt_write_;
-    std::unordered_map<int32_t, uint32_t> reuse_rtime_req_cnt_delete_;
+    misc::HdrHistogram reuse_rtime_req_cnt_read_;
+    misc::HdrHistogram reuse_rtime_req_cnt_write_;
+    misc::HdrHistogram reuse_rtime_req_cnt_delete_;
 
     /* used to plot reuse distribution heatmap */
     const double log_base_ = 1.5;
@@ -66,36 +65,24 @@ class LifespanDistribution {
         window_lifetime_vtime_req_cnt_;  // 时间窗口内的生命周期分布(逻辑时间)
 
     // 全局信息，应当在obj_info中统计
-    std::unordered_map<uint32_t, uint32_t> read_cnt;  // 对象的读请求次数分布
-    std::unordered_map<uint32_t, uint32_t> write_cnt;  // 对象的写请求次数分布
+    misc::HdrHistogram read_cnt;  // 对象的读请求次数分布
+    misc::HdrHistogram write_cnt;  // 对象的写请求次数分布
 
     // 首先判断是否在缓存中
-    std::unordered_map<uint32_t, uint32_t>
-        rlifespan_readprob;  // <生命周期，在该生命周期(创建以来)被读取的对象个数>
-    std::unordered_map<uint32_t, uint32_t>
-        rlifespan_writeprob;  // <生命周期，在该生命周期(创建以来)被写入的对象个数>
-    std::unordered_map<uint32_t, uint32_t>
-        rlifespan2_readprob;  // <生命周期，在该生命周期(自上次更新)被读取的对象个数>
-    std::unordered_map<uint32_t, uint32_t>
-        rlifespan2_writeprob;  // <生命周期，在该生命周期(自上次更新)被写入的对象个数>
-
-    std::unordered_map<uint32_t, uint32_t>
-        vlifespan_readprob;  // <生命周期，在该生命周期(创建以来)被读取的对象个数>
-    std::unordered_map<uint32_t, uint32_t>
-        vlifespan_writeprob;  // <生命周期，在该生命周期(创建以来)被写入的对象个数>
-    std::unordered_map<uint32_t, uint32_t>
-        vlifespan2_readprob;  // <生命周期，在该生命周期(自上次更新)被读取的对象个数>
-    std::unordered_map<uint32_t, uint32_t>
-        vlifespan2_writeprob;  // <生命周期，在该生命周期(自上次更新)被写入的对象个数>
-
-    std::unordered_map<uint32_t, uint32_t>
-        rlifespan_deleteprob;  // <生命周期，在该生命周期(创建以来)被删除的对象个数>
-    std::unordered_map<uint32_t, uint32_t>
-        vlifespan_deleteprob;  // <生命周期，在该生命周期(创建以来)被删除的对象个数>
-    std::unordered_map<uint32_t, uint32_t>
-        rlifespan2_deleteprob;  // <生命周期，在该生命周期(自上次更新)被删除的对象个数>
-    std::unordered_map<uint32_t, uint32_t>
-        vlifespan2_deleteprob;  // <生命周期，在该生命周期(自上次更新)被删除的对象个数>
+    misc::HdrHistogram rlifespan_readprob;  // <生命周期，在该生命周期(创建以来)被读取的对象个数>
+    misc::HdrHistogram rlifespan_writeprob;  // <生命周期，在该生命周期(创建以来)被写入的对象个数>
+    misc::HdrHistogram rlifespan2_readprob;  // <生命周期，在该生命周期(自上次更新)被读取的对象个数>
+    misc::HdrHistogram rlifespan2_writeprob;  // <生命周期，在该生命周期(自上次更新)被写入的对象个数>
+
+    misc::HdrHistogram vlifespan_readprob;  // <生命周期，在该生命周期(创建以来)被读取的对象个数>
+    misc::HdrHistogram vlifespan_writeprob;  // <生命周期，在该生命周期(创建以来)被写入的对象个数>
+    misc::HdrHistogram vlifespan2_readprob;  // <生命周期，在该生命周期(自上次更新)被读取的对象个数>
+    misc::HdrHistogram vlifespan2_writeprob;  // <生命周期，在该生命周期(自上次更新)被写入的对象个数>
+
+    misc::HdrHistogram rlifespan_deleteprob;  // <生命周期，在该生命周期(创建以来)被删除的对象个数>
+    misc::HdrHistogram vlifespan_deleteprob;  // <生命周期，在该生命周期(创建以来)被删除的对象个数>
+    misc::HdrHistogram rlifespan2_deleteprob;  // <生命周期，在该生命周期(自上次更新)被删除的对象个数>
+    misc::HdrHistogram vlifespan2_deleteprob;  // <生命周期，在该生命周期(自上次更新)被删除的对象个数>
 
     std::ofstream stream_dump_rt_ofs;  // 实际重用时间间隔分布的输出文件流
     std::ofstream stream_dump_vt_ofs;  // 逻辑重用时间间隔分布的输出文件流
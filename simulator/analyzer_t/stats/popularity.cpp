@@ -14,7 +14,7 @@ namespace traceAnalyzer
 
     void Popularity::dump(string &path_base)
     {
-        if (freq_vec_.empty())
+        if (freq_cnt_.empty())
         {
             assert(!has_run);
             ERROR("popularity has not been computed\n");
@@ -26,80 +26,84 @@ namespace traceAnalyzer
         ofs << "# " << path_base << "\n";
         ofs << "# freq (sorted):cnt - for Zipf plot\n";
 
-        /* convert sorted freq list to freq:cnt list sorted by freq (to save some
-         * space) */
-        uint32_t last_freq = freq_vec_[0];
-        uint32_t freq_cnt = 0;
-        // 将排序后的对象访问频率列表转换为访问频率:数量列表
-        for (auto &cnt : freq_vec_)
+        // 依次输出频率和出现次数
+        for (auto &it : freq_cnt_)
         {
-            if (cnt == last_freq)
-            {
-                freq_cnt += 1;
-            }
-            else
-            {
-                ofs << last_freq << ":" << freq_cnt << "\n";
-                freq_cnt = 1;
-                last_freq = cnt;
-            }
+            ofs << it.first << ":" << it.second << "\n";
         }
-        // 依次输出频率和出现次数
-        ofs << last_freq << ":" << freq_cnt << "\n";
         ofs.close();
     }
 
-    void Popularity::run(obj_info_map_type &obj_map)
+    vector<uint32_t> Popularity::get_top_freq(uint64_t n) const
     {
-        /* freq_vec_ is a sorted vec of obj frequency */
-        freq_vec_.reserve(obj_map.size());
+        vector<uint32_t> top;
+        for (auto it = freq_cnt_.begin(); it != freq_cnt_.end() && top.size() < n; ++it)
+        {
+            top.insert(top.end(), min<uint64_t>(it->second, n - top.size()), it->first);
+        }
+        return top;
+    }
 
-        // 将所有对象的访问频率放入freq_vec_中并按降序排序
+    void Popularity::add_freq(obj_info_map_type &obj_map)
+    {
+        // 统计各访问频率的对象数
         for (const auto &p : obj_map)
         {
-            freq_vec_.push_back(p.second.freq);
+            freq_cnt_[p.second.freq] += 1;
+        }
+    }
+
+    void Popularity::run()
+    {
+        n_obj_ = 0;
+        for (auto &it : freq_cnt_)
+        {
+            n_obj_ += it.second;
         }
-        sort(freq_vec_.begin(), freq_vec_.end(), greater<>());
 
         // 对象数量太少，返回
-        if (obj_map.size() < 200)
+        if (n_obj_ < 200)
         {
             fit_fail_reason_ = "popularity: too few objects (" +
-                               to_string(obj_map.size()) +
+                               to_string(n_obj_) +
                                "), skip the popularity computation";
             WARN("%s\n", fit_fail_reason_.c_str());
             return;
         }
 
         // 最受欢迎的对象的访问频率太低
-        if (freq_vec_[0] < 200)
+        if (freq_cnt_.begin()->first < 200)
         {
             fit_fail_reason_ = "popularity: the most popular object has " +
-                               to_string(freq_vec_[0]) + " requests ";
+                               to_string(freq_cnt_.begin()->first) + " requests ";
             WARN("%s\n", fit_fail_reason_.c_str());
         }
 
         /* calculate Zipf alpha using linear regression */
         // Zipf 分布是一种离散概率分布，它的概率质量函数满足幂律，即排名（rank）和频率（frequency）之间的关系可以用一个负的幂次表示
 
-        vector<double> log_freq(obj_map.size());
-        vector<double> log_rank(obj_map.size());
-
-        int i = 0;
-        // 将所有对象的访问频率的对数放入log_freq中
-        for_each(log_freq.begin(), log_freq.end(),
-                 [&](double &item)
-                 { item = log(freq_vec_[i++]); });
-        i = 0;
-        // 将所有对象的访问频率排名的对数放入log_rank中
-        for_each(log_rank.begin(), log_rank.end(), [&](double &item)
-                 { ++i;
-               item = log(i); });
+        // 按排名顺序累加log(rank)和log(freq)的和、平方和与乘积和，
+        // 与PopularityUtils::slope的求和顺序相同，但不需要按对象展开的数组
+        double s_x = 0, s_y = 0, s_xx = 0, s_xy = 0;
+        uint64_t rank = 0;
+        for (auto &it : freq_cnt_)
+        {
+            double log_freq = log(it.first);
+            for (uint64_t k = 0; k < it.second; k++)
+            {
+                double log_rank = log(++rank);
+                s_x += log_rank;
+                s_y += log_freq;
+                s_xx += log_rank * log_rank;
+                s_xy += log_rank * log_freq;
+            }
+        }
 
         /* TODO: a better linear regression with intercept and R2 */
         // 线性回归分析，使用最小二乘法计算斜率
         // 这个线性关系的斜率就是我们要找的 Zipf 分布的参数
-        slope_ = -PopularityUtils::slope(log_rank, log_freq);
+        const auto n = n_obj_;
+        slope_ = -(n * s_xy - s_x * s_y) / (n * s_xx - s_x * s_x);
 
         has_run = true;
     }
@@ -3,9 +3,12 @@
 #include <algorithm>
 #include <cassert>
 #include <cmath>
+#include <functional>
 #include <iomanip>
+#include <map>
 #include <numeric>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include "analyzer_t/utils/linReg.h"
@@ -40,16 +43,28 @@ class PopularityUtils {
     }
 };
 
+// 访问频率 -> 该频率的对象数，按频率降序
+typedef std::map<uint32_t, uint64_t, std::greater<uint32_t>> freq_cnt_map_type;
+
 class Popularity {
    public:
     Popularity() { has_run = false; };
     ~Popularity() = default;
 
-    explicit Popularity(obj_info_map_type& obj_map) { run(obj_map); };
+    explicit Popularity(obj_info_map_type& obj_map) {
+        add_freq(obj_map);
+        run();
+    };
+
+    // 对象元数据按id分片或溢出到磁盘时，由调用者统计各访问频率的对象数
+    explicit Popularity(freq_cnt_map_type&& freq_cnt)
+        : freq_cnt_(std::move(freq_cnt)) {
+        run();
+    };
 
     friend std::ostream& operator<<(std::ostream& os,
                                     const Popularity& popularity) {
-        if (popularity.freq_vec_.empty()) {
+        if (popularity.freq_cnt_.empty()) {
             ERROR("popularity has not been computed\n");
             return os;
         }
@@ -65,16 +80,19 @@ class Popularity {
         return os;
     }
 
-    std::vector<uint32_t>& get_sorted_freq() { return freq_vec_; }
+    // 最受欢迎的n个对象的访问频率，降序，对象不足n个时返回所有对象的
+    std::vector<uint32_t> get_top_freq(uint64_t n) const;
 
     void dump(std::string& path_base);
 
     std::string fit_fail_reason_ = "";
 
    private:
-    void run(obj_info_map_type& obj_map);
+    void add_freq(obj_info_map_type& obj_map);
+    void run();
 
-    std::vector<uint32_t> freq_vec_{};
+    freq_cnt_map_type freq_cnt_{};
+    uint64_t n_obj_ = 0;
     double slope_ = -1, intercept_ = -1, r2_ = -1;
     bool has_run = false;
 };
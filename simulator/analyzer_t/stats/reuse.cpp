@@ -26,8 +26,8 @@ namespace traceAnalyzer
         // 若当前请求的对象第一次出现，重用距离为-1，无穷大
         if (req->rtime_since_last_access < 0)
         {
-            reuse_rtime_req_cnt_[-1] += 1;
-            reuse_vtime_req_cnt_[-1] += 1;
+            reuse_rtime_req_cnt_.add(-1);
+            reuse_vtime_req_cnt_.add(-1);
 
             return;
         }
@@ -38,8 +38,8 @@ namespace traceAnalyzer
         int pos_vt = (int)(log(double(req->vtime_since_last_access)) / log_log_base_);
 
         // 统计出现频率
-        reuse_rtime_req_cnt_[pos_rt] += 1;
-        reuse_vtime_req_cnt_[pos_vt] += 1;
+        reuse_rtime_req_cnt_.add(pos_rt);
+        reuse_vtime_req_cnt_.add(pos_vt);
 
         //    switch (req->op) {
         //      case OP_GET:
@@ -86,17 +86,11 @@ namespace traceAnalyzer
         // 总体的实际重用时间间隔分布
         ofs << "# reuse real time: freq (time granularity " << rtime_granularity_
             << ")\n";
-        for (auto &p : reuse_rtime_req_cnt_)
-        {
-            ofs << p.first << ":" << p.second << "\n";
-        }
+        reuse_rtime_req_cnt_.dump(ofs);
 
         // 总体的逻辑重用时间间隔分布
         ofs << "# reuse virtual time: freq (log base " << log_base_ << ")\n";
-        for (auto &p : reuse_vtime_req_cnt_)
-        {
-            ofs << p.first << ":" << p.second << "\n";
-        }
+        reuse_vtime_req_cnt_.dump(ofs);
         ofs.close();
 
         //    if (std::accumulate(reuse_rtime_req_cnt_read_.begin(),
@@ -9,6 +9,7 @@
 #include <vector>
 
 #include "analyzer_t/utils/struct.h"
+#include "common/hdr_histogram.hpp"
 #include "analyzer_t/utils/utils.h"
 #include "parsers/parser.hpp"
 
@@ -36,14 +37,12 @@ class ReuseDistribution {
 
    private:
     /* request count for reuse rtime/vtime */
-    std::unordered_map<int32_t, uint32_t>
-        reuse_rtime_req_cnt_;  // 总体实际重用时间间隔分布
-    std::unordered_map<int32_t, uint32_t>
-        reuse_vtime_req_cnt_;  // 总体逻辑重用时间间隔分布
+    misc::HdrHistogram reuse_rtime_req_cnt_;  // 总体实际重用时间间隔分布
+    misc::HdrHistogram reuse_vtime_req_cnt_;  // 总体逻辑重用时间间隔分布
 
-    std::unordered_map<int32_t, uint32_t> reuse_rtime_req_cnt_read_;
-    std::unordered_map<int32_t, uint32_t> reuse_rtime_req_cnt_write_;
-    std::unordered_map<int32_t, uint32_t> reuse_rtime_req_cnt_delete_;
+    misc::HdrHistogram reuse_rtime_req_cnt_read_;
+    misc::HdrHistogram reuse_rtime_req_cnt_write_;
+    misc::HdrHistogram reuse_rtime_req_cnt_delete_;
 
     /* used to plot reuse distribution heatmap */
     const double log_base_ = 1.5;
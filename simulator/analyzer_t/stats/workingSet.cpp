@@ -0,0 +1,56 @@
+#include "workingSet.h"
+
+#include <iomanip>
+
+namespace traceAnalyzer
+{
+    using namespace std;
+
+    void WorkingSet::turn_on_stream_dump(string &path_base)
+    {
+        stream_dump_ofs.open(path_base + ".wss_w" + to_string(time_window_),
+                             ios::out | ios::trunc);
+        stream_dump_ofs << "# " << path_base << "\n";
+        stream_dump_ofs << "# estimated n_obj, n_byte per window and over the last "
+                        << n_sliding_windows_ << " windows (time window "
+                        << time_window_ << ")\n";
+    }
+
+    void WorkingSet::add_req(const parser::Request *req)
+    {
+        // 在第一个时间窗口时初始化下一个时间窗口的时间戳
+        if (unlikely(next_window_ts_ == -1))
+        {
+            next_window_ts_ = (int64_t)req->time + time_window_;
+        }
+
+        // 先结束已经过去的时间窗口，没有请求的窗口输出为0
+        while ((int64_t)req->time >= next_window_ts_)
+        {
+            stream_dump();
+            wss_.nextWindow();
+            next_window_ts_ += time_window_;
+        }
+
+        wss_.add(req->id, req->req_size);
+        window_has_req_ = true;
+    }
+
+    void WorkingSet::dump(string &path_base)
+    {
+        if (window_has_req_)
+        {
+            stream_dump();
+            window_has_req_ = false;
+        }
+    }
+
+    void WorkingSet::stream_dump()
+    {
+        misc::WindowedCardinality::Estimate e = wss_.estimate();
+        stream_dump_ofs << fixed << setprecision(0) << e.objects << "," << e.bytes << ","
+                        << e.sliding_objects << "," << e.sliding_bytes << "\n";
+        window_has_req_ = false;
+    }
+
+}; // namespace traceAnalyzer
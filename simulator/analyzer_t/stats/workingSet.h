@@ -0,0 +1,57 @@
+#pragma once
+/* working set size over time from cardinality sketches */
+
+#include <fstream>
+#include <string>
+
+#include "common/cardinality.hpp"
+#include "common/macro.h"
+#include "parsers/parser.hpp"
+
+namespace traceAnalyzer {
+
+/**
+ * estimates, for every time window, the number of distinct objects and
+ * distinct bytes requested in the window and in the last
+ * n_sliding_windows windows (the current one included), with HyperLogLog
+ * and KMV sketches instead of the exact per-object state in obj_map_. It
+ * only looks at req->id and req->req_size, so it gives the same curves on
+ * a raw request stream without the analyzer's annotations.
+ *
+ * output: one line per window,
+ *  n_obj, n_byte, sliding_n_obj, sliding_n_byte
+ */
+class WorkingSet {
+   public:
+    WorkingSet(std::string& path_base,
+               int time_window = 300,
+               int n_sliding_windows = 12)
+        : time_window_(time_window),
+          n_sliding_windows_(n_sliding_windows),
+          wss_(n_sliding_windows) {
+        turn_on_stream_dump(path_base);
+    };
+
+    ~WorkingSet() { stream_dump_ofs.close(); }
+
+    void add_req(const parser::Request* req);
+
+    // 输出最后一个不完整的时间窗口
+    void dump(std::string& path_base);
+
+   private:
+    const int time_window_;
+    const int n_sliding_windows_;
+    int64_t next_window_ts_ = -1;
+    bool window_has_req_ = false;
+
+    misc::WindowedCardinality wss_;
+
+    std::ofstream stream_dump_ofs;
+
+    void turn_on_stream_dump(std::string& path_base);
+
+    void stream_dump();
+};
+
+}  // namespace traceAnalyzer
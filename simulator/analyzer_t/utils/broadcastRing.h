@@ -0,0 +1,117 @@
+#pragma once
+
+#include <atomic>
+#include <algorithm>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+namespace utils
+{
+
+    /* single-producer multi-consumer ring where every consumer sees every
+     * item, in order. The producer fills claim() and calls publish(); each
+     * consumer runs consume(c, fn) on its own thread until close(). A slot
+     * is reused only after all consumers have passed it, so the slowest
+     * consumer throttles the producer. Positions are exchanged every
+     * `batch` items to keep the shared cache lines quiet. */
+    template <typename T>
+    class BroadcastRing
+    {
+    public:
+        BroadcastRing(uint64_t capacity, int num_consumers, uint64_t batch = 64)
+            : _cursors(num_consumers), _batch(batch)
+        {
+            // 容量取不小于capacity的2的幂，且至少容纳两个批次
+            uint64_t size = 1;
+            while (size < capacity || size < 2 * batch)
+                size <<= 1;
+            _slots.resize(size);
+            _mask = size - 1;
+        }
+
+        // 生产者：返回下一个可写的槽，所有消费者都读过它之前会等待
+        inline T *claim()
+        {
+            while (_head - _min_cursor > _mask)
+            {
+                uint64_t min_cursor = _head;
+                for (auto &cursor : _cursors)
+                {
+                    min_cursor = std::min(min_cursor, cursor.pos.load(std::memory_order_acquire));
+                }
+                _min_cursor = min_cursor;
+                if (_head - _min_cursor > _mask)
+                    std::this_thread::yield();
+            }
+            return &_slots[_head & _mask];
+        }
+
+        inline void publish()
+        {
+            _head++;
+            if (_head % _batch == 0)
+                _published.store(_head, std::memory_order_release);
+        }
+
+        // 生产者：发布剩余的项并通知消费者结束
+        void close()
+        {
+            _published.store(_head, std::memory_order_release);
+            _closed.store(true, std::memory_order_release);
+        }
+
+        // 消费者c：按顺序对每一项调用fn，直到close()之后取完所有项
+        template <typename Fn>
+        void consume(int c, Fn &&fn)
+        {
+            std::atomic<uint64_t> &pos = _cursors[c].pos;
+            uint64_t cursor = pos.load(std::memory_order_relaxed);
+            while (true)
+            {
+                uint64_t published = _published.load(std::memory_order_acquire);
+                if (published == cursor)
+                {
+                    // 先检查是否结束再重读发布位置，避免漏掉close()前的最后一批
+                    bool closed = _closed.load(std::memory_order_acquire);
+                    published = _published.load(std::memory_order_acquire);
+                    if (published == cursor)
+                    {
+                        if (closed)
+                            return;
+                        std::this_thread::yield();
+                        continue;
+                    }
+                }
+                while (cursor < published)
+                {
+                    fn(&_slots[cursor & _mask]);
+                    cursor++;
+                    if (cursor % _batch == 0)
+                        pos.store(cursor, std::memory_order_release);
+                }
+                pos.store(cursor, std::memory_order_release);
+            }
+        }
+
+        int num_consumers() const { return _cursors.size(); }
+
+    private:
+        // 每个消费者的读位置独占一个缓存行
+        struct alignas(64) Cursor
+        {
+            std::atomic<uint64_t> pos{0};
+        };
+
+        std::vector<T> _slots;
+        uint64_t _mask;
+        std::vector<Cursor> _cursors;
+        uint64_t _batch;
+
+        alignas(64) std::atomic<uint64_t> _published{0}; // 消费者可读到的位置
+        std::atomic<bool> _closed{false};
+        alignas(64) uint64_t _head = 0; // 生产者私有：下一个写入的位置
+        uint64_t _min_cursor = 0;       // 生产者私有：上次看到的最慢消费者位置
+    };
+
+} // namespace utils
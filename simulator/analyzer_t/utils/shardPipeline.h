@@ -0,0 +1,133 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <thread>
+#include <vector>
+
+namespace utils
+{
+
+    /* processes items in parallel by shard while keeping their order. The
+     * main thread appends items tagged with a shard to batches; one thread
+     * per shard runs work(shard, item) on the items of its shard in every
+     * batch, so all items of a shard are handled by the same thread in
+     * order. Finished batches come back to the main thread, in order,
+     * through emit(item). At most `depth` batches are in flight. */
+    template <typename T>
+    class ShardPipeline
+    {
+    public:
+        typedef std::function<void(int shard, T *item)> WorkFn;
+        typedef std::function<void(T *item)> EmitFn;
+
+        ShardPipeline(int num_shards, uint64_t batch_size, int depth, WorkFn work, EmitFn emit)
+            : _batches(depth), _batch_size(batch_size), _num_shards(num_shards), _work(work), _emit(emit)
+        {
+            for (auto &batch : _batches)
+            {
+                batch.items.resize(batch_size);
+                batch.shards.resize(batch_size);
+            }
+            for (int s = 0; s < num_shards; s++)
+            {
+                _workers.emplace_back(&ShardPipeline::_run, this, s);
+            }
+        }
+
+        ~ShardPipeline() { finish(); }
+
+        // 主线程：返回当前批次中属于shard的下一个位置，由调用者填入
+        inline T *add(int shard)
+        {
+            Batch &batch = _batches[_filling % _batches.size()];
+            if (batch.n == _batch_size)
+            {
+                _submit();
+                return add(shard);
+            }
+            batch.shards[batch.n] = shard;
+            return &batch.items[batch.n++];
+        }
+
+        // 主线程：提交最后一个批次，按顺序输出剩余的批次并结束分片线程
+        void finish()
+        {
+            if (_workers.empty())
+                return;
+            if (_batches[_filling % _batches.size()].n > 0)
+                _submit();
+            while (_emitted < _filling)
+                _emitOldest();
+            _closed.store(true, std::memory_order_release);
+            for (auto &worker : _workers)
+                worker.join();
+            _workers.clear();
+        }
+
+    private:
+        struct Batch
+        {
+            std::vector<T> items;
+            std::vector<int> shards;
+            uint64_t n = 0;
+            std::atomic<int> pending{0}; // 还没处理完这个批次的分片数
+        };
+
+        void _submit()
+        {
+            Batch &batch = _batches[_filling % _batches.size()];
+            batch.pending.store(_num_shards, std::memory_order_relaxed);
+            _filling++;
+            _submitted.store(_filling, std::memory_order_release);
+            // 下一个要填充的槽还在处理中时，等它完成并输出
+            if (_filling - _emitted == _batches.size())
+                _emitOldest();
+        }
+
+        void _emitOldest()
+        {
+            Batch &batch = _batches[_emitted % _batches.size()];
+            while (batch.pending.load(std::memory_order_acquire) != 0)
+                std::this_thread::yield();
+            for (uint64_t i = 0; i < batch.n; i++)
+                _emit(&batch.items[i]);
+            batch.n = 0;
+            _emitted++;
+        }
+
+        void _run(int shard)
+        {
+            for (uint64_t k = 0;; k++)
+            {
+                while (_submitted.load(std::memory_order_acquire) <= k)
+                {
+                    if (_closed.load(std::memory_order_acquire))
+                        return;
+                    std::this_thread::yield();
+                }
+                Batch &batch = _batches[k % _batches.size()];
+                for (uint64_t i = 0; i < batch.n; i++)
+                {
+                    if (batch.shards[i] == shard)
+                        _work(shard, &batch.items[i]);
+                }
+                batch.pending.fetch_sub(1, std::memory_order_release);
+            }
+        }
+
+        std::vector<Batch> _batches; // 按批次号取模的环形缓冲
+        uint64_t _batch_size;
+        int _num_shards;
+        WorkFn _work;
+        EmitFn _emit;
+        std::vector<std::thread> _workers;
+
+        uint64_t _filling = 0; // 主线程：正在填充的批次号
+        uint64_t _emitted = 0; // 主线程：下一个要输出的批次号
+        std::atomic<uint64_t> _submitted{0};
+        std::atomic<bool> _closed{false};
+    };
+
+} // namespace utils
@@ -0,0 +1,198 @@
+#pragma once
+
+#include <stdio.h>
+#include <algorithm>
+#include <cstdint>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "common/logging.h"
+#include "parsers/parser.hpp"
+
+namespace utils
+{
+
+    /* one request in a spill file: the fields the analysis modules read,
+     * including the annotations from the object metadata, packed to 82
+     * bytes. Times are relative to the start of the trace, 32 bits as in
+     * the object metadata */
+    struct SpillReq
+    {
+        uint64_t id;
+        int64_t req_num;
+        int64_t req_size;
+        int64_t next_access_vtime;
+        int64_t prev_size;
+        int64_t vtime_since_last_access;
+        int64_t vtime_since_last_update;
+        uint32_t time;
+        int32_t ttl;
+        int32_t create_rtime;
+        int32_t create_vtime;
+        int32_t rtime_since_last_access;
+        int32_t rtime_since_last_update;
+        uint8_t type;
+        uint8_t flags; // SPILL_*
+    } __attribute__((packed));
+
+    enum
+    {
+        SPILL_COMPULSORY_MISS = 1,
+        SPILL_OVERWRITE = 2,
+        SPILL_FIRST_SEEN_IN_WINDOW = 4,
+    };
+
+    static inline void toSpill(const parser::Request *req, SpillReq *r)
+    {
+        r->id = req->id;
+        r->req_num = req->req_num;
+        r->req_size = req->req_size;
+        r->next_access_vtime = req->next_access_vtime;
+        r->prev_size = req->prev_size;
+        r->vtime_since_last_access = req->vtime_since_last_access;
+        r->vtime_since_last_update = req->vtime_since_last_update;
+        r->time = (uint32_t)req->time;
+        r->ttl = req->ttl;
+        r->create_rtime = req->create_rtime;
+        r->create_vtime = req->create_vtime;
+        r->rtime_since_last_access = (int32_t)req->rtime_since_last_access;
+        r->rtime_since_last_update = (int32_t)req->rtime_since_last_update;
+        r->type = (uint8_t)req->type;
+        r->flags = (req->compulsory_miss ? SPILL_COMPULSORY_MISS : 0) |
+                   (req->overwrite ? SPILL_OVERWRITE : 0) |
+                   (req->first_seen_in_window ? SPILL_FIRST_SEEN_IN_WINDOW : 0);
+    }
+
+    // 只写入SpillReq中有的字段，req的其余字段不变
+    static inline void fromSpill(const SpillReq *r, parser::Request *req)
+    {
+        req->id = r->id;
+        req->req_num = r->req_num;
+        req->req_size = r->req_size;
+        req->next_access_vtime = r->next_access_vtime;
+        req->prev_size = r->prev_size;
+        req->vtime_since_last_access = r->vtime_since_last_access;
+        req->vtime_since_last_update = r->vtime_since_last_update;
+        req->time = r->time;
+        req->ttl = r->ttl;
+        req->create_rtime = r->create_rtime;
+        req->create_vtime = r->create_vtime;
+        req->rtime_since_last_access = r->rtime_since_last_access;
+        req->rtime_since_last_update = r->rtime_since_last_update;
+        req->type = (parser::req_op_e)r->type;
+        req->compulsory_miss = r->flags & SPILL_COMPULSORY_MISS;
+        req->overwrite = r->flags & SPILL_OVERWRITE;
+        req->first_seen_in_window = r->flags & SPILL_FIRST_SEEN_IN_WINDOW;
+        req->valid = true;
+    }
+
+    const uint64_t SPILL_BUFFER_BYTES = 1 << 20;        // 每个文件的最大缓冲区
+    const uint64_t SPILL_MIN_BUFFER_BYTES = 64 << 10;   // 每个文件的最小缓冲区
+    const uint64_t SPILL_TOTAL_BUFFER_BYTES = 64 << 20; // 同时打开的所有文件的缓冲区总量
+    const int SPILL_RESERVED_FDS = 32;                  // 留给trace、输出文件等的文件描述符
+
+    // n个文件同时打开时每个文件的缓冲区大小，总量不超过SPILL_TOTAL_BUFFER_BYTES
+    static inline uint64_t spillBufferBytes(int n_files)
+    {
+        return std::max(SPILL_MIN_BUFFER_BYTES,
+                        std::min(SPILL_BUFFER_BYTES, SPILL_TOTAL_BUFFER_BYTES / std::max(n_files, 1)));
+    }
+
+    /* paths of the spill files written and not yet removed, so they can be
+     * deleted before a spill error aborts the process (not static: one
+     * registry shared by every translation unit) */
+    inline std::mutex &spillFilesMutex()
+    {
+        static std::mutex mtx;
+        return mtx;
+    }
+
+    inline std::set<std::string> &spillFiles()
+    {
+        static std::set<std::string> paths;
+        return paths;
+    }
+
+    // 删除所有还存在的溢出文件
+    inline void removeSpillFiles()
+    {
+        std::lock_guard<std::mutex> lock(spillFilesMutex());
+        for (auto &path : spillFiles())
+        {
+            ::remove(path.c_str());
+        }
+        spillFiles().clear();
+    }
+
+    /* a file of SpillReq records written or read sequentially through a
+     * large stdio buffer, so the disk only sees long transfers. Files
+     * opened for writing are registered until remove(); on an I/O error
+     * all registered files are deleted before ERROR aborts */
+    class SpillFile
+    {
+    public:
+        SpillFile(const std::string &path, const char *mode, uint64_t buffer_bytes = SPILL_BUFFER_BYTES)
+            : _path(path), _buffer(buffer_bytes)
+        {
+            if (mode[0] == 'w')
+            {
+                std::lock_guard<std::mutex> lock(spillFilesMutex());
+                spillFiles().insert(path);
+            }
+            _file = fopen(path.c_str(), mode);
+            if (_file == nullptr)
+            {
+                removeSpillFiles();
+                ERROR("cannot open spill file %s\n", path.c_str());
+            }
+            setvbuf(_file, _buffer.data(), _IOFBF, _buffer.size());
+        }
+
+        ~SpillFile() { close(); }
+
+        inline void write(const SpillReq &r)
+        {
+            if (fwrite(&r, sizeof(r), 1, _file) != 1)
+            {
+                removeSpillFiles();
+                ERROR("cannot write spill file %s\n", _path.c_str());
+            }
+        }
+
+        // 读到文件末尾时返回false
+        inline bool read(SpillReq &r) { return fread(&r, sizeof(r), 1, _file) == 1; }
+
+        void close()
+        {
+            if (_file != nullptr)
+            {
+                int ret = fclose(_file);
+                _file = nullptr;
+                if (ret != 0) // 缓冲区中剩余的数据写入失败
+                {
+                    removeSpillFiles();
+                    ERROR("cannot write spill file %s\n", _path.c_str());
+                }
+            }
+        }
+
+        // 关闭并删除文件
+        void remove()
+        {
+            close();
+            std::lock_guard<std::mutex> lock(spillFilesMutex());
+            ::remove(_path.c_str());
+            spillFiles().erase(_path);
+        }
+
+        const std::string &path() const { return _path; }
+
+    private:
+        std::string _path;
+        std::vector<char> _buffer;
+        FILE *_file = nullptr;
+    };
+
+} // namespace utils
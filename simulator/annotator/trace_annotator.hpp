@@ -0,0 +1,306 @@
+#pragma once
+
+#include <stdint.h>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "analyzer_t/utils/robin_hood.h"
+#include "common/hash.hpp"
+#include "common/logging.h"
+#include "constants.hpp"
+#include "parsers/binary_parser.hpp"
+#include "lib/zstdReader.h"
+#include "parsers/parser.hpp"
+
+namespace annotator
+{
+
+    /* what the oracle knows about the future of one request */
+    struct NextAccess
+    {
+        int64_t vtime;         // 同一对象下一次请求的req_num，没有则为INT64_MAX
+        int64_t invalid_vtime; // 同一对象下一次写/删除请求（使当前版本失效）的req_num
+        uint8_t op;            // 下一次请求的类型，没有则为OP_INVALID
+    };
+
+    /* Annotates a fixed-size binary trace (IQQB and up) with next_access_vtime,
+     * next_access_op and future_invalid_time, producing IQQBQB or IQQBQBQ
+     * records that BinaryParser replays. vtimes are req_num values, ie the
+     * 1-based position in the trace, and INT64_MAX means "never".
+     *
+     * The trace is walked backwards in chunks of ANNOTATE_CHUNK_REQUESTS. Each
+     * chunk is grouped by id shard and the shards are processed on worker
+     * threads, every shard owning its own robin_hood map from id to the
+     * earliest future access seen so far, so no locking is needed. Input can
+     * be uncompressed or seekable zstd; a .zst output is written as seekable
+     * zstd. */
+    class TraceAnnotator
+    {
+    public:
+        TraceAnnotator(const std::string &in_path, const std::string &in_fmt, const std::string &out_path,
+                       const std::string &out_fmt, int num_threads) : _in_path(in_path), _out_path(out_path),
+                                                                      _num_threads(num_threads)
+        {
+            if (out_fmt != "IQQBQB" && out_fmt != "IQQBQBQ")
+            {
+                ERROR("annotated output format must be IQQBQB or IQQBQBQ, got %s\n", out_fmt.c_str());
+            }
+            if (in_fmt.compare(0, 4, "IQQB") != 0)
+            {
+                ERROR("input format must start with IQQB, got %s\n", in_fmt.c_str());
+            }
+            assert(num_threads > 0);
+            _in_size = cal_offset(in_fmt.c_str(), in_fmt.length() + 1);
+            _out_size = cal_offset(out_fmt.c_str(), out_fmt.length() + 1);
+            _with_invalid = out_fmt.length() == 7;
+            _maps.resize(parser::ANNOTATE_SHARDS);
+            _openInput();
+        }
+
+        ~TraceAnnotator()
+        {
+            if (_mapped != nullptr)
+            {
+                munmap(_mapped, _mapped_size);
+            }
+            if (_zstd != nullptr)
+            {
+                free_zstd_reader(_zstd);
+            }
+        }
+
+        void run()
+        {
+            size_t slen = _out_path.length();
+            bool zstd_out = slen > 4 && _out_path.substr(slen - 4) == ".zst";
+            std::string raw_path = zstd_out ? _out_path + ".tmp" : _out_path;
+            int fd = open(raw_path.c_str(), O_CREAT | O_TRUNC | O_WRONLY, 0644);
+            if (fd < 0 || ftruncate(fd, _num_records * _out_size) != 0)
+            {
+                ERROR("cannot create %s\n", raw_path.c_str());
+            }
+
+            // 从后向前逐块处理，输出按原顺序写到对应位置
+            std::vector<char> in_buf, out_buf;
+            std::vector<NextAccess> next(parser::ANNOTATE_CHUNK_REQUESTS);
+            uint64_t end = _num_records;
+            while (end > 0)
+            {
+                uint64_t begin = end > parser::ANNOTATE_CHUNK_REQUESTS ? end - parser::ANNOTATE_CHUNK_REQUESTS : 0;
+                uint64_t n = end - begin;
+                in_buf.resize(n * _in_size);
+                _readRecords(begin, n, in_buf.data());
+                _annotateChunk(in_buf.data(), begin, n, next.data());
+
+                out_buf.resize(n * _out_size);
+                for (uint64_t i = 0; i < n; i++)
+                {
+                    char *out = out_buf.data() + i * _out_size;
+                    memcpy(out, in_buf.data() + i * _in_size, 21); // IQQB
+                    memcpy(out + 21, &next[i].vtime, 8);
+                    out[29] = next[i].op;
+                    if (_with_invalid)
+                    {
+                        memcpy(out + 30, &next[i].invalid_vtime, 8);
+                    }
+                }
+                if (pwrite(fd, out_buf.data(), out_buf.size(), begin * _out_size) != (ssize_t)out_buf.size())
+                {
+                    ERROR("write to %s failed\n", raw_path.c_str());
+                }
+                end = begin;
+                INFO("annotated %lu/%lu requests, %lu objects\n", (unsigned long)(_num_records - begin),
+                     (unsigned long)_num_records, (unsigned long)_numObjects());
+            }
+            close(fd);
+
+            if (zstd_out)
+            {
+                if (zstd_write_seekable(raw_path.c_str(), _out_path.c_str(),
+                                        _out_size * parser::SEEKABLE_FRAME_REQUESTS, parser::COLUMNAR_ZSTD_LEVEL) != 0)
+                {
+                    ERROR("fail to compress %s\n", _out_path.c_str());
+                }
+                unlink(raw_path.c_str());
+            }
+        }
+
+        uint64_t numRecords() const { return _num_records; }
+
+    private:
+        typedef robin_hood::unordered_flat_map<uint64_t, NextAccess> ShardMap;
+
+        void _openInput()
+        {
+            size_t slen = _in_path.length();
+            if (slen > 4 && _in_path.substr(slen - 4) == ".zst")
+            {
+                _zstd = create_zstd_reader(_in_path.c_str());
+                if (_zstd->seek_table == NULL)
+                {
+                    ERROR("%s is not seekable, recompress it with trace_converter --seekable\n", _in_path.c_str());
+                }
+                _num_records = _zstd->seek_table->d_offsets[_zstd->seek_table->num_frames] / _in_size;
+                return;
+            }
+
+            int fd = open(_in_path.c_str(), O_RDONLY);
+            struct stat st;
+            if (fd < 0 || fstat(fd, &st) != 0)
+            {
+                ERROR("cannot open %s\n", _in_path.c_str());
+            }
+            _mapped_size = st.st_size;
+            _num_records = _mapped_size / _in_size;
+            if (_mapped_size > 0)
+            {
+                _mapped = (char *)mmap(nullptr, _mapped_size, PROT_READ, MAP_SHARED, fd, 0);
+                if (_mapped == MAP_FAILED)
+                {
+                    ERROR("cannot mmap %s\n", _in_path.c_str());
+                }
+            }
+            close(fd);
+        }
+
+        void _readRecords(uint64_t begin, uint64_t n, char *dst)
+        {
+            if (_zstd == nullptr)
+            {
+                memcpy(dst, _mapped + begin * _in_size, n * _in_size);
+                return;
+            }
+            if (zstd_reader_seek(_zstd, begin * _in_size) != 0)
+            {
+                ERROR("fail to seek %s\n", _in_path.c_str());
+            }
+            char *record;
+            for (uint64_t i = 0; i < n; i++)
+            {
+                if (zstd_reader_read_bytes(_zstd, _in_size, &record) != _in_size)
+                {
+                    ERROR("fail to read %s\n", _in_path.c_str());
+                }
+                memcpy(dst + i * _in_size, record, _in_size);
+            }
+        }
+
+        static bool _invalidates(uint8_t op)
+        {
+            switch (op)
+            {
+            case parser::OP_SET:
+            case parser::OP_ADD:
+            case parser::OP_CAS:
+            case parser::OP_REPLACE:
+            case parser::OP_APPEND:
+            case parser::OP_PREPEND:
+            case parser::OP_DELETE:
+            case parser::OP_INCR:
+            case parser::OP_DECR:
+            case parser::OP_WRITE:
+            case parser::OP_UPDATE:
+                return true;
+            default:
+                return false;
+            }
+        }
+
+        void _annotateChunk(const char *in, uint64_t begin, uint64_t n, NextAccess *next)
+        {
+            // 块内请求按分片做稳定的计数排序
+            std::vector<uint32_t> offsets(parser::ANNOTATE_SHARDS + 1, 0);
+            _shard_of.resize(n);
+            _order.resize(n);
+            for (uint64_t i = 0; i < n; i++)
+            {
+                uint64_t id;
+                memcpy(&id, in + i * _in_size + 4, 8);
+                _shard_of[i] = misc::fastRange(misc::mix64(id, parser::ANNOTATE_SHARD_SEED), parser::ANNOTATE_SHARDS);
+                offsets[_shard_of[i] + 1]++;
+            }
+            for (uint64_t s = 0; s < parser::ANNOTATE_SHARDS; s++)
+            {
+                offsets[s + 1] += offsets[s];
+            }
+            std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+            for (uint64_t i = 0; i < n; i++)
+            {
+                _order[fill[_shard_of[i]]++] = i;
+            }
+
+            auto work = [&](int t)
+            {
+                for (uint64_t s = t; s < parser::ANNOTATE_SHARDS; s += _num_threads)
+                {
+                    ShardMap &map = _maps[s];
+                    // 分片内从后向前处理
+                    for (uint32_t k = offsets[s + 1]; k-- > offsets[s];)
+                    {
+                        uint32_t i = _order[k];
+                        const char *record = in + i * _in_size;
+                        uint64_t id;
+                        memcpy(&id, record + 4, 8);
+                        uint8_t op = record[20];
+                        int64_t vtime = begin + i + 1;
+
+                        auto it = map.find(id);
+                        if (it == map.end())
+                        {
+                            next[i] = {INT64_MAX, INT64_MAX, parser::OP_INVALID};
+                            map[id] = {vtime, _invalidates(op) ? vtime : INT64_MAX, op};
+                        }
+                        else
+                        {
+                            next[i] = it->second;
+                            it->second = {vtime, _invalidates(op) ? vtime : it->second.invalid_vtime, op};
+                        }
+                    }
+                }
+            };
+            std::vector<std::thread> workers;
+            for (int t = 1; t < _num_threads; t++)
+            {
+                workers.emplace_back(work, t);
+            }
+            work(0);
+            for (auto &worker : workers)
+            {
+                worker.join();
+            }
+        }
+
+        uint64_t _numObjects() const
+        {
+            uint64_t n = 0;
+            for (auto &map : _maps)
+            {
+                n += map.size();
+            }
+            return n;
+        }
+
+        std::string _in_path;
+        std::string _out_path;
+        int _num_threads;
+        size_t _in_size;
+        size_t _out_size;
+        bool _with_invalid;
+        uint64_t _num_records = 0;
+
+        char *_mapped = nullptr;
+        size_t _mapped_size = 0;
+        zstd_reader *_zstd = nullptr;
+
+        std::vector<ShardMap> _maps; // 每个分片一个map，只由一个线程访问
+        std::vector<uint16_t> _shard_of;
+        std::vector<uint32_t> _order;
+    };
+
+} // namespace annotator
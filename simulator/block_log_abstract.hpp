@@ -1,11 +1,14 @@
 #pragma once
 
 #include <vector>
+#include <array>
 #include <list>
+#include <memory>
 #include "block.hpp"
 #include "stats/stats.hpp"
 #include "common/macro.h"
 #include "common/logging.h"
+#include "common/mem_usage.hpp"
 
 namespace flashCache
 {
@@ -17,6 +20,8 @@ namespace flashCache
         uint64_t _size;                       // 段中有效块数据量
         uint64_t _write_point;                // 已经写入了多少字节
         bool _is_virtual = false;             // 用于RIPQ，是否是虚拟段
+        bool _sealed = false;                 // 是否已写满封闭
+        uint64_t _seal_request = 0;           // 封闭时的请求编号
 
         Segment() { reset(); }
 
@@ -44,6 +49,7 @@ namespace flashCache
             _items.clear();
             _size = 0;
             _write_point = 0;
+            _sealed = false;
             // _is_virtual = false;
         }
     };
@@ -149,7 +155,76 @@ namespace flashCache
             }
         }
 
+        /* probes the pages lba..lba+count-1 in one call, hit[i] is set for
+         * every page present; stats are added once for the whole range.
+         * Returns the number of pages found */
+        virtual uint64_t findRange(uint64_t lba, uint64_t count, bool updateStats, char *hit)
+        {
+            uint64_t hits = 0;
+            for (uint64_t i = 0; i < count; i++)
+            {
+                auto it = _item_active.find(lba + i);
+                hit[i] = it != _item_active.end();
+                if (hit[i])
+                {
+                    hits++;
+                    if (updateStats)
+                        _segments[it->second]->_items[lba + i].hit_count++;
+                }
+            }
+            if (updateStats)
+            {
+                _log_stats["hits"] += hits;
+                _log_stats["misses"] += count - hits;
+            }
+            return hits;
+        }
+
+        /* ----------- GC telemetry --------------- */
+
+        /* opens the GC event trace, one record per segment reclaimed by GC
+         * or flushed by the log (columns in GC_TRACE_COLUMNS), and turns on
+         * the sealed-segment valid ratio histogram */
+        void enableGCTrace(const std::string &path)
+        {
+            _gc_trace.reset(new stats::EventStream(path, GC_TRACE_COLUMNS));
+            _seal_hist = &_log_stats.createChild("sealedValidRatio");
+        }
+
+        // 当前请求编号和时间戳，GC事件和段的封闭时间以此记录
+        void setClock(uint64_t request, int64_t time)
+        {
+            _req_num = request;
+            _req_time = time;
+        }
+
+        bool gcTraceEnabled() { return _gc_trace != nullptr; }
+
+        /* histogram of the valid ratio of all sealed segments in 5% buckets
+         * ("0" is [0%, 5%), "100" is completely valid), called at each
+         * stats dump */
+        void recordSealedValidRatio()
+        {
+            if (_seal_hist == nullptr)
+            {
+                return;
+            }
+            int64_t hist[21] = {0};
+            for (auto *segment : _segments)
+            {
+                if (segment->_sealed && !segment->_is_virtual)
+                {
+                    hist[segment->_size * 20 / Segment::_capacity]++;
+                }
+            }
+            for (int i = 0; i <= 20; i++)
+            {
+                (*_seal_hist)[std::to_string(i * 5)] = hist[i];
+            }
+        }
+
         int64_t get_current_size() { return _current_size; }
+        uint64_t get_num_items() { return _item_active.size(); }
         int64_t get_total_size() { return _total_capacity; }
         int64_t get_segments_num() { return _segments.size(); }
 
@@ -199,6 +274,16 @@ namespace flashCache
             _log_stats["num_rejected_from_sets"] = 0;
         }
 
+        /* registers the DRAM index (_item_active) and the per-segment
+         * item maps with the memory accounting, names are prefixed */
+        virtual void registerMemory(misc::MemoryAccounting &mem, const std::string &name)
+        {
+            mem.add(name + "ItemActive", [this]() { return misc::hashTableBytes(_item_active); },
+                    [this]() { return (uint64_t)_item_active.size(); });
+            mem.add(name + "SegmentItems", [this]() { return _segmentsMemoryBytes(); },
+                    [this]() { return _segmentsNumItems(); });
+        }
+
         void printSegment()
         {
             int64_t temptotSize = 0;
@@ -233,6 +318,55 @@ namespace flashCache
             // assert(_size_inserts == _segments[_active_segment]._size);
         }
 
+        uint64_t _segmentsMemoryBytes()
+        {
+            uint64_t bytes = _segments.capacity() * sizeof(Segment *);
+            for (auto *segment : _segments)
+                bytes += misc::mallocBytes(sizeof(Segment)) + misc::hashTableBytes(segment->_items);
+            return bytes;
+        }
+
+        uint64_t _segmentsNumItems()
+        {
+            uint64_t items = 0;
+            for (auto *segment : _segments)
+                items += segment->_items.size();
+            return items;
+        }
+
+        void _sealSegment(Segment &segment)
+        {
+            segment._sealed = true;
+            segment._seal_request = _req_num;
+        }
+
+        /* GC trace record of a segment about to be reclaimed or flushed,
+         * taken before the segment is reset; the caller fills in the free
+         * segment counts and hands it to _gc_trace */
+        enum
+        {
+            GC_FREE_BEFORE = 9,
+            GC_FREE_AFTER = 10,
+            GC_TRACE_WIDTH = 11
+        };
+        typedef std::array<int64_t, GC_TRACE_WIDTH> GCRecord;
+
+        GCRecord _gcRecord(uint32_t segment_idx, uint64_t rewritten, uint64_t evicted)
+        {
+            const Segment &segment = *_segments[segment_idx];
+            return {(int64_t)_num_gc,
+                    _req_time,
+                    (int64_t)_req_num,
+                    segment_idx,
+                    (int64_t)(segment._size / Block::_capacity),
+                    (int64_t)(segment._size * 1000000 / Segment::_capacity),
+                    segment._sealed ? (int64_t)(_req_num - segment._seal_request) : -1,
+                    (int64_t)rewritten,
+                    (int64_t)evicted,
+                    0,
+                    0};
+        }
+
         void init_segments()
         {
             _segments.resize(_num_segments);
@@ -256,6 +390,16 @@ namespace flashCache
         int32_t _num_segments;   // 段数量
 
         stats::LocalStatsCollector &_log_stats;
+
+        std::unique_ptr<stats::EventStream> _gc_trace;     // GC事件流，未开启时为空
+        stats::LocalStatsCollector *_seal_hist = nullptr; // 封闭段有效率直方图
+        uint64_t _num_gc = 0;                              // GC（或刷新）事件编号
+        uint64_t _req_num = 0;
+        int64_t _req_time = 0;
+
+        inline static const std::vector<std::string> GC_TRACE_COLUMNS = {
+            "gc", "time", "request", "segment", "validBlocks", "validPpm",
+            "sealAge", "rewrittenBlocks", "evictedBlocks", "freeBefore", "freeAfter"};
     };
 
 } // namespace flashCache
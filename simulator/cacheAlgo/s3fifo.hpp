@@ -311,6 +311,10 @@ namespace CacheAlgo
 
                     has_evicted = true;
                     evicted = obj_to_evict->obj_id;
+                    if (eviction_regret != nullptr)
+                    {
+                        eviction_regret->evicted(evicted, stats::EvictionRegret::SOURCE_SMALL_FIFO);
+                    }
                     // if (obj_to_evict->obj_id == 0)
                     // {
                     //     ERROR("obj id %lu, freq %d\n", obj_to_evict->obj_id, obj_to_evict->S3FIFO.freq);
@@ -366,6 +370,10 @@ namespace CacheAlgo
 #endif
                     has_evicted = true;
                     evicted = obj_to_evict->obj_id;
+                    if (eviction_regret != nullptr)
+                    {
+                        eviction_regret->evicted(evicted, stats::EvictionRegret::SOURCE_MAIN_FIFO);
+                    }
                     // if (obj_to_evict->obj_id == 0)
                     // {
                     //     ERROR("obj id %lu, freq %d\n", obj_to_evict->obj_id, obj_to_evict->S3FIFO.freq);
@@ -394,7 +402,7 @@ namespace CacheAlgo
             }
             obj_id_t evicted = S3FIFO_evict_fifo(req);
             int64_t test_size2 = get_current_size();
-            if (test_size1 - test_size2 != 4096)
+            if (test_size1 - test_size2 != (int64_t)Block::_capacity)
             {
                 ERROR("req id: %lu, evicted id %lu, evict size error: %ld\n", req->id, evicted, test_size1 - test_size2);
                 abort();
@@ -428,6 +436,14 @@ namespace CacheAlgo
             return req->req_size <= fifo->cache_size;
         }
 
+        void register_memory(misc::MemoryAccounting &mem, const std::string &name)
+        {
+            fifo->register_memory(mem, name + "Small");
+            main_cache->register_memory(mem, name + "Main");
+            if (fifo_ghost != NULL)
+                fifo_ghost->register_memory(mem, name + "Ghost");
+        }
+
         void print_cache()
         {
             printf("FIFO: ");
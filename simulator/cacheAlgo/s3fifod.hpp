@@ -443,6 +443,10 @@ namespace CacheAlgo
                 // insert to ghost
                 fifo_ghost->set(req_local, true);
                 fifo_eviction->set(req_local, true);
+                if (eviction_regret != nullptr)
+                {
+                    eviction_regret->evicted(req_local->id, stats::EvictionRegret::SOURCE_SMALL_FIFO);
+                }
             }
             return evict_obj_id;
 
@@ -474,6 +478,10 @@ namespace CacheAlgo
                 // insert to ghost
                 fifo_ghost->set(req_local, true);
                 fifo_eviction->set(req_local, true);
+                if (eviction_regret != nullptr)
+                {
+                    eviction_regret->evicted(req_local->id, stats::EvictionRegret::SOURCE_SMALL_FIFO);
+                }
             }
             return evict_obj_id;
 #endif
@@ -534,6 +542,10 @@ namespace CacheAlgo
                 // insert to ghost
                 fifo_ghost->set(req_local, true);
                 fifo_eviction->set(req_local, true);
+                if (eviction_regret != nullptr)
+                {
+                    eviction_regret->evicted(req_local->id, stats::EvictionRegret::SOURCE_SMALL_FIFO);
+                }
             }
             return evicted;
 
@@ -565,6 +577,10 @@ namespace CacheAlgo
                 // insert to ghost
                 fifo_ghost->set(req_local, true);
                 fifo_eviction->set(req_local, true);
+                if (eviction_regret != nullptr)
+                {
+                    eviction_regret->evicted(req_local->id, stats::EvictionRegret::SOURCE_SMALL_FIFO);
+                }
             }
             return evicted;
 #endif
@@ -596,6 +612,21 @@ namespace CacheAlgo
             return req->req_size <= fifo->cache_size;
         }
 
+        // 主队列通过自身的evict驱逐，由它记录；试用队列的驱逐在本类中记录
+        void set_eviction_regret(stats::EvictionRegret *regret, stats::EvictionRegret::Source source)
+        {
+            eviction_regret = regret;
+            main_cache->set_eviction_regret(regret, stats::EvictionRegret::SOURCE_MAIN_FIFO);
+        }
+
+        void register_memory(misc::MemoryAccounting &mem, const std::string &name)
+        {
+            fifo->register_memory(mem, name + "Small");
+            main_cache->register_memory(mem, name + "Main");
+            if (fifo_ghost != NULL)
+                fifo_ghost->register_memory(mem, name + "Ghost");
+        }
+
         void print_cache()
         {
             printf("FIFO: ");
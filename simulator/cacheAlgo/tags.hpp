@@ -2,6 +2,7 @@
 
 #include <unordered_map>
 #include "cache_obj.h"
+#include "common/mem_usage.hpp"
 #include "parsers/parser.hpp"
 
 struct Tags
@@ -66,4 +67,10 @@ struct Tags
         this->erase(itr); // 删除对象索引
         return entry;     // 返回链表节点
     }
+
+    // hash表加上每个对象的链表节点
+    uint64_t memoryBytes() const
+    {
+        return misc::hashTableBytes(*this) + this->size() * misc::mallocBytes(sizeof(cache_obj_t));
+    }
 };
\ No newline at end of file
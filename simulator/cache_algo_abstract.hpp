@@ -4,8 +4,12 @@
 #include "cacheAlgo/cache_obj.h"
 #include "cacheAlgo/tags.hpp"
 #include "parsers/parser.hpp"
+#include "stats/eviction_regret.hpp"
+#include "common/log_bucket.hpp"
 #include "common/logging.h"
 #include "common/macro.h"
+#include "common/mem_usage.hpp"
+#include "common/profile.hpp"
 
 namespace CacheAlgo
 {
@@ -108,6 +112,13 @@ namespace CacheAlgo
             log_eviction_age_cnt[age_log2] += 1;
         }
 
+        // log_eviction_age_cnt的分桶边界，只计算一次
+        static const misc::LogBuckets &eviction_age_buckets()
+        {
+            static const misc::LogBuckets buckets(EVICTION_AGE_LOG_BASE, EVICTION_AGE_ARRAY_SZE);
+            return buckets;
+        }
+
         void record_eviction_age(cache_obj_t *obj, const int64_t age)
         {
 #if defined(TRACK_EVICTION_V_AGE)
@@ -118,9 +129,7 @@ namespace CacheAlgo
             }
 #endif
 
-            double log_base = log(EVICTION_AGE_LOG_BASE);
-            int age_log = age == 0 ? 0 : (int)ceil(log((double)age) / log_base);
-            log_eviction_age_cnt[age_log] += 1;
+            log_eviction_age_cnt[eviction_age_buckets().bucket(age)] += 1;
         }
 
         void print_log2_eviction_age()
@@ -249,6 +258,19 @@ namespace CacheAlgo
             return true;
         }
 
+        // 登记DRAM占用，默认只有tags；由多个队列组成的算法按队列分别登记
+        virtual void register_memory(misc::MemoryAccounting &mem, const std::string &name)
+        {
+            mem.add(name, [this]() { return tags.memoryBytes(); }, [this]() { return (uint64_t)tags.size(); });
+        }
+
+        // 开启驱逐后悔统计，本算法的驱逐记为source；组合算法按子队列区分来源
+        virtual void set_eviction_regret(stats::EvictionRegret *regret, stats::EvictionRegret::Source source)
+        {
+            eviction_regret = regret;
+            eviction_source = source;
+        }
+
         void record_current_size()
         {
             cache_algo_stats["current_size"] = get_current_size();
@@ -307,6 +329,7 @@ namespace CacheAlgo
                 while (get_current_size() + req->req_size + obj_md_size >
                        cache_size)
                 {
+                    PROFILE_SCOPE(misc::PHASE_EVICT);
                     evict(req);
                 }
                 insert(req);
@@ -328,6 +351,7 @@ namespace CacheAlgo
             while (get_current_size() + req->req_size - old_size >
                    cache_size)
             {
+                PROFILE_SCOPE(misc::PHASE_EVICT);
                 evicted.push_back(evict(req));
             }
 
@@ -380,6 +404,10 @@ namespace CacheAlgo
             }
 #endif
 
+            if (eviction_regret != nullptr)
+            {
+                eviction_regret->evicted(obj->obj_id, eviction_source);
+            }
             cache_remove_obj_base(obj, remove_from_hashtable);
         }
 
@@ -422,6 +450,9 @@ namespace CacheAlgo
         int64_t obj_num;
         int64_t current_size;
 
+        stats::EvictionRegret *eviction_regret = nullptr;
+        stats::EvictionRegret::Source eviction_source = stats::EvictionRegret::SOURCE_CACHE_ALGO;
+
         stats::LocalStatsCollector &cache_algo_stats;
     };
 }
\ No newline at end of file
@@ -8,6 +8,7 @@
 #include "caches/block_cache.hpp"
 #include "caches/block_rw_partition_cache.hpp"
 #include "common/logging.h"
+#include "common/profile.hpp"
 
 namespace cache
 {
@@ -20,31 +21,87 @@ namespace cache
 
         uint64_t block_size = (uint64_t)cfg.read<int>("log.blockSize", 4096);
         Block::_capacity = block_size;
+        _page_size = block_size;
 
         uint64_t segment_size = (uint64_t)cfg.read<int>("log.segmentSizeMB", 2) * 1024 * 1024;
 
+        // 块缓存模式：日志和替换算法以块为单位管理，页的有效性由块内位图记录
+        uint64_t chunk_size = (uint64_t)cfg.read<int>("cache.chunkSizeKB", 0) * 1024;
+        if (chunk_size > 0)
+        {
+            if (chunk_size % block_size != 0 || segment_size % chunk_size != 0)
+            {
+                ERROR("chunk size %lu must be a multiple of the block size %lu and divide the segment size %lu\n",
+                      chunk_size, block_size, segment_size);
+            }
+            if (cfg.exists("cache.enabledRWPartition"))
+            {
+                ERROR("chunked caching does not support cache.enabledRWPartition\n");
+            }
+            Block::_capacity = chunk_size;
+            _chunks = new ChunkIndex(chunk_size / block_size);
+            std::string fill = cfg.read<const char *>("cache.chunkFill", "full");
+            if (fill != "full" && fill != "partial")
+            {
+                ERROR("unknown cache.chunkFill %s\n", fill.c_str());
+            }
+            _chunk_full_fill = fill == "full";
+            INFO("Chunked caching: %lu KB chunks of %u pages, %s fill\n", chunk_size / 1024, _chunks->subBlocks(),
+                 fill.c_str());
+        }
+
         flashCache::Segment::_capacity = segment_size;
         DEBUG("segment _capacity: %lu, segment_size: %lu\n", flashCache::Segment::_capacity, segment_size);
 
         // uint64_t readmit = cfg.read<int>("log.readmit", 0);
 
         /* Initialize prelog admission policy */
-        // if (cfg.exists("preLogAdmission")) // 是否使用准入策略
-        // {
-        //     std::string policyType = cfg.read<const char *>("preLogAdmission.policy");
-        //     std::cout << "Creating admission policy of type " << policyType << std::endl;
-        //     policyType.append(".preLogAdmission");
-        //     const libconfig::Setting &admission_settings = cfg.read<libconfig::Setting &>("preLogAdmission");
-        //     auto &admission_stats = statsCollector->createLocalCollector(policyType);
-        //     // _prelog_admission = admission::Policy::create(admission_settings, nullptr, _log, admission_stats);
-        // }
+        if (cfg.exists("preLogAdmission")) // 是否使用准入策略
+        {
+            std::string policyType = cfg.read<const char *>("preLogAdmission.policy");
+            // 块缓存没有集合缓存和日志对象，依赖它们的准入策略（如Threshold）无法使用
+            if (policyType != "Random" && policyType != "Learned")
+            {
+                ERROR("block caches only support Random or Learned preLogAdmission, not %s\n", policyType.c_str());
+            }
+            std::cout << "Creating admission policy of type " << policyType << std::endl;
+            policyType.append(".preLogAdmission");
+            const libconfig::Setting &admission_settings = cfg.read<libconfig::Setting &>("preLogAdmission");
+            auto &admission_stats = statsCollector->createLocalCollector(policyType);
+            // 块缓存没有集合缓存，准入策略只能使用admit_simple
+            _prelog_admission = admission::Policy::create(admission_settings, nullptr, nullptr, admission_stats);
+        }
 
         // 打印统计信息的间隔
         _stats_interval = pow(10, stats_power);
+
+        // 与BlockBinaryParser共用trace.extentMode，一个请求覆盖req_size字节的连续页
+        _extent_mode = cfg.read<bool>("trace.extentMode", false);
+
+        _regret_entries = cfg.read<int>("stats.evictionRegretEntries", 0);
+        _gc_trace_path = cfg.read<const char *>("log.gcTraceFile", "");
+
+        int wss_windows = cfg.read<int>("stats.wssSlidingWindows", 0);
+        if (wss_windows > 0)
+        {
+            _wss = new misc::WindowedCardinality(wss_windows);
+            _wss_stats = &globalStats.createChild("wss");
+        }
+
+#ifdef PROFILE_PHASES
+        if (cfg.read<bool>("stats.perfCounters", false))
+        {
+            misc::Profiler::get().enablePerf();
+        }
+#endif
     }
 
     BlockCache::~BlockCache()
     {
+        delete _chunks;
+        delete _regret;
+        delete _wss;
+        delete _prelog_admission;
         delete statsCollector;
     }
 
@@ -57,7 +114,7 @@ namespace cache
         /* initialize stats collection */
         // 打印输出到的文件路径
         std::string filename = cfg.read<const char *>("stats.outputFile");
-        auto sc = new stats::StatsCollector(filename);
+        auto sc = new stats::StatsCollector(filename, cfg.read<const char *>("stats.format", "json"));
         // 创建一个统计信息收集器，命名为global
         auto &gs = sc->createLocalCollector("global");
 
@@ -92,6 +149,16 @@ namespace cache
     void BlockCache::access(const parser::Request *req)
     {
         assert(req->req_size >= 0);
+        if (_chunks != nullptr)
+        {
+            _accessChunks(req);
+            return;
+        }
+        if (_extent_mode)
+        {
+            _accessExtent(req);
+            return;
+        }
         // 统计读写请求
         if (req->type != parser::OP_GET && req->type != parser::OP_SET)
         {
@@ -167,6 +234,289 @@ namespace cache
         }
     }
 
+    /* same bookkeeping as access() for a whole extent: pages are probed in
+     * one findRange, hit runs of a SET are updated and miss runs inserted
+     * with one call per run, and the page-level counters are bumped once
+     * per extent. GETs are also classified at request level as full hits,
+     * partial hits or misses. */
+    void BlockCache::_accessExtent(const parser::Request *req)
+    {
+        if (req->type != parser::OP_GET && req->type != parser::OP_SET)
+        {
+            return;
+        }
+        uint64_t pages = (req->req_size + Block::_capacity - 1) / Block::_capacity;
+        if (pages == 0)
+        {
+            return;
+        }
+
+        parser::Request page = *req;
+        page.req_size = Block::_capacity;
+        _extent_hits.resize(pages);
+        uint64_t hits = findRange(&page, pages, _extent_hits.data());
+        uint64_t misses = pages - hits;
+
+        // 对命中/未命中的连续页段分别处理，fn(首页下标, 页数)
+        auto forRuns = [&](char hit, auto fn)
+        {
+            for (uint64_t i = 0; i < pages;)
+            {
+                if (_extent_hits[i] != hit)
+                {
+                    i++;
+                    continue;
+                }
+                uint64_t j = i + 1;
+                while (j < pages && _extent_hits[j] == hit)
+                    j++;
+                fn(i, j - i);
+                i = j;
+            }
+        };
+
+        if (req->type == parser::OP_SET && hits > 0)
+        {
+            forRuns(1, [&](uint64_t first, uint64_t count)
+                    {
+                        page.id = req->id + first;
+                        this->updateRange(&page, count); });
+            globalStats["updateCount"] += hits;
+            globalStats["updateSize"] += hits * Block::_capacity;
+        }
+        if (req->type == parser::OP_GET)
+        {
+            globalStats["hits"] += hits;
+            globalStats["hitsSize"] += hits * Block::_capacity;
+            globalStats["misses"] += misses;
+            globalStats["missesSize"] += misses * Block::_capacity;
+            // 请求级别的命中统计
+            globalStats["requestGets"]++;
+            if (misses == 0)
+                globalStats["requestFullHits"]++;
+            else if (hits == 0)
+                globalStats["requestMisses"]++;
+            else
+                globalStats["requestPartialHits"]++;
+        }
+
+        uint64_t before = getTotalAccesses();
+        trackAccesses(req->type, pages);
+        // 统计强制不命中数以及WSS
+        uint64_t compulsory = 0, unique = 0;
+        for (uint64_t i = 0; i < pages; i++)
+        {
+            bool &seen = _historyAccess[req->id + i];
+            if (!seen)
+            {
+                seen = true;
+                unique++;
+            }
+            if (_wss != nullptr)
+            {
+                _wss->add(req->id + i, Block::_capacity);
+            }
+        }
+        if (req->type == parser::OP_GET)
+            compulsory = unique;
+        globalStats["compulsoryMisses"] += compulsory;
+        globalStats["uniqueBytes"] += unique * Block::_capacity;
+
+        if ((_stats_interval > 0) && (before / _stats_interval != getTotalAccesses() / _stats_interval))
+        {
+            dumpStats();
+        }
+
+        if (misses > 0)
+        {
+            forRuns(0, [&](uint64_t first, uint64_t count)
+                    {
+                        page.id = req->id + first;
+                        this->insertRange(&page, count); });
+        }
+    }
+
+    /* chunk-granular access: the log and the cache algorithm only ever see
+     * whole chunks (id = chunk number, size = chunk size) while hits,
+     * misses and the other page-level counters are still kept per page from
+     * the chunk's valid bitmap, so miss rates are comparable with page mode.
+     * Filling missing pages of a cached chunk or writing to it rewrites the
+     * whole chunk; chunkWrittenBytes / chunkRequestedBytes is that fill
+     * amplification on top of the log's own write amplification. */
+    void BlockCache::_accessChunks(const parser::Request *req)
+    {
+        if (req->type != parser::OP_GET && req->type != parser::OP_SET)
+        {
+            return;
+        }
+        uint64_t pages = _extent_mode ? (req->req_size + _page_size - 1) / _page_size : 1;
+        if (pages == 0)
+        {
+            return;
+        }
+
+        uint32_t spc = _chunks->subBlocks();
+        uint64_t first = req->id, end = req->id + pages;
+        uint64_t hits = 0, updates = 0, requested = 0, written = 0, new_chunks = 0;
+        parser::Request creq = *req;
+        creq.req_size = Block::_capacity;
+        for (uint64_t c = first / spc; c <= (end - 1) / spc; c++)
+        {
+            uint32_t s = std::max(first, c * spc) - c * spc;
+            uint32_t e = std::min(end, (c + 1) * spc) - c * spc;
+            creq.id = c;
+            bool present = this->find(&creq);
+            uint64_t *bits = _chunks->find(c);
+            if (!present && bits != nullptr)
+            {
+                // 块已经被日志驱逐，回收其位图
+                _dropChunk(c, bits);
+                bits = nullptr;
+            }
+            else if (present && bits == nullptr)
+            {
+                bits = _chunks->insert(c);
+                ChunkIndex::set(bits, 0, spc);
+            }
+            uint64_t valid = present ? ChunkIndex::count(bits, s, e) : 0;
+
+            if (req->type == parser::OP_GET)
+            {
+                hits += valid;
+                if (valid == e - s)
+                    continue;
+                // 读缺失：从后端读取并填充
+                requested += (e - s - valid) * _page_size;
+                if (!present)
+                    bits = _chunks->insert(c);
+                if (_chunk_full_fill)
+                    ChunkIndex::set(bits, 0, spc);
+                else
+                    ChunkIndex::set(bits, s, e);
+            }
+            else
+            {
+                updates += valid;
+                requested += (e - s) * _page_size;
+                if (!present)
+                    bits = _chunks->insert(c);
+                ChunkIndex::set(bits, s, e);
+                ChunkIndex::set(bits + _chunks->words(), s, e);
+            }
+
+            written += Block::_capacity;
+            // 读填充不改变块的脏状态：块中有脏页时块才是脏的
+            if (present)
+                this->rewrite(&creq, ChunkIndex::count(bits + _chunks->words(), 0, spc) > 0);
+            else
+            {
+                this->insert(&creq);
+                new_chunks++;
+            }
+        }
+        // 每新增一个块检查两个旧块，被驱逐块的位图回收速度不低于新增速度
+        _sweepChunks(2 * new_chunks);
+
+        uint64_t misses = pages - hits;
+        if (req->type == parser::OP_GET)
+        {
+            globalStats["hits"] += hits;
+            globalStats["hitsSize"] += hits * _page_size;
+            globalStats["misses"] += misses;
+            globalStats["missesSize"] += misses * _page_size;
+            globalStats["requestGets"]++;
+            if (misses == 0)
+                globalStats["requestFullHits"]++;
+            else if (hits == 0)
+                globalStats["requestMisses"]++;
+            else
+                globalStats["requestPartialHits"]++;
+        }
+        else
+        {
+            globalStats["updateCount"] += updates;
+            globalStats["updateSize"] += updates * _page_size;
+        }
+        globalStats["chunkRequestedBytes"] += requested;
+        globalStats["chunkWrittenBytes"] += written;
+
+        uint64_t before = getTotalAccesses();
+        trackAccesses(req->type, pages);
+        uint64_t unique = 0;
+        for (uint64_t p = first; p < end; p++)
+        {
+            bool &seen = _historyAccess[p];
+            if (!seen)
+            {
+                seen = true;
+                unique++;
+            }
+            if (_wss != nullptr)
+            {
+                _wss->add(p, _page_size);
+            }
+        }
+        if (req->type == parser::OP_GET)
+            globalStats["compulsoryMisses"] += unique;
+        globalStats["uniqueBytes"] += unique * _page_size;
+
+        if ((_stats_interval > 0) && (before / _stats_interval != getTotalAccesses() / _stats_interval))
+        {
+            dumpStats();
+        }
+    }
+
+    void BlockCache::_dropChunk(uint64_t chunk, const uint64_t *bits)
+    {
+        // 驱逐时脏页需要写回后端
+        globalStats["chunkDirtyPagesEvicted"] += ChunkIndex::count(bits + _chunks->words(), 0, _chunks->subBlocks());
+        _chunks->erase(chunk);
+    }
+
+    /* reclaims bitmaps of chunks the log has evicted, checking the next n
+     * slots of the index. Called for every new chunk, so the index tracks
+     * the cached chunks without a full walk at each stats dump */
+    void BlockCache::_sweepChunks(uint64_t n)
+    {
+        _chunks->sweep(n, [&](uint64_t chunk, uint64_t *bits)
+                       {
+                           if (!_log->find(chunk))
+                               _dropChunk(chunk, bits); });
+    }
+
+    uint64_t BlockCache::findRange(const parser::Request *page, uint64_t count, char *hit)
+    {
+        parser::Request cur = *page;
+        uint64_t hits = 0;
+        for (uint64_t i = 0; i < count; i++)
+        {
+            cur.id = page->id + i;
+            hit[i] = this->find(&cur);
+            hits += hit[i];
+        }
+        return hits;
+    }
+
+    void BlockCache::insertRange(const parser::Request *page, uint64_t count)
+    {
+        parser::Request cur = *page;
+        for (uint64_t i = 0; i < count; i++)
+        {
+            cur.id = page->id + i;
+            this->insert(&cur);
+        }
+    }
+
+    void BlockCache::updateRange(const parser::Request *page, uint64_t count)
+    {
+        parser::Request cur = *page;
+        for (uint64_t i = 0; i < count; i++)
+        {
+            cur.id = page->id + i;
+            this->update(&cur);
+        }
+    }
+
     void BlockCache::dumpStats() // 打印统计信息，并输出到outputfile
     {
         double missRate = calcMissRate();
@@ -177,6 +527,54 @@ namespace cache
         INFO("totalAccesses: %lu, accessesAfterFlush: %lu, Printing stats\n", getTotalAccesses(), getAccessesAfterFlush());
         INFO("Miss Rate: %lf, Flash Write Amp: %lf, Capacity utilization: %lf\n",
              missRate, flashWriteAmp, capacityUtilization);
+        // 建模的元数据内存：每个缓存对象一个索引项，块缓存模式再加上块内位图
+        uint64_t num_items = _log != nullptr ? _log->get_num_items() : 0;
+        uint64_t metadata = num_items * BLOCK_INDEX_ENTRY_BYTES;
+        if (_chunks != nullptr)
+        {
+            metadata += _chunks->memoryBytes();
+            double fill_amp = globalStats["chunkRequestedBytes"] > 0 ? (double)globalStats["chunkWrittenBytes"] / globalStats["chunkRequestedBytes"] : 1;
+            INFO("Chunk fill amp: %lf, total write amp: %lf, dirty pages evicted: %ld\n", fill_amp,
+                 fill_amp * flashWriteAmp, globalStats["chunkDirtyPagesEvicted"]);
+        }
+        globalStats["metadataBytes"] = metadata;
+        if (num_items > 0)
+        {
+            INFO("Metadata: %lu bytes for %lu cached objects (%.2lf bytes per cached page)\n", metadata, num_items,
+                 (double)metadata * _page_size / std::max<uint64_t>(_log->get_current_size(), 1));
+        }
+        if (_memory.empty())
+        {
+            registerMemory(_memory, "block");
+            _memory_stats = &globalStats.createChild("memory");
+        }
+        _memory.report(*_memory_stats);
+        recordTelemetry();
+        if (_wss != nullptr)
+        {
+            // 上次输出以来的工作集，之后开始新的窗口
+            misc::WindowedCardinality::Estimate e = _wss->estimate();
+            (*_wss_stats)["objects"] = e.objects;
+            (*_wss_stats)["bytes"] = e.bytes;
+            (*_wss_stats)["slidingObjects"] = e.sliding_objects;
+            (*_wss_stats)["slidingBytes"] = e.sliding_bytes;
+            INFO("Working set (estimated): %.0lf objects / %.0lf bytes since last dump, %.0lf / %.0lf sliding\n",
+                 e.objects, e.bytes, e.sliding_objects, e.sliding_bytes);
+            _wss->nextWindow();
+        }
+        if (_regret != nullptr)
+        {
+            _regret->print();
+        }
+#ifdef PROFILE_PHASES
+        _dumpProfile();
+#endif
+        if ((_extent_mode || _chunks != nullptr) && globalStats["requestGets"] > 0)
+        {
+            double gets = globalStats["requestGets"];
+            INFO("Request full hit: %lf, partial hit: %lf, miss: %lf\n", globalStats["requestFullHits"] / gets,
+                 globalStats["requestPartialHits"] / gets, globalStats["requestMisses"] / gets);
+        }
         // printSegment();
 
         // globalStats["missRate"] = missRate;
@@ -185,6 +583,52 @@ namespace cache
         statsCollector->print();
     }
 
+    void BlockCache::createEvictionRegret(const std::string &name)
+    {
+        if (_regret_entries > 0)
+        {
+            _regret = new stats::EvictionRegret(_regret_entries, statsCollector->createLocalCollector(name));
+        }
+    }
+
+    void BlockCache::enableGCTrace(const std::string &suffix)
+    {
+        if (!_gc_trace_path.empty())
+        {
+            _log->enableGCTrace(_gc_trace_path + suffix);
+        }
+    }
+
+    void BlockCache::recordTelemetry()
+    {
+        if (_log != nullptr)
+        {
+            _log->recordSealedValidRatio();
+        }
+    }
+
+    void BlockCache::registerMemory(misc::MemoryAccounting &mem, const std::string &name)
+    {
+        mem.add(name + "HistoryAccess", [this]() { return misc::hashTableBytes(_historyAccess); },
+                [this]() { return (uint64_t)_historyAccess.size(); });
+        mem.add(name + "PromotFlag", [this]() { return misc::hashTableBytes(_promotFlag); },
+                [this]() { return (uint64_t)_promotFlag.size(); });
+        if (_wss != nullptr)
+        {
+            mem.add(name + "WssSketch", [this]() { return _wss->bytes(); },
+                    [this]() { return _wss->windows(); });
+        }
+        if (_chunks != nullptr)
+        {
+            mem.add(name + "ChunkIndex", [this]() { return _chunks->memoryBytes(); },
+                    [this]() { return _chunks->size(); });
+        }
+        if (_log != nullptr)
+        {
+            _log->registerMemory(mem, name + "Log");
+        }
+    }
+
     uint64_t BlockCache::getTotalAccesses()
     {
         return globalStats["totalAccesses"];
@@ -200,19 +644,19 @@ namespace cache
         return globalStats["GetsAfterFlush"];
     }
 
-    void BlockCache::trackAccesses(parser::req_op_e req_op)
+    void BlockCache::trackAccesses(parser::req_op_e req_op, uint64_t count)
     {
-        globalStats["totalAccesses"]++;      // 总访问次数
-        globalStats["accessesAfterFlush"]++; // 刷新后的访问次数，即一段时间窗口内的访问次数
+        globalStats["totalAccesses"] += count;      // 总访问次数
+        globalStats["accessesAfterFlush"] += count; // 刷新后的访问次数，即一段时间窗口内的访问次数
         if (req_op == parser::OP_GET)
         {
-            globalStats["totalGets"]++; // 总GET请求次数
-            globalStats["GetsAfterFlush"]++;
+            globalStats["totalGets"] += count; // 总GET请求次数
+            globalStats["GetsAfterFlush"] += count;
         }
         else if (req_op == parser::OP_SET)
         {
-            globalStats["totalSets"]++; // 总SET请求次数
-            globalStats["SetsAfterFlush"]++;
+            globalStats["totalSets"] += count; // 总SET请求次数
+            globalStats["SetsAfterFlush"] += count;
         }
     }
 
@@ -229,6 +673,10 @@ namespace cache
             _historyAccess[req->id] = true;
             globalStats["uniqueBytes"] += req->req_size; // 唯一对象的总字节数，WSS
         }
+        if (_wss != nullptr)
+        {
+            _wss->add(req->id, req->req_size);
+        }
     }
 
     double BlockCache::calcMissRate()
@@ -264,10 +712,48 @@ namespace cache
         warmed_up = true;
     }
 
+#ifdef PROFILE_PHASES
+    // 各阶段的独占时间和硬件事件，按预热后的请求数平均
+    void BlockCache::_dumpProfile()
+    {
+        misc::Profiler &profiler = misc::Profiler::get();
+        double ns_per_cycle = profiler.nsPerCycle();
+        double accesses = std::max<uint64_t>(getAccessesAfterFlush(), 1);
+        for (int p = 0; p < misc::NUM_PROFILE_PHASES; p++)
+        {
+            const misc::Profiler::Phase &phase = profiler.phase(p);
+            std::string name = std::string("phase_") + misc::PROFILE_PHASE_NAMES[p];
+            uint64_t ns = phase.cycles * ns_per_cycle;
+            globalStats[name + "_ns"] = ns;
+            globalStats[name + "_calls"] = phase.calls;
+            if (!profiler.perfEnabled())
+            {
+                INFO("Phase %-6s: %8.1lf ns/req, %12lu calls\n", misc::PROFILE_PHASE_NAMES[p], ns / accesses,
+                     phase.calls);
+                continue;
+            }
+            for (int e = 0; e < misc::NUM_PROFILE_EVENTS; e++)
+            {
+                globalStats[name + "_" + misc::PROFILE_EVENT_NAMES[e]] = phase.events[e];
+            }
+            INFO("Phase %-6s: %8.1lf ns/req, %12lu calls, %.3lf LLC misses/req, %.3lf branch misses/req\n",
+                 misc::PROFILE_PHASE_NAMES[p], ns / accesses, phase.calls,
+                 phase.events[misc::EVENT_LLC_MISSES] / accesses, phase.events[misc::EVENT_BRANCH_MISSES] / accesses);
+        }
+    }
+#endif
+
     void BlockCache::flushStats()
     {
         dumpStats();
         INFO("Flushing stats\n");
+#ifdef PROFILE_PHASES
+        misc::Profiler::get().reset();
+#endif
+        if (_regret != nullptr)
+        {
+            _regret->flush();
+        }
         globalStats["hits"] = 0;
         globalStats["misses"] = 0;
         globalStats["hitsSize"] = 0;
@@ -276,6 +762,10 @@ namespace cache
         globalStats["GetsAfterFlush"] = 0;
         globalStats["SetsAfterFlush"] = 0;
         globalStats["compulsoryMisses"] = 0;
+        globalStats["requestGets"] = 0;
+        globalStats["requestFullHits"] = 0;
+        globalStats["requestPartialHits"] = 0;
+        globalStats["requestMisses"] = 0;
         globalStats["numStatFlushes"]++;
     }
 
@@ -1,10 +1,16 @@
 #pragma once
 #include <libconfig.h++>
+#include "admission/admission.hpp"
 #include "parsers/parser.hpp"
 #include "stats/stats.hpp"
+#include "stats/eviction_regret.hpp"
 #include "block.hpp"
 #include "block_log_abstract.hpp"
+#include "chunk_index.hpp"
+#include "common/cardinality.hpp"
+#include "common/mem_usage.hpp"
 #include <unordered_map>
+#include <vector>
 
 namespace cache
 {
@@ -36,6 +42,19 @@ namespace cache
         virtual bool find(const parser::Request *req) = 0;
         virtual void update(const parser::Request *req) = 0;
 
+        /* rewrites a cached block like update(), but sets its dirty flag to
+         * dirty instead of marking it dirty; chunk mode uses it so read
+         * fills into a cached chunk keep the chunk's dirty state */
+        virtual void rewrite(const parser::Request *req, bool dirty) = 0;
+
+        /* extent versions of find/insert/update over count consecutive
+         * pages, page is a one-page request for the first LBA. The defaults
+         * call the per-page methods; caches override them to batch index
+         * probes and log writes */
+        virtual uint64_t findRange(const parser::Request *page, uint64_t count, char *hit);
+        virtual void insertRange(const parser::Request *page, uint64_t count);
+        virtual void updateRange(const parser::Request *page, uint64_t count);
+
         virtual double calcFlashWriteAmp();
         double calcMissRate();
         virtual double calcCapacityUtilization();
@@ -46,23 +65,76 @@ namespace cache
         uint64_t getAccessesAfterFlush();
         uint64_t getGetsAfterFlush();
 
+        /* registers this cache's DRAM structures with the memory
+         * accounting, every component name starts with name */
+        virtual void registerMemory(misc::MemoryAccounting &mem, const std::string &name);
+
+        /* samples periodic telemetry of the logs (sealed segment valid
+         * ratios) into their stats before each dump */
+        virtual void recordTelemetry();
+
     protected:
         /* useful functions that are common to caches */
         void trackHistory(const parser::Request *req);
-        void trackAccesses(parser::req_op_e req_op);
+        void trackAccesses(parser::req_op_e req_op, uint64_t count = 1);
         void flushStats();
         stats::StatsCollector *statsCollector = nullptr;
         stats::LocalStatsCollector &globalStats;
-        // admission::Policy *_prelog_admission = nullptr;
+        admission::Policy *_prelog_admission = nullptr;
         bool warmed_up = false;
-        flashCache::BlockLogAbstract *_log;
+        flashCache::BlockLogAbstract *_log = nullptr;
         void checkWarmup();
         void printSegment();
 
+        /* creates _regret in the stats collector name when
+         * stats.evictionRegretEntries > 0, caches call it once their
+         * cache algorithm exists and feed it from find/insert */
+        void createEvictionRegret(const std::string &name);
+        stats::EvictionRegret *_regret = nullptr;
+
+        /* opens _log's GC trace at log.gcTraceFile + suffix if configured;
+         * tickLog passes the request clock to the log before a write that
+         * may trigger GC */
+        void enableGCTrace(const std::string &suffix);
+        inline void tickLog(const parser::Request *req)
+        {
+            if (_log->gcTraceEnabled())
+            {
+                _log->setClock(getTotalAccesses(), req->time);
+            }
+        }
+
     private:
+        void _accessExtent(const parser::Request *req);
+        void _accessChunks(const parser::Request *req);
+        void _dropChunk(uint64_t chunk, const uint64_t *bits);
+        void _sweepChunks(uint64_t n);
+#ifdef PROFILE_PHASES
+        void _dumpProfile();
+#endif
+
         std::unordered_map<uint64_t, bool> _historyAccess;
         std::unordered_map<uint64_t, bool> _promotFlag;
         uint64_t _stats_interval;
+        bool _extent_mode;              // 请求为(起始LBA, 长度)的区间，而不是单个页
+        std::vector<char> _extent_hits; // 区间中每个页是否命中
+
+        // 按块（chunk）缓存：Block::_capacity为块大小，每个块内按页记录有效/脏位图
+        ChunkIndex *_chunks = nullptr;
+        uint64_t _page_size;
+        bool _chunk_full_fill; // 读缺失时填充整个块，否则只填充缺失的页
+
+        uint64_t _regret_entries; // 驱逐后悔统计记录的驱逐对象数，0表示关闭
+
+        /* sketch estimates of the distinct objects and bytes requested
+         * between two stats dumps and over the last stats.wssSlidingWindows
+         * dumps, next to the exact uniqueBytes of _historyAccess */
+        misc::WindowedCardinality *_wss = nullptr;
+        stats::LocalStatsCollector *_wss_stats = nullptr;
+        std::string _gc_trace_path; // GC事件流文件，空表示关闭
+
+        misc::MemoryAccounting _memory;                      // 第一次输出统计信息时登记各组件
+        stats::LocalStatsCollector *_memory_stats = nullptr; // global下的memory子收集器
 
     }; // class BlockCache
 
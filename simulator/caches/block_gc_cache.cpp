@@ -1,6 +1,7 @@
 #include <cmath>
 
 #include "block_gc_cache.hpp"
+#include "common/profile.hpp"
 #include "config_reader.hpp"
 #include "constants.hpp"
 #include "stats/stats.hpp"
@@ -61,6 +62,7 @@ namespace cache
         }
         stats::LocalStatsCollector &log_stats = statsCollector->createLocalCollector(log_name);
         _log = new flashCache::BlockGC(log_capacity, log_stats);
+        enableGCTrace(enabled_rw_partition ? (is_read_cache ? ".read" : ".write") : "");
         if (is_read_cache)
             DEBUG("read cache log size %lu\n", log_capacity);
         else
@@ -100,6 +102,13 @@ namespace cache
             abort();
         }
 
+        // 读写分区时两个子缓存各自统计
+        createEvictionRegret(enabled_rw_partition ? log_name + " evictionRegret" : "evictionRegret");
+        if (_regret != nullptr)
+        {
+            _cache_algo->set_eviction_regret(_regret, stats::EvictionRegret::SOURCE_CACHE_ALGO);
+        }
+
         /* slow warmup */
         if (cfg.exists("cache.slowWarmup"))
         {
@@ -112,16 +121,28 @@ namespace cache
     {
         delete _log;
         delete _cache_algo;
-        // delete _prelog_admission;
     }
 
     void BlockGCCache::insert(const parser::Request *req)
     {
+        PROFILE_SCOPE(misc::PHASE_INSERT);
         // if (getTotalAccesses() % 1000 == 0)
         //     WARN("insert %lu, cacheAlgo size %lu, log size %lu, cache capacity %lu\n",
         //          req->id, _cache_algo->get_current_size(), _log->get_current_size(), _cache_algo->get_total_size());
 
+        // 准入策略拒绝的对象不写入flash，直接绕过缓存；仍要检查是否完成预热
+        if (_prelog_admission && _prelog_admission->admit_simple({candidate_t::make(*req)}).empty())
+        {
+            globalStats["admissionRejects"]++;
+            if (!warmed_up && getAccessesAfterFlush() % CHECK_WARMUP_INTERVAL == 0)
+            {
+                checkWarmup();
+            }
+            return;
+        }
+
         // bool test = _cache_algo->find(req, false);
+        tickLog(req);
         std::vector<uint64_t> evict = _cache_algo->set(req, false);
         _log->evict(evict);
         Block id = Block::make(*req);
@@ -147,6 +168,16 @@ namespace cache
 
     bool BlockGCCache::find(const parser::Request *req)
     {
+        PROFILE_SCOPE(misc::PHASE_FIND);
+        if (_prelog_admission)
+        {
+            _prelog_admission->trackAccess(candidate_t::make(*req), req->type);
+        }
+        if (_regret != nullptr)
+        {
+            _regret->accessed(req->id);
+        }
+
         // 分别查找内存缓存和flash日志缓存
         bool logic_find = _cache_algo->get(req,
                                            req->type == parser::OP_GET ? true : false);
@@ -168,10 +199,17 @@ namespace cache
 
     void BlockGCCache::update(const parser::Request *req)
     {
+        rewrite(req, true);
+    }
+
+    void BlockGCCache::rewrite(const parser::Request *req, bool dirty)
+    {
+        PROFILE_SCOPE(misc::PHASE_UPDATE);
+        tickLog(req);
         std::vector<uint64_t> evict = _cache_algo->set(req, false);
         _log->evict(evict);
         Block id = Block::make(*req);
-        id.is_dirty = true;
+        id.is_dirty = dirty;
         _log->update({id});
         // INFO("update %lu, lru size %lu, log size %lu\n", id._lba, _cache_algo->get_current_size(), _log->getTotalSize());
         if (_cache_algo->get_current_size() != _log->get_current_size())
@@ -181,4 +219,74 @@ namespace cache
         }
     }
 
+    /* a run of pages goes through the cache algorithm page by page, but the
+     * log sees one evict and one insert/update per run. A page that the
+     * algorithm evicted again while placing a later page of the same run is
+     * left out of the log write, so both sides keep the same contents */
+    void BlockGCCache::_applyRange(const parser::Request *page, uint64_t count, bool is_update)
+    {
+        tickLog(page);
+        parser::Request cur = *page;
+        std::vector<uint64_t> evict;
+        std::vector<char> dropped(count, 0);
+        for (uint64_t i = 0; i < count; i++)
+        {
+            cur.id = page->id + i;
+            std::vector<uint64_t> local_evict = _cache_algo->set(&cur, false);
+            for (auto lba : local_evict)
+            {
+                if (lba >= page->id && lba <= cur.id)
+                {
+                    dropped[lba - page->id] = 1;
+                }
+            }
+            evict.insert(evict.end(), local_evict.begin(), local_evict.end());
+        }
+        _log->evict(evict);
+
+        std::vector<Block> items;
+        items.reserve(count);
+        for (uint64_t i = 0; i < count; i++)
+        {
+            if (dropped[i])
+                continue;
+            Block id = Block::make(*page);
+            id._lba = page->id + i;
+            id.is_dirty = is_update || page->type == parser::OP_SET;
+            items.push_back(id);
+        }
+        if (is_update)
+            _log->update(items);
+        else
+            _log->insert(items);
+
+        if (_cache_algo->get_current_size() != _log->get_current_size())
+        {
+            ERROR("lru size %lu, log size %lu\n", _cache_algo->get_current_size(), _log->get_current_size());
+            abort();
+        }
+    }
+
+    void BlockGCCache::insertRange(const parser::Request *page, uint64_t count)
+    {
+        PROFILE_SCOPE(misc::PHASE_INSERT);
+        // 准入策略按页判断，退回逐页插入
+        if (_prelog_admission)
+        {
+            BlockCache::insertRange(page, count);
+            return;
+        }
+        _applyRange(page, count, false);
+        if (!warmed_up)
+        {
+            checkWarmup();
+        }
+    }
+
+    void BlockGCCache::updateRange(const parser::Request *page, uint64_t count)
+    {
+        PROFILE_SCOPE(misc::PHASE_UPDATE);
+        _applyRange(page, count, true);
+    }
+
 } // namespace cache
@@ -25,6 +25,14 @@ namespace cache
         void insert(const parser::Request *req);
         bool find(const parser::Request *req);
         void update(const parser::Request *req);
+        void rewrite(const parser::Request *req, bool dirty);
+        void insertRange(const parser::Request *page, uint64_t count);
+        void updateRange(const parser::Request *page, uint64_t count);
+        void registerMemory(misc::MemoryAccounting &mem, const std::string &name)
+        {
+            BlockCache::registerMemory(mem, name);
+            _cache_algo->register_memory(mem, name + "CacheAlgo");
+        }
         void print_config()
         {
             INFO("BlockGCCache\n");
@@ -40,6 +48,8 @@ namespace cache
         }
 
     private:
+        void _applyRange(const parser::Request *page, uint64_t count, bool is_update);
+
         CacheAlgo::CacheAlgoAbstract *_cache_algo = nullptr;
     };
 
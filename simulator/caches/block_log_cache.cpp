@@ -3,6 +3,7 @@
 #include <cmath>
 
 #include "common/logging.h"
+#include "common/profile.hpp"
 #include "config_reader.hpp"
 #include "constants.hpp"
 #include "stats/stats.hpp"
@@ -42,6 +43,8 @@ namespace cache
             ERROR("Unknown log type %s\n", log_type.c_str());
             abort();
         }
+        createEvictionRegret("evictionRegret");
+        enableGCTrace("");
 
         /* slow warmup */
         if (cfg.exists("cache.slowWarmup"))
@@ -59,10 +62,22 @@ namespace cache
 
     void BlockLogCache::insert(const parser::Request *req)
     {
+        PROFILE_SCOPE(misc::PHASE_INSERT);
+        // 准入策略拒绝的对象不写入flash，直接绕过缓存；仍要检查是否完成预热
+        if (_prelog_admission && _prelog_admission->admit_simple({candidate_t::make(*req)}).empty())
+        {
+            globalStats["admissionRejects"]++;
+            if (!warmed_up && getAccessesAfterFlush() % CHECK_WARMUP_INTERVAL == 0)
+            {
+                checkWarmup();
+            }
+            return;
+        }
+        tickLog(req);
         Block id = Block::make(*req);
         if (req->type == parser::OP_SET)
             id.is_dirty = true;
-        _log->insert({id}); // 插入flash日志记录缓存
+        _recordLogEvictions(_log->insert({id})); // 插入flash日志记录缓存
         /* check warmed up condition every so often */
         if (!warmed_up && getAccessesAfterFlush() % CHECK_WARMUP_INTERVAL == 0)
         {
@@ -72,6 +87,7 @@ namespace cache
 
     bool BlockLogCache::find(const parser::Request *req)
     {
+        PROFILE_SCOPE(misc::PHASE_FIND);
         // 分别查找内存缓存和flash日志缓存
         bool updateStats = false;
         if (req->type == parser::OP_GET)
@@ -79,6 +95,14 @@ namespace cache
             // INFO("read: %ld\n", req->id);
             updateStats = true;
         }
+        if (_prelog_admission)
+        {
+            _prelog_admission->trackAccess(candidate_t::make(*req), req->type);
+        }
+        if (_regret != nullptr)
+        {
+            _regret->accessed(req->id);
+        }
         if (_log->find(req->id, updateStats))
         {
             return true;
@@ -89,9 +113,92 @@ namespace cache
     void BlockLogCache::update(const parser::Request *req)
     {
         // DEBUG("update %lu\n", req->id);
+        rewrite(req, true);
+    }
+
+    void BlockLogCache::rewrite(const parser::Request *req, bool dirty)
+    {
+        PROFILE_SCOPE(misc::PHASE_UPDATE);
+        tickLog(req);
         Block id = Block::make(*req);
-        id.is_dirty = true;
+        id.is_dirty = dirty;
         _log->update({id});
     }
 
+    uint64_t BlockLogCache::findRange(const parser::Request *page, uint64_t count, char *hit)
+    {
+        PROFILE_SCOPE(misc::PHASE_FIND);
+        if (_prelog_admission)
+        {
+            parser::Request cur = *page;
+            for (uint64_t i = 0; i < count; i++)
+            {
+                cur.id = page->id + i;
+                _prelog_admission->trackAccess(candidate_t::make(cur), cur.type);
+            }
+        }
+        if (_regret != nullptr)
+        {
+            for (uint64_t i = 0; i < count; i++)
+                _regret->accessed(page->id + i);
+        }
+        return _log->findRange(page->id, count, page->type == parser::OP_GET, hit);
+    }
+
+    // 一段连续的未命中页一次写入日志
+    void BlockLogCache::insertRange(const parser::Request *page, uint64_t count)
+    {
+        PROFILE_SCOPE(misc::PHASE_INSERT);
+        // 准入策略按页判断，退回逐页插入
+        if (_prelog_admission)
+        {
+            BlockCache::insertRange(page, count);
+            return;
+        }
+        tickLog(page);
+        std::vector<Block> items;
+        items.reserve(count);
+        for (uint64_t i = 0; i < count; i++)
+        {
+            Block id = Block::make(*page);
+            id._lba = page->id + i;
+            id.is_dirty = page->type == parser::OP_SET;
+            items.push_back(id);
+        }
+        _recordLogEvictions(_log->insert(items));
+        if (!warmed_up)
+        {
+            checkWarmup();
+        }
+    }
+
+    void BlockLogCache::updateRange(const parser::Request *page, uint64_t count)
+    {
+        PROFILE_SCOPE(misc::PHASE_UPDATE);
+        tickLog(page);
+        std::vector<Block> items;
+        items.reserve(count);
+        for (uint64_t i = 0; i < count; i++)
+        {
+            Block id = Block::make(*page);
+            id._lba = page->id + i;
+            id.is_dirty = true;
+            items.push_back(id);
+        }
+        _log->update(items);
+    }
+
+    // 日志回收段时驱逐的块
+    void BlockLogCache::_recordLogEvictions(const std::vector<Block> &evicted)
+    {
+        if (_regret == nullptr)
+        {
+            return;
+        }
+        for (auto &block : evicted)
+        {
+            _regret->evicted(block._lba, stats::EvictionRegret::SOURCE_LOG);
+        }
+    }
+
 } // namespace cache
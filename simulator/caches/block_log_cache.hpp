@@ -18,8 +18,13 @@ namespace cache
         void insert(const parser::Request *req);
         bool find(const parser::Request *req);
         void update(const parser::Request *req);
+        void rewrite(const parser::Request *req, bool dirty);
+        uint64_t findRange(const parser::Request *page, uint64_t count, char *hit);
+        void insertRange(const parser::Request *page, uint64_t count);
+        void updateRange(const parser::Request *page, uint64_t count);
 
     private:
+        void _recordLogEvictions(const std::vector<Block> &evicted);
     };
 
 } // namespace cache
@@ -81,6 +81,11 @@ namespace cache
     }
 
     void BlockRWPartitionCache::update(const parser::Request *req)
+    {
+        rewrite(req, true);
+    }
+
+    void BlockRWPartitionCache::rewrite(const parser::Request *req, bool dirty)
     {
         int flag = 1;
         if (write_cache->find(req))
@@ -90,12 +95,12 @@ namespace cache
         if (flag == 1)
         {
             // DEBUG("read update %lu\n", req->id);
-            read_cache->update(req);
+            read_cache->rewrite(req, dirty);
         }
         else
         {
             // DEBUG("write update %lu\n", req->id);
-            write_cache->update(req);
+            write_cache->rewrite(req, dirty);
             // write_cache->calcCapacityUtilization();
         }
     }
@@ -31,11 +31,25 @@ namespace cache
         void insert(const parser::Request *req);
         bool find(const parser::Request *req);
         void update(const parser::Request *req);
+        void rewrite(const parser::Request *req, bool dirty);
 
         double calcFlashWriteAmp();
 
         double calcCapacityUtilization();
 
+        void registerMemory(misc::MemoryAccounting &mem, const std::string &name)
+        {
+            BlockCache::registerMemory(mem, name);
+            read_cache->registerMemory(mem, name + "Read");
+            write_cache->registerMemory(mem, name + "Write");
+        }
+
+        void recordTelemetry()
+        {
+            read_cache->recordTelemetry();
+            write_cache->recordTelemetry();
+        }
+
     private:
         BlockGCCache *read_cache = nullptr;
         BlockGCCache *write_cache = nullptr;
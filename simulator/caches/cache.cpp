@@ -35,7 +35,7 @@ namespace cache
         /* initialize stats collection */
         // 打印输出到的文件路径
         std::string filename = cfg.read<const char *>("stats.outputFile");
-        auto sc = new stats::StatsCollector(filename);
+        auto sc = new stats::StatsCollector(filename, cfg.read<const char *>("stats.format", "json"));
         // 创建一个统计信息收集器，命名为global
         auto &gs = sc->createLocalCollector("global");
 
@@ -80,6 +80,7 @@ namespace cache
     void Cache::access(const parser::Request *req)
     {
         assert(req->req_size >= 0);
+        trackRequest(req);
         // 只统计读取请求，GET=1
         if (req->type >= parser::OP_SET)
         {
@@ -121,6 +122,11 @@ namespace cache
     void Cache::dumpStats() // 打印统计信息，并输出到outputfile
     {
         INFO("Miss Rate: %lf, Flash Write Amp: %lf\n", calcMissRate(), calcFlashWriteAmp());
+        double read_amp = calcFlashReadAmp();
+        if (read_amp > 0)
+        {
+            INFO("Flash Read Amp: %lf\n", read_amp);
+        }
         // std::cout << "Miss Rate: " << calcMissRate()
         //           << " Flash Write Amp: " << calcFlashWriteAmp() << std::endl;
         statsCollector->print();
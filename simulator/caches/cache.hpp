@@ -32,7 +32,12 @@ namespace cache
 
         virtual void insert(candidate_t id) = 0;
         virtual bool find(candidate_t id) = 0;
+        /* sees every request with its real op type, including the writes that
+         * access() does not look up, before find */
+        virtual void trackRequest(const parser::Request *req) {}
         virtual double calcFlashWriteAmp() = 0;
+        /* flash pages read per flash lookup, 0 if the cache does not model reads */
+        virtual double calcFlashReadAmp() { return 0; }
 
         double calcMissRate();
 
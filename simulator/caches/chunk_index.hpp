@@ -0,0 +1,208 @@
+#pragma once
+#include <stdint.h>
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+namespace cache
+{
+
+    /* index from chunk number to the valid/dirty bitmaps of the chunk's
+     * sub-blocks, for caching at chunk granularity.
+     *
+     * It is a two-level radix tree whose top level is hashed: a leaf covers
+     * 2^LEAF_BITS consecutive chunks and holds a presence mask plus one slot
+     * per chunk, so a sequential extent costs one top-level probe per leaf
+     * rather than one per page. Bitmaps live in a slot pool with a free
+     * list, each slot holding words() valid words followed by words() dirty
+     * words. sweep() walks the slots with a cursor so stale chunks can be
+     * reclaimed a few at a time. */
+    class ChunkIndex
+    {
+    public:
+        static const int LEAF_BITS = 6;
+        static const uint64_t LEAF_CHUNKS = 1ULL << LEAF_BITS;
+
+        ChunkIndex(uint32_t sub_blocks) : _sub_blocks(sub_blocks), _words((sub_blocks + 63) / 64) {}
+
+        ~ChunkIndex()
+        {
+            for (auto &kv : _leaves)
+            {
+                delete kv.second;
+            }
+        }
+
+        uint32_t subBlocks() const { return _sub_blocks; }
+        uint32_t words() const { return _words; }
+
+        // 返回块的位图（valid在前，dirty在后），不存在时返回nullptr
+        uint64_t *find(uint64_t chunk)
+        {
+            Leaf *leaf = _leaf(chunk);
+            if (leaf == nullptr)
+            {
+                return nullptr;
+            }
+            uint64_t bit = chunk & (LEAF_CHUNKS - 1);
+            if (!(leaf->present & (1ULL << bit)))
+            {
+                return nullptr;
+            }
+            return _bits(leaf->slot[bit]);
+        }
+
+        // 插入一个全0位图的块并返回其位图
+        uint64_t *insert(uint64_t chunk)
+        {
+            Leaf *&leaf = _leaves[chunk >> LEAF_BITS];
+            if (leaf == nullptr)
+            {
+                leaf = new Leaf();
+            }
+            _last_key = chunk >> LEAF_BITS;
+            _last_leaf = leaf;
+            uint64_t bit = chunk & (LEAF_CHUNKS - 1);
+            assert(!(leaf->present & (1ULL << bit)));
+
+            uint32_t slot;
+            if (!_free_slots.empty())
+            {
+                slot = _free_slots.back();
+                _free_slots.pop_back();
+            }
+            else
+            {
+                slot = _num_slots++;
+                _pool.resize((uint64_t)_num_slots * 2 * _words);
+                _slot_chunk.resize(_num_slots);
+            }
+            _slot_chunk[slot] = chunk;
+            leaf->present |= 1ULL << bit;
+            leaf->slot[bit] = slot;
+            _size++;
+            uint64_t *bits = _bits(slot);
+            memset(bits, 0, 2 * _words * sizeof(uint64_t));
+            return bits;
+        }
+
+        void erase(uint64_t chunk)
+        {
+            auto it = _leaves.find(chunk >> LEAF_BITS);
+            assert(it != _leaves.end());
+            Leaf *leaf = it->second;
+            uint64_t bit = chunk & (LEAF_CHUNKS - 1);
+            assert(leaf->present & (1ULL << bit));
+            leaf->present &= ~(1ULL << bit);
+            _free_slots.push_back(leaf->slot[bit]);
+            _slot_chunk[leaf->slot[bit]] = NO_CHUNK;
+            _size--;
+            if (leaf->present == 0)
+            {
+                delete leaf;
+                _leaves.erase(it);
+                _last_leaf = nullptr;
+            }
+        }
+
+        // 从上次停下的位置继续，对接下来的n个槽位中的块调用fn(chunk, bits)，fn可以erase该块
+        template <typename Fn>
+        void sweep(uint64_t n, Fn fn)
+        {
+            for (n = std::min<uint64_t>(n, _num_slots); n > 0; n--)
+            {
+                if (_sweep_slot >= _num_slots)
+                {
+                    _sweep_slot = 0;
+                }
+                uint32_t slot = _sweep_slot++;
+                if (_slot_chunk[slot] != NO_CHUNK)
+                {
+                    fn(_slot_chunk[slot], _bits(slot));
+                }
+            }
+        }
+
+        uint64_t size() const { return _size; }
+
+        // 索引本身占用的内存：叶子、顶层哈希表项和位图池
+        uint64_t memoryBytes() const
+        {
+            return _leaves.size() * (sizeof(Leaf) + sizeof(void *) + 2 * sizeof(uint64_t)) +
+                   _pool.capacity() * sizeof(uint64_t) + _free_slots.capacity() * sizeof(uint32_t) +
+                   _slot_chunk.capacity() * sizeof(uint64_t);
+        }
+
+        /* ----------- bitmap helpers over sub-blocks [s, e) --------------- */
+
+        static uint64_t count(const uint64_t *bits, uint32_t s, uint32_t e)
+        {
+            uint64_t n = 0;
+            for (uint32_t i = s; i < e;)
+            {
+                uint32_t w = i / 64, b = i % 64;
+                uint32_t len = std::min<uint32_t>(64 - b, e - i);
+                n += __builtin_popcountll((bits[w] >> b) & _mask(len));
+                i += len;
+            }
+            return n;
+        }
+
+        static void set(uint64_t *bits, uint32_t s, uint32_t e)
+        {
+            for (uint32_t i = s; i < e;)
+            {
+                uint32_t w = i / 64, b = i % 64;
+                uint32_t len = std::min<uint32_t>(64 - b, e - i);
+                bits[w] |= _mask(len) << b;
+                i += len;
+            }
+        }
+
+    private:
+        static const uint64_t NO_CHUNK = ~0ULL;
+
+        struct Leaf
+        {
+            uint64_t present = 0;
+            uint32_t slot[LEAF_CHUNKS];
+        };
+
+        Leaf *_leaf(uint64_t chunk)
+        {
+            // 顺序访问时连续的块落在同一个叶子上，缓存上一次的叶子
+            uint64_t key = chunk >> LEAF_BITS;
+            if (_last_leaf != nullptr && _last_key == key)
+            {
+                return _last_leaf;
+            }
+            auto it = _leaves.find(key);
+            if (it == _leaves.end())
+            {
+                return nullptr;
+            }
+            _last_key = key;
+            _last_leaf = it->second;
+            return it->second;
+        }
+
+        uint64_t *_bits(uint32_t slot) { return _pool.data() + (uint64_t)slot * 2 * _words; }
+
+        static uint64_t _mask(uint32_t len) { return len >= 64 ? ~0ULL : (1ULL << len) - 1; }
+
+        uint32_t _sub_blocks;
+        uint32_t _words;
+        std::unordered_map<uint64_t, Leaf *> _leaves;
+        uint64_t _last_key = 0;
+        Leaf *_last_leaf = nullptr;
+        std::vector<uint64_t> _pool;
+        std::vector<uint32_t> _free_slots;
+        std::vector<uint64_t> _slot_chunk; // 每个槽位所属的块，空闲槽位为NO_CHUNK
+        uint32_t _num_slots = 0;
+        uint32_t _sweep_slot = 0; // sweep的游标
+        uint64_t _size = 0;
+    };
+
+} // namespace cache
@@ -39,18 +39,22 @@ namespace cache
         auto &set_stats = statsCollector->createLocalCollector("sets");
         uint64_t num_sets = actual_set_capacity / set_capacity;             // 集合数量
         int num_hash_functions = cfg.read<int>("sets.numHashFunctions", 1); // 哈希函数数量
+        uint32_t max_items_per_set = cfg.read<int>("sets.maxItemsPerSet", 0); // 每个集合最多的对象数，0表示只受集合容量限制
+        double bloom_bits_per_object = cfg.read<float>("sets.bloomBitsPerObject", 0); // 每个对象的布隆过滤器位数，0表示不使用
         if (cfg.exists("sets.rripBits"))
         {
             int rrip_bits = cfg.read<int>("sets.rripBits");                // rrip中为每个对象维护的位数
             bool promotion = (bool)cfg.read<int>("sets.promotionOnly", 0); // promotion模式
             bool mixed = (bool)cfg.read<int>("sets.mixedRRIP", 0);         // mixed模式
             _sets = new flashCache::RripSets(num_sets, set_capacity, set_stats, this,
-                                             num_hash_functions, rrip_bits, promotion, mixed);
+                                             num_hash_functions, rrip_bits, promotion, mixed, max_items_per_set,
+                                             bloom_bits_per_object);
         }
         else
         {
             bool sets_track_hits = cfg.exists("sets.trackHitsPerItem"); // 是否启用NRU策略，若不启用，则默认为FIFO
-            _sets = new flashCache::Sets(num_sets, set_capacity, set_stats, this, num_hash_functions, sets_track_hits);
+            _sets = new flashCache::Sets(num_sets, set_capacity, set_stats, this, num_hash_functions, sets_track_hits,
+                                         max_items_per_set, bloom_bits_per_object);
         }
         if (cfg.exists("sets.hitDistribution"))
         {
@@ -64,7 +68,8 @@ namespace cache
         {
             auto &log_stats = statsCollector->createLocalCollector("log");
             uint64_t block_size = 1024 * (uint64_t)cfg.read<int>("log.flushBlockSizeKB"); // 日志块大小，乘以1024，单位为字节
-            _log = new flashCache::RotatingLog(log_capacity, block_size, _sets, log_stats, readmit);
+            uint64_t index_partitions = cfg.read<int>("log.indexPartitions", (int)flashCache::LOG_INDEX_PARTITIONS); // 日志索引的分区数
+            _log = new flashCache::RotatingLog(log_capacity, block_size, _sets, num_sets, log_stats, readmit, index_partitions);
         }
         else // 否则为Log，下刷时将所有对象一起下刷
         {
@@ -80,9 +85,16 @@ namespace cache
         uint64_t memory_size = (uint64_t)cfg.read<int>("cache.memorySizeMB") * 1024 * 1024;
         // 日志缓存索引的内存消耗比例
         double perc_mem_log_overhead = cfg.read<float>("cache.memOverheadRatio", INDEX_LOG_RATIO);
-        assert(log_capacity * perc_mem_log_overhead + sets_memory_consumption <= memory_size);
+        uint64_t log_memory_consumption = log_capacity * perc_mem_log_overhead;
+        // 开启log.modelIndexMemory且日志建模了索引布局时，按实际布局计算
+        if (cfg.read<int>("log.modelIndexMemory", 0) && _log->calcMemoryConsumption())
+        {
+            log_memory_consumption = _log->calcMemoryConsumption();
+        }
+        std::cout << "Log index memory: " << log_memory_consumption << std::endl;
+        assert(log_memory_consumption + sets_memory_consumption <= memory_size);
         // 计算剩余内存缓存容量
-        uint64_t mem_cache_capacity = memory_size - (log_capacity * perc_mem_log_overhead);
+        uint64_t mem_cache_capacity = memory_size - log_memory_consumption;
         mem_cache_capacity -= sets_memory_consumption;
         std::cout << "Actual Memory Cache Size after indexing costs: "
                   << mem_cache_capacity << std::endl;
@@ -143,13 +155,8 @@ namespace cache
         // 若预热完毕且设置了日志缓存准入策略，则根据准入策略对对象进行处理
         if (warmed_up && _prelog_admission)
         {
-            // 按所属集合返回被准入的对象
-            auto admitted = _prelog_admission->admit(ret);
-            ret.clear();
-            for (auto set : admitted)
-            {
-                ret.insert(ret.end(), set.second.begin(), set.second.end());
-            }
+            // 按所属集合排序返回被准入的对象
+            ret = _prelog_admission->admit(ret).items;
         }
         ret = _log->insert(ret); // 将驱逐的对象插入到日志闪存缓存中，返回从日志缓存中驱逐的对象
         if (ret.size())          // 若有对象被驱逐，则插入到集合缓存中
@@ -158,14 +165,14 @@ namespace cache
             if (warmed_up && _preset_admission)
             {
                 auto admitted = _preset_admission->admit(ret);
-                for (auto set : admitted) // 按集合进行准入
+                for (auto &run : admitted.runs) // 按集合进行准入，同一集合的对象在批中连续
                 {
                     if (_record_dist)
                     {
                         // 记录当前准入集合中对象的数量和大小
-                        std::string num_name = "numItemsMoved" + std::to_string(set.second.size());
-                        uint64_t size = std::accumulate(set.second.begin(),
-                                                        set.second.end(), 0,
+                        std::string num_name = "numItemsMoved" + std::to_string(run.size());
+                        uint64_t size = std::accumulate(admitted.begin(run),
+                                                        admitted.end(run), 0,
                                                         [](uint64_t sum, candidate_t next)
                                                         { return (sum + next.obj_size); });
                         // 将对象总大小按SIZE_BUCKETING取整
@@ -175,7 +182,7 @@ namespace cache
                         globalStats[size_name]++;
                     }
                     // 将准入的对象集合插入到集合缓存中
-                    ret = _sets->insert(set.first, set.second);
+                    ret = _sets->insert(run.set_num, admitted.begin(run), admitted.end(run));
                 }
             }
             else
@@ -191,6 +198,15 @@ namespace cache
         }
     }
 
+    // 把请求及其真实的操作类型交给准入策略（学习型准入以操作类型为特征）
+    void MemLogSetsCache::trackRequest(const parser::Request *req)
+    {
+        if (_prelog_admission)
+        {
+            _prelog_admission->trackAccess(candidate_t::make(*req), req->type);
+        }
+    }
+
     bool MemLogSetsCache::find(candidate_t id)
     {
         // 依次在内存缓存，闪存日志缓存，闪存集合缓存中查找
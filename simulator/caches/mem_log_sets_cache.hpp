@@ -17,7 +17,9 @@ namespace cache
         ~MemLogSetsCache();
         void insert(candidate_t id);
         bool find(candidate_t id);
+        void trackRequest(const parser::Request *req);
         double calcFlashWriteAmp();
+        double calcFlashReadAmp() { return _sets->calcReadAmp(); }
         double calcMissRate();
 
         void readmitToLogFromSets(candidate_t item)
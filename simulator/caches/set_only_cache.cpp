@@ -18,6 +18,8 @@ namespace cache
         uint64_t flash_size_mb = (uint64_t)cfg.read<int>("cache.flashSizeMB"); // 缓存容量
         uint64_t num_sets = (flash_size_mb * 1024 * 1024) / set_capacity;      // 集合数量
         int num_hash_functions = cfg.read<int>("sets.numHashFunctions", 1);    // 哈希函数数量
+        uint32_t max_items_per_set = cfg.read<int>("sets.maxItemsPerSet", 0); // 每个集合最多的对象数，0表示只受集合容量限制
+        double bloom_bits_per_object = cfg.read<float>("sets.bloomBitsPerObject", 0); // 每个对象的布隆过滤器位数，0表示不使用
         auto &set_stats = statsCollector->createLocalCollector("sets");
         if (cfg.exists("sets.rripBits"))
         {
@@ -25,12 +27,14 @@ namespace cache
             bool promotion = (bool)cfg.read<int>("sets.promotionOnly", 0); // 若为true，则只要对象被访问过，在插入时，或被再次访问时，其rrpv都重置为0
             bool mixed = (bool)cfg.read<int>("sets.mixedRRIP", 0);         // 若为true，则对象被再次访问时，rrpv重置为0，在插入时，按其访问次数决定rrpv
             _sets = new flashCache::RripSets(num_sets, set_capacity, set_stats, nullptr,
-                                             num_hash_functions, rrip_bits, promotion, mixed);
+                                             num_hash_functions, rrip_bits, promotion, mixed, max_items_per_set,
+                                             bloom_bits_per_object);
         }
         else
         {
             bool sets_track_hits = cfg.exists("sets.trackHitsPerItem"); // 是否启用NRU策略，若为false，则默认为fifo
-            _sets = new flashCache::Sets(num_sets, set_capacity, set_stats, nullptr, num_hash_functions, sets_track_hits);
+            _sets = new flashCache::Sets(num_sets, set_capacity, set_stats, nullptr, num_hash_functions, sets_track_hits,
+                                         max_items_per_set, bloom_bits_per_object);
         }
 
         /* Initialize memory cache */
@@ -78,10 +82,10 @@ namespace cache
             // 进行准入判断，返回一组set，表示各个set中被准入的对象
             auto admitted = _preset_admission->admit(ret);
             // 遍历set，将准入的对象插入到flash cache中
-            for (auto set : admitted)
+            for (auto &run : admitted.runs)
             {
                 // 向指定set插入一批对象
-                _sets->insert(set.first, set.second);
+                _sets->insert(run.set_num, admitted.begin(run), admitted.end(run));
             }
         }
         else if (ret.size() != 0) // 否则直接将对象插入到flash cache中
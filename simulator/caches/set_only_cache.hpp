@@ -16,6 +16,7 @@ namespace cache
         void insert(candidate_t id);
         bool find(candidate_t id);
         double calcFlashWriteAmp();
+        double calcFlashReadAmp() { return _sets->calcReadAmp(); }
         double calcMissRate();
 
     private:
@@ -37,7 +37,7 @@ namespace cache
         /* initialize stats collection */
         // 打印输出到的文件路径
         std::string filename = cfg.read<const char *>("stats.outputFile");
-        auto sc = new stats::StatsCollector(filename);
+        auto sc = new stats::StatsCollector(filename, cfg.read<const char *>("stats.format", "json"));
         // 创建一个统计信息收集器，命名为global
         auto &gs = sc->createLocalCollector("global");
 
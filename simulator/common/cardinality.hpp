@@ -0,0 +1,221 @@
+#pragma once
+
+#include <stdint.h>
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+#include "common/hash.hpp"
+
+namespace misc
+{
+
+  /* HyperLogLog distinct counter over 64-bit hashes: 2^precision one-byte
+   * registers (4 KiB and ~1.6% standard error with the default 12), linear
+   * counting while many registers are still empty. Sketches of the same
+   * precision merge by taking the register-wise maximum */
+  class HyperLogLog
+  {
+  public:
+    explicit HyperLogLog(int precision = 12) : _p(precision), _registers(1ULL << precision, 0)
+    {
+      assert(precision >= 4 && precision <= 18);
+    }
+
+    inline void add(uint64_t hash)
+    {
+      uint64_t idx = hash >> (64 - _p);
+      // 剩余的位中第一个1的位置，末尾补1保证有界
+      uint8_t rank = __builtin_clzll((hash << _p) | (1ULL << (_p - 1))) + 1;
+      if (rank > _registers[idx])
+        _registers[idx] = rank;
+    }
+
+    double estimate() const
+    {
+      double m = _registers.size();
+      double sum = 0;
+      uint64_t zeros = 0;
+      for (uint8_t r : _registers)
+      {
+        sum += std::ldexp(1.0, -r);
+        zeros += r == 0;
+      }
+      double alpha = 0.7213 / (1 + 1.079 / m);
+      double e = alpha * m * m / sum;
+      if (e <= 2.5 * m && zeros > 0)
+        e = m * std::log(m / zeros);
+      return e;
+    }
+
+    void merge(const HyperLogLog &other)
+    {
+      assert(other._p == _p);
+      for (uint64_t i = 0; i < _registers.size(); i++)
+        _registers[i] = std::max(_registers[i], other._registers[i]);
+    }
+
+    void clear() { std::fill(_registers.begin(), _registers.end(), 0); }
+    uint64_t bytes() const { return _registers.size(); }
+
+  private:
+    int _p;
+    std::vector<uint8_t> _registers;
+  };
+
+  /* k-minimum-values sketch that also keeps a weight (eg the object size)
+   * per sampled hash: the k smallest distinct hashes estimate the number
+   * of distinct keys as (k-1)/U_k, and their mean weight scales that to the
+   * distinct sum of weights (unique bytes). Exact below k keys. Kept as a
+   * sorted array, so most adds are one comparison with the k-th value */
+  class KmvSketch
+  {
+  public:
+    explicit KmvSketch(int k = 1024) : _k(k) { _values.reserve(k + 1); }
+
+    inline void add(uint64_t hash, uint64_t weight)
+    {
+      if (_values.size() == _k && hash >= _values.back().first)
+        return;
+      auto it = std::lower_bound(_values.begin(), _values.end(), std::make_pair(hash, (uint64_t)0));
+      if (it != _values.end() && it->first == hash)
+      {
+        it->second = weight; // 对象大小变化时取最新的大小
+        return;
+      }
+      _values.insert(it, std::make_pair(hash, weight));
+      if (_values.size() > _k)
+        _values.pop_back();
+    }
+
+    double distinct() const
+    {
+      if (_values.size() < _k)
+        return _values.size();
+      double u = std::ldexp((double)_values.back().first, -64);
+      return (_k - 1) / u;
+    }
+
+    double distinctWeight() const
+    {
+      double sum = 0;
+      for (auto &v : _values)
+        sum += v.second;
+      if (_values.size() < _k)
+        return sum;
+      return distinct() * sum / _values.size();
+    }
+
+    void merge(const KmvSketch &other)
+    {
+      std::vector<std::pair<uint64_t, uint64_t>> merged;
+      merged.reserve(_k + 1);
+      auto a = _values.cbegin(), b = other._values.cbegin();
+      while (merged.size() < _k && (a != _values.cend() || b != other._values.cend()))
+      {
+        if (b == other._values.cend() || (a != _values.cend() && a->first < b->first))
+          merged.push_back(*a++);
+        else if (a == _values.cend() || b->first < a->first)
+          merged.push_back(*b++);
+        else
+        {
+          merged.push_back(*b++); // 同一个键，取后合并的一方
+          a++;
+        }
+      }
+      _values.swap(merged);
+    }
+
+    void clear() { _values.clear(); }
+    uint64_t bytes() const { return _values.capacity() * sizeof(_values[0]); }
+
+  private:
+    uint64_t _k;
+    std::vector<std::pair<uint64_t, uint64_t>> _values; // 按哈希值升序的(哈希值, 权重)
+  };
+
+  /* distinct objects (HyperLogLog) and distinct bytes (KMV) per window and
+   * over a sliding window of the last num_windows windows, the current one
+   * included. Keeps one pair of sketches per window in a ring; the sliding
+   * estimate merges them, so the working set size over time costs a few
+   * tens of KiB instead of a hash set of ids */
+  class WindowedCardinality
+  {
+  public:
+    struct Estimate
+    {
+      double objects, bytes;                // 当前窗口
+      double sliding_objects, sliding_bytes; // 最近num_windows个窗口
+    };
+
+    WindowedCardinality(int num_windows, int hll_precision = 12, int kmv_k = 1024)
+        : _hll(std::max(num_windows, 1), HyperLogLog(hll_precision)),
+          _kmv(std::max(num_windows, 1), KmvSketch(kmv_k)),
+          _hll_precision(hll_precision), _kmv_k(kmv_k)
+    {
+    }
+
+    inline void add(uint64_t id, uint64_t size)
+    {
+      uint64_t h = hash(id);
+      _hll[_cur].add(h);
+      _kmv[_cur].add(h, size);
+    }
+
+    Estimate estimate() const
+    {
+      HyperLogLog hll(_hll_precision);
+      KmvSketch kmv(_kmv_k);
+      for (uint64_t i = 0; i < _hll.size(); i++)
+      {
+        hll.merge(_hll[i]);
+        kmv.merge(_kmv[i]);
+      }
+      return {_hll[_cur].estimate(), _kmv[_cur].distinctWeight(), hll.estimate(), kmv.distinctWeight()};
+    }
+
+    // 开始新的窗口，丢弃最早的窗口
+    void nextWindow()
+    {
+      _cur = (_cur + 1) % _hll.size();
+      _hll[_cur].clear();
+      _kmv[_cur].clear();
+    }
+
+    uint64_t windows() const { return _hll.size(); }
+
+    uint64_t bytes() const
+    {
+      uint64_t n = 0;
+      for (uint64_t i = 0; i < _hll.size(); i++)
+        n += _hll[i].bytes() + _kmv[i].bytes();
+      return n;
+    }
+
+    /* mix64 of consecutive ids (LBAs) leaves visible structure in the high
+     * bits that HyperLogLog reads its register and rank from, so it is
+     * followed by the murmur3 finalizer */
+    static inline uint64_t hash(uint64_t id)
+    {
+      uint64_t h = mix64(id, SEED);
+      h ^= h >> 33;
+      h *= 0xff51afd7ed558ccdULL;
+      h ^= h >> 33;
+      h *= 0xc4ceb9fe1a85ec53ULL;
+      h ^= h >> 33;
+      return h;
+    }
+
+  private:
+    static constexpr uint64_t SEED = 0x6a09e667f3bcc909ULL;
+
+    std::vector<HyperLogLog> _hll;
+    std::vector<KmvSketch> _kmv;
+    int _hll_precision;
+    int _kmv_k;
+    uint64_t _cur = 0;
+  };
+
+} // namespace misc
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <stdint.h>
+
+namespace misc
+{
+
+  // wyhash风格的64位混合函数：128位乘法后高低位异或，无内存分配
+  inline uint64_t mix64(uint64_t x, uint64_t seed)
+  {
+    __uint128_t r = (__uint128_t)(x ^ 0xa0761d6478bd642fULL) * (seed ^ 0xe7037ed1a0b428dbULL);
+    return (uint64_t)(r >> 64) ^ (uint64_t)r;
+  }
+
+  // 将64位哈希值映射到[0, n)，用乘法高位代替取模 (Lemire)
+  inline uint64_t fastRange(uint64_t hash, uint64_t n)
+  {
+    return (uint64_t)(((__uint128_t)hash * n) >> 64);
+  }
+
+}
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <stdint.h>
+#include <algorithm>
+#include <cassert>
+#include <ostream>
+#include <vector>
+
+namespace misc
+{
+
+  /* HDR-style histogram over int64 values with fixed log-linear buckets in
+   * a flat array. Values below 2^(sub_bucket_bits+1) (256 with the default
+   * 7) get a bucket each; above that every power of two is split into
+   * 2^sub_bucket_bits buckets, so a bucket's width is at most
+   * 2^-sub_bucket_bits of its values (<0.8% with the default 7). The
+   * bucket of a value is found with a count-leading-zeros and two shifts.
+   * Negative values (the "-1, never seen before" convention of the
+   * analyzer) share one extra counter. Histograms with the same precision
+   * can be merged by adding their arrays */
+  class HdrHistogram
+  {
+  public:
+    explicit HdrHistogram(int sub_bucket_bits = 7)
+        : _sub_bits(sub_bucket_bits),
+          _sub_mask((1ULL << sub_bucket_bits) - 1),
+          _counts((uint64_t)(64 - sub_bucket_bits + 1) << sub_bucket_bits, 0)
+    {
+      assert(sub_bucket_bits > 0 && sub_bucket_bits < 32);
+    }
+
+    inline void add(int64_t value, uint64_t count = 1)
+    {
+      if (value < 0)
+        _negative += count;
+      else
+        _counts[index((uint64_t)value)] += count;
+    }
+
+    // 值所在的桶：小于2^(sub_bits+1)时为值本身，否则为(指数+1, 尾数的高sub_bits位)
+    inline uint64_t index(uint64_t value) const
+    {
+      if (value <= _sub_mask)
+        return value;
+      int e = 63 - __builtin_clzll(value) - _sub_bits;
+      return ((uint64_t)(e + 1) << _sub_bits) + ((value >> e) & _sub_mask);
+    }
+
+    // 桶中最小的值
+    inline uint64_t lowest(uint64_t idx) const
+    {
+      if (idx <= (_sub_mask << 1 | 1))
+        return idx;
+      int e = (int)(idx >> _sub_bits) - 1;
+      return ((idx & _sub_mask) | (_sub_mask + 1)) << e;
+    }
+
+    // 桶中最大的值
+    inline uint64_t highest(uint64_t idx) const
+    {
+      if (idx <= (_sub_mask << 1 | 1))
+        return idx;
+      int e = (int)(idx >> _sub_bits) - 1;
+      return lowest(idx) + (1ULL << e) - 1;
+    }
+
+    void merge(const HdrHistogram &other)
+    {
+      assert(other._sub_bits == _sub_bits);
+      for (uint64_t i = 0; i < _counts.size(); i++)
+        _counts[i] += other._counts[i];
+      _negative += other._negative;
+    }
+
+    void clear()
+    {
+      std::fill(_counts.begin(), _counts.end(), 0);
+      _negative = 0;
+    }
+
+    uint64_t total() const
+    {
+      uint64_t n = _negative;
+      for (uint64_t c : _counts)
+        n += c;
+      return n;
+    }
+
+    /* smallest value v such that at least p percent of the values are <= v,
+     * reported as the highest value of its bucket; -1 when that falls among
+     * the negative values or the histogram is empty */
+    int64_t percentile(double p) const
+    {
+      uint64_t n = total();
+      if (n == 0)
+        return -1;
+      uint64_t rank = std::max<uint64_t>((uint64_t)(p / 100.0 * n + 0.5), 1);
+      uint64_t seen = _negative;
+      if (seen >= rank)
+        return -1;
+      for (uint64_t i = 0; i < _counts.size(); i++)
+      {
+        seen += _counts[i];
+        if (seen >= rank)
+          return (int64_t)highest(i);
+      }
+      return (int64_t)highest(_counts.size() - 1);
+    }
+
+    // 按值从小到大遍历非空的桶，fn(桶中最小的值, 计数)，负值的计数以-1给出
+    template <typename Fn>
+    void forEach(Fn &&fn) const
+    {
+      if (_negative > 0)
+        fn((int64_t)-1, _negative);
+      for (uint64_t i = 0; i < _counts.size(); i++)
+      {
+        if (_counts[i] > 0)
+          fn((int64_t)lowest(i), _counts[i]);
+      }
+    }
+
+    // 每个非空桶一行"最小值:计数"，与原来unordered_map直方图的输出格式相同
+    void dump(std::ostream &os) const
+    {
+      forEach([&](int64_t value, uint64_t count)
+              { os << value << ":" << count << "\n"; });
+    }
+
+  private:
+    int _sub_bits;
+    uint64_t _sub_mask;
+    std::vector<uint64_t> _counts;
+    uint64_t _negative = 0;
+  };
+
+} // namespace misc
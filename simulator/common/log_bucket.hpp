@@ -0,0 +1,43 @@
+#pragma once
+
+#include <stdint.h>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace misc
+{
+
+  /* log-scaled histogram buckets with base b: bucket i holds the values v
+   * with b^(i-1) < v <= b^i, values 0 and 1 go to bucket 0 and values past
+   * the last bound to the last bucket. This is ceil(log(v) / log(b)), the
+   * bucketing of CacheAlgoAbstract::log_eviction_age_cnt, but looked up in
+   * a precomputed table of integer bounds instead of calling log() */
+  class LogBuckets
+  {
+  public:
+    LogBuckets(double base, int num_buckets) : _bounds(num_buckets)
+    {
+      for (int i = 0; i < num_buckets; i++)
+      {
+        // 整数值v落在桶i当且仅当v <= floor(b^i)
+        double bound = std::pow(base, i);
+        _bounds[i] = bound >= 1.8e19 ? UINT64_MAX : (uint64_t)bound;
+      }
+    }
+
+    inline int bucket(uint64_t v) const
+    {
+      auto it = std::lower_bound(_bounds.begin(), _bounds.end(), v);
+      return it == _bounds.end() ? (int)_bounds.size() - 1 : (int)(it - _bounds.begin());
+    }
+
+    // 桶中最大的整数值
+    uint64_t bound(int i) const { return _bounds[i]; }
+    int size() const { return _bounds.size(); }
+
+  private:
+    std::vector<uint64_t> _bounds;
+  };
+
+} // namespace misc
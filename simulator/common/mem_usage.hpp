@@ -0,0 +1,97 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <algorithm>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "common/logging.h"
+#include "stats/stats.hpp"
+
+/*
+ Memory accounting of the simulator's DRAM data structures. Every component
+ registers an estimator returning its current bytes and object count; at each
+ stats dump MemoryAccounting::report() writes "<name>Bytes" and
+ "<name>Objects" per component, the accounted total and the process RSS
+ (/proc/self/statm) into a stats collector. The estimates follow the
+ libstdc++/glibc layout (one malloc'ed node per hash table element plus the
+ bucket array), so bytes/object from one run can be used to size another.
+*/
+
+namespace misc
+{
+
+  // glibc malloc每次分配额外8字节头部，按16字节对齐，最小32字节
+  inline uint64_t mallocBytes(uint64_t n)
+  {
+    return std::max<uint64_t>(32, (n + 8 + 15) & ~15ULL);
+  }
+
+  // std::unordered_map/unordered_set：桶数组加每个元素一个节点（next指针+元素）
+  template <typename Map>
+  inline uint64_t hashTableBytes(const Map &m)
+  {
+    return m.bucket_count() * sizeof(void *) +
+           m.size() * mallocBytes(sizeof(void *) + sizeof(typename Map::value_type));
+  }
+
+  // 进程常驻内存，读取/proc/self/statm的第二列（页数）
+  inline uint64_t processRssBytes()
+  {
+    FILE *f = fopen("/proc/self/statm", "r");
+    if (f == NULL)
+    {
+      return 0;
+    }
+    unsigned long size = 0, resident = 0;
+    int n = fscanf(f, "%lu %lu", &size, &resident);
+    fclose(f);
+    return n == 2 ? (uint64_t)resident * sysconf(_SC_PAGESIZE) : 0;
+  }
+
+  class MemoryAccounting
+  {
+  public:
+    typedef std::function<uint64_t()> Estimator;
+
+    void add(const std::string &name, Estimator bytes, Estimator objects)
+    {
+      _components.push_back({name, bytes, objects});
+    }
+
+    bool empty() const { return _components.empty(); }
+
+    void report(stats::LocalStatsCollector &memory_stats)
+    {
+      uint64_t rss = processRssBytes();
+      uint64_t accounted = 0;
+      for (auto &c : _components)
+      {
+        uint64_t bytes = c.bytes();
+        uint64_t objects = c.objects();
+        accounted += bytes;
+        memory_stats[c.name + "Bytes"] = bytes;
+        memory_stats[c.name + "Objects"] = objects;
+        INFO("Memory %-20s: %10.1lf MB, %12lu objects, %6.1lf bytes/object\n", c.name.c_str(),
+             bytes / (1024.0 * 1024), objects, objects > 0 ? (double)bytes / objects : 0.0);
+      }
+      memory_stats["accountedBytes"] = accounted;
+      memory_stats["rssBytes"] = rss;
+      INFO("Memory accounted %.1lf MB of %.1lf MB RSS\n", accounted / (1024.0 * 1024), rss / (1024.0 * 1024));
+    }
+
+  private:
+    struct Component
+    {
+      std::string name;
+      Estimator bytes;
+      Estimator objects;
+    };
+
+    std::vector<Component> _components;
+  };
+
+} // namespace misc
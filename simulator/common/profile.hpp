@@ -0,0 +1,237 @@
+#pragma once
+
+#include <stdint.h>
+#include <chrono>
+#include <cstring>
+
+#ifdef PROFILE_PHASES
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#include "common/logging.h"
+#endif
+
+#include "common/macro.h"
+
+/*
+ Per-phase profiling of the simulator's hot path. Build with `scons profile=1`
+ (which defines PROFILE_PHASES) to enable it; otherwise PROFILE_SCOPE expands
+ to nothing and none of this is compiled in.
+
+ PROFILE_SCOPE(phase) times the rest of the enclosing block with rdtsc.
+ Time is exclusive: a scope nested inside another one, eg an eviction inside
+ an insert, is charged to its own phase and subtracted from the outer one.
+ With Profiler::get().enablePerf() (stats.perfCounters) LLC misses and branch
+ misses are read from a perf_event_open group at every scope boundary as
+ well; that is one read() per boundary, so it perturbs the timings and
+ should be used on its own. Only the simulation thread is instrumented.
+*/
+
+namespace misc
+{
+
+  enum ProfilePhase
+  {
+    PHASE_PARSE,
+    PHASE_FIND,
+    PHASE_INSERT,
+    PHASE_UPDATE,
+    PHASE_EVICT,
+    PHASE_GC,
+    PHASE_STATS,
+    NUM_PROFILE_PHASES
+  };
+
+  const char *const PROFILE_PHASE_NAMES[NUM_PROFILE_PHASES] = {"parse", "find", "insert", "update",
+                                                               "evict", "gc", "stats"};
+
+  enum ProfileEvent
+  {
+    EVENT_LLC_MISSES,
+    EVENT_BRANCH_MISSES,
+    NUM_PROFILE_EVENTS
+  };
+
+  const char *const PROFILE_EVENT_NAMES[NUM_PROFILE_EVENTS] = {"llc_misses", "branch_misses"};
+
+#ifdef PROFILE_PHASES
+
+  class Profiler
+  {
+  public:
+    struct Phase
+    {
+      uint64_t cycles;
+      uint64_t calls;
+      uint64_t events[NUM_PROFILE_EVENTS];
+    };
+
+    static Profiler &get()
+    {
+      static Profiler profiler;
+      return profiler;
+    }
+
+    static inline uint64_t cycles()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+      return __rdtsc();
+#else
+      return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                 std::chrono::steady_clock::now().time_since_epoch())
+          .count();
+#endif
+    }
+
+    // 打开硬件计数器组，失败时（如perf_event_paranoid限制）只统计时间
+    void enablePerf()
+    {
+      if (_perf_fd >= 0)
+      {
+        return;
+      }
+      const uint64_t configs[NUM_PROFILE_EVENTS] = {PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+      for (int i = 0; i < NUM_PROFILE_EVENTS; i++)
+      {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = configs[i];
+        attr.disabled = i == 0;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP;
+        int fd = syscall(__NR_perf_event_open, &attr, 0, -1, _perf_fd, 0);
+        if (fd < 0)
+        {
+          WARN("perf_event_open for %s failed, hardware counters disabled\n", PROFILE_EVENT_NAMES[i]);
+          if (_perf_fd >= 0)
+          {
+            close(_perf_fd);
+            _perf_fd = -1;
+          }
+          return;
+        }
+        if (i == 0)
+        {
+          _perf_fd = fd;
+        }
+      }
+      ioctl(_perf_fd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+
+    bool perfEnabled() const { return _perf_fd >= 0; }
+
+    inline void readEvents(uint64_t *events)
+    {
+      struct
+      {
+        uint64_t nr;
+        uint64_t values[NUM_PROFILE_EVENTS];
+      } group;
+      if (read(_perf_fd, &group, sizeof(group)) != sizeof(group))
+      {
+        memset(events, 0, sizeof(uint64_t) * NUM_PROFILE_EVENTS);
+        return;
+      }
+      memcpy(events, group.values, sizeof(group.values));
+    }
+
+    // 预热结束时与其他统计信息一起清零
+    void reset()
+    {
+      memset(_phases, 0, sizeof(_phases));
+    }
+
+    const Phase &phase(int p) const { return _phases[p]; }
+
+    // 用程序开始以来的墙钟时间校准rdtsc频率
+    double nsPerCycle() const
+    {
+      double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - _start_time).count();
+      uint64_t elapsed = cycles() - _start_cycles;
+      return elapsed > 0 ? ns / elapsed : 0;
+    }
+
+  private:
+    Profiler() : _start_cycles(cycles()), _start_time(std::chrono::steady_clock::now())
+    {
+      reset();
+    }
+
+    friend class PhaseTimer;
+
+    Phase _phases[NUM_PROFILE_PHASES];
+    int _perf_fd = -1;
+    uint64_t _start_cycles;
+    std::chrono::steady_clock::time_point _start_time;
+  };
+
+  class PhaseTimer
+  {
+  public:
+    inline PhaseTimer(ProfilePhase phase) : _phase(phase), _parent(_current)
+    {
+      _current = this;
+      Profiler &profiler = Profiler::get();
+      if (profiler.perfEnabled())
+      {
+        profiler.readEvents(_start_events);
+      }
+      _start = Profiler::cycles();
+    }
+
+    inline ~PhaseTimer()
+    {
+      uint64_t elapsed = Profiler::cycles() - _start;
+      Profiler &profiler = Profiler::get();
+      Profiler::Phase &phase = profiler._phases[_phase];
+      phase.cycles += elapsed - _child_cycles;
+      phase.calls++;
+      uint64_t events[NUM_PROFILE_EVENTS] = {0};
+      if (profiler.perfEnabled())
+      {
+        profiler.readEvents(events);
+        for (int i = 0; i < NUM_PROFILE_EVENTS; i++)
+        {
+          events[i] -= _start_events[i];
+          phase.events[i] += events[i] - _child_events[i];
+        }
+      }
+      _current = _parent;
+      if (_parent != nullptr)
+      {
+        _parent->_child_cycles += elapsed;
+        for (int i = 0; i < NUM_PROFILE_EVENTS; i++)
+        {
+          _parent->_child_events[i] += events[i];
+        }
+      }
+    }
+
+  private:
+    ProfilePhase _phase;
+    PhaseTimer *_parent;
+    uint64_t _start;
+    uint64_t _child_cycles = 0;
+    uint64_t _start_events[NUM_PROFILE_EVENTS] = {0};
+    uint64_t _child_events[NUM_PROFILE_EVENTS] = {0};
+
+    static inline thread_local PhaseTimer *_current = nullptr; // 当前线程最内层的计时器
+  };
+
+#define PROFILE_CONCAT(a, b) PASTE(a, b)
+#define PROFILE_SCOPE(phase) misc::PhaseTimer PROFILE_CONCAT(_phase_timer_, __LINE__)(phase)
+
+#else
+
+#define PROFILE_SCOPE(phase)
+
+#endif
+
+} // namespace misc
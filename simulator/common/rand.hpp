@@ -22,6 +22,57 @@ namespace misc
     uint64_t state;
   };
 
+  // splitmix64：用于从一个种子派生出多个互不相关的种子
+  inline uint64_t splitmix64(uint64_t &state)
+  {
+    uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+  }
+
+  /* xoshiro256** (Blackman & Vigna): a few ns per draw with full 64-bit
+   * quality, unlike the LCG above whose low bits are weak. Streams seeded
+   * from different seeds via splitmix64 are independent in practice. */
+  class Xoshiro256
+  {
+  public:
+    Xoshiro256(uint64_t seed = 0)
+    {
+      for (int i = 0; i < 4; i++)
+      {
+        s[i] = splitmix64(seed);
+      }
+    }
+
+    inline uint64_t next()
+    {
+      const uint64_t result = rotl(s[1] * 5, 7) * 9;
+      const uint64_t t = s[1] << 17;
+      s[2] ^= s[0];
+      s[3] ^= s[1];
+      s[1] ^= s[2];
+      s[0] ^= s[3];
+      s[2] ^= t;
+      s[3] = rotl(s[3], 45);
+      return result;
+    }
+
+    // [0, 1)上的均匀分布，取高53位
+    inline double nextDouble()
+    {
+      return (next() >> 11) * 0x1.0p-53;
+    }
+
+  private:
+    static inline uint64_t rotl(const uint64_t x, int k)
+    {
+      return (x << k) | (x >> (64 - k));
+    }
+
+    uint64_t s[4];
+  };
+
   template <class RealType = double>
   class UniformDistribution
   {
@@ -9,13 +9,31 @@ namespace cache
     const uint64_t CHECK_WARMUP_INTERVAL = 1000;
     const double INDEX_LOG_RATIO = 0.02;
     const uint64_t SIZE_BUCKETING = 10;
+    const uint64_t BLOCK_INDEX_ENTRY_BYTES = 16; // 建模的每个缓存块索引项大小：LBA键8B + 位置和替换算法状态8B
+
+}
+
+namespace stats
+{
+
+    const uint64_t STATS_WRITER_ROWS = 64;          // csv/bin统计输出的行缓冲区数量
+    const char STATS_BINARY_MAGIC[] = "LSCSTAT1";   // bin统计文件的8字节文件头
 
 }
 
 namespace parser
 {
 
-    const uint64_t FAST_FORWARD = 0;
+    const uint64_t FAST_FORWARD = 0; // 默认快进跳过的请求数，可由trace.fastForwardK覆盖
+    const uint64_t CSV_CHUNK_BYTES = 16 << 20; // trace.parseThreads > 0 时每个解析分块的大小
+    const uint32_t COLUMNAR_CHUNK_REQUESTS = 1 << 16; // 列式负载每个zstd块中的请求数
+    const int COLUMNAR_ZSTD_LEVEL = 3;
+    const uint32_t SEEKABLE_FRAME_REQUESTS = 1 << 16; // seekable zstd负载每帧的请求数
+    const uint64_t ANNOTATE_CHUNK_REQUESTS = 1 << 22;  // annotator反向处理时每块的请求数
+    const uint64_t ANNOTATE_SHARDS = 256;              // annotator按对象id划分的分片数
+    const uint64_t ANNOTATE_SHARD_SEED = 0x94d049bb133111ebULL;
+    const uint64_t ZIPF_BATCH_REQUESTS = 1 << 16;      // rejection-inversion zipf每批生成的请求数，每批一个独立随机数流
+    const uint64_t SYNTHETIC_RESIZE_REQUESTS = 1024;   // GrowingWSS负载每隔多少请求更新一次对象数量
 
 }
 
@@ -28,5 +46,12 @@ namespace flashCache
     const int RRIP_LONG_DIFF = 1;           // less than distant
     const int RRIP_DISTANT_DIFF = 1;
     const double AVG_OBJ_SIZE_BYTES = 330; // just for memory estimate
+    const int MAX_SET_CHOICES = 8;         // numHashFunctions + 1 must fit
+    const uint64_t SET_HASH_SEED = 0x9e3779b97f4a7c15ULL;
+    const int LOG_INDEX_TAG_BITS = 9;          // Kangaroo log index tag
+    const int LOG_INDEX_HIT_BITS = 4;          // saturating per-object hit counter
+    const uint64_t LOG_INDEX_PARTITIONS = 64;  // default log.indexPartitions
+    const uint64_t LOG_TAG_SEED = 0x2545f4914f6cdd1dULL;
+    const uint64_t BLOOM_HASH_SEED = 0xd6e8feb86659fd93ULL;
 
 }
@@ -56,9 +56,21 @@ int main(int argc, char* argv[]) {
     // // option.create_future_reuse_ccdf = true;
     // option.prob_at_age = true;
     // option.size_change = true;
+    // option.working_set = true;
 
     option.lifespan = true;
 
+    // 每个统计模块一个线程；按对象id分片标注请求的线程数
+    analyzer_params.module_threads =
+        cfg.read<bool>("analyzer.moduleThreads", analyzer_params.module_threads);
+    analyzer_params.n_shards =
+        cfg.read<int>("analyzer.shards", analyzer_params.n_shards);
+    // 溢出目录非空时，按对象id把请求分区写入磁盘，内存中只保存一个分区的对象元数据
+    analyzer_params.spill_dir =
+        cfg.read<const char*>("analyzer.spillDir", analyzer_params.spill_dir.c_str());
+    analyzer_params.n_spill_partitions = cfg.read<int>(
+        "analyzer.spillPartitions", analyzer_params.n_spill_partitions);
+
     // traceAnalyzer::TraceAnalyzer analyzer(parserInstance,
     // "/ssd1/output/twitter/cluster53/cluster53", option, analyzer_params);
     // traceAnalyzer::TraceAnalyzer analyzer(parserInstance,
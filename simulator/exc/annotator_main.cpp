@@ -0,0 +1,25 @@
+#include <thread>
+
+#include "annotator/trace_annotator.hpp"
+#include "common/logging.h"
+
+int main(int argc, char *argv[])
+{
+  if (argc < 4 || argc > 6)
+  {
+    fprintf(stderr, "Usage: ./annotator <input.bin|input.zst> <output.bin|output.zst> <input-format> [output-format] [threads]\n"
+                    "       output-format is IQQBQB or IQQBQBQ (default), threads defaults to all cores\n");
+    exit(-1);
+  }
+
+  std::string out_fmt = argc > 4 ? argv[4] : "IQQBQBQ";
+  int threads = argc > 5 ? atoi(argv[5]) : std::max(1u, std::thread::hardware_concurrency());
+
+  time_t start = time(NULL);
+  annotator::TraceAnnotator annotator(argv[1], argv[3], argv[2], out_fmt, threads);
+  annotator.run();
+  time_t end = time(NULL);
+
+  INFO("Annotated %lu requests in %ld seconds\n", (unsigned long)annotator.numRecords(), end - start);
+  return 0;
+}
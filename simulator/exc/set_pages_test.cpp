@@ -0,0 +1,104 @@
+#include <cassert>
+#include <cstdio>
+#include <vector>
+
+#include "kangaroo/set_pages.hpp"
+
+using namespace std;
+using flashCache::SetPages;
+
+// SetPages检查：集合增长后再缩小到一半以下，内容保持不变。
+// 用scons asan=1编译后运行，缩小时越界写会被AddressSanitizer报告
+
+// 槽位i的id、大小和rrpv
+static uint64_t idOf(uint32_t i) { return 1000 + i; }
+static uint32_t sizeOf(uint32_t i) { return 100 + i; }
+static int rrpvOf(uint32_t i) { return i % 8; }
+
+static int getRrpv(SetPages &pages, uint32_t slot)
+{
+  return (pages.rrpvWords(0)[slot / 16] >> (4 * (slot % 16))) & 0xF;
+}
+
+static void append(SetPages &pages, uint32_t i, bool rrpv)
+{
+  uint32_t count = pages.count(0);
+  pages.resize(0, count + 1);
+  pages.put(0, count, idOf(i), sizeOf(i));
+  if (rrpv)
+    pages.rrpvWords(0)[count / 16] |= (uint64_t)rrpvOf(i) << (4 * (count % 16));
+}
+
+// 与RripSets::_removeSlot相同，删除最后一个槽位前先清零它的rrpv
+static void popBack(SetPages &pages)
+{
+  uint32_t count = pages.count(0);
+  pages.rrpvWords(0)[(count - 1) / 16] &= ~(0xFULL << (4 * ((count - 1) % 16)));
+  pages.resize(0, count - 1);
+}
+
+// 与Sets::_insert相同，一次从头部删除n个对象
+static void popFront(SetPages &pages, uint32_t n)
+{
+  uint32_t count = pages.count(0) - n;
+  pages.move(0, 0, n, count);
+  pages.resize(0, count);
+}
+
+static void check(SetPages &pages, uint32_t first, bool rrpv)
+{
+  for (uint32_t slot = 0; slot < pages.count(0); slot++)
+  {
+    assert(pages.id(0, slot) == idOf(first + slot));
+    assert(pages.size(0, slot) == sizeOf(first + slot));
+    assert(!rrpv || getRrpv(pages, slot) == rrpvOf(slot));
+    assert(pages.find(0, idOf(first + slot)) == (int)slot);
+  }
+  // 未使用的槽位rrpv为0
+  for (uint32_t slot = pages.count(0); rrpv && slot % 16; slot++)
+  {
+    assert(getRrpv(pages, slot) == 0);
+  }
+}
+
+int main()
+{
+  // 一次删除多个对象：40个对象（48个槽位）缩小到10个（16个槽位）
+  {
+    SetPages pages(1, 4096, false);
+    for (uint32_t i = 0; i < 40; i++)
+      append(pages, i, false);
+    popFront(pages, 30);
+    assert(pages.count(0) == 10);
+    check(pages, 30, false);
+  }
+
+  // 逐个删除：rrpv字随槽位数一起缩小
+  {
+    SetPages pages(1, 4096, true);
+    for (uint32_t i = 0; i < 40; i++)
+      append(pages, i, true);
+    for (uint32_t n = 40; n > 0; n--)
+    {
+      popBack(pages);
+      check(pages, 0, true);
+    }
+  }
+
+  // 出现超过32位的id时扩展id数组，再缩小
+  {
+    SetPages pages(1, 4096, true);
+    for (uint32_t i = 0; i < 40; i++)
+      append(pages, i, true);
+    pages.resize(0, 41);
+    pages.put(0, 40, 1ULL << 40, 1);
+    assert(pages.id(0, 40) == 1ULL << 40);
+    pages.resize(0, 40);
+    for (uint32_t n = 40; n > 10; n--)
+      popBack(pages);
+    check(pages, 0, true);
+  }
+
+  printf("set_pages_test passed\n");
+  return 0;
+}
@@ -0,0 +1,111 @@
+#include <chrono>
+#include <random>
+#include <unistd.h>
+
+#include "kangaroo/rrip_sets.hpp"
+#include "stats/stats.hpp"
+#include "common/logging.h"
+
+using namespace std;
+
+// 集合层基准：按flash容量确定集合数（Kangaroo论文中集合层为TB级），
+// 先写满集合层，再测量插入和查找的每次操作耗时，以及每个集合的DRAM占用
+
+const uint64_t BENCH_BATCH = 64;        // 每批插入的对象数，相当于一次日志刷写
+const uint64_t BENCH_OPS = 4000000;     // 每个测量阶段的操作数
+const uint64_t MIN_OBJ_BYTES = 50;      // 对象大小在[50, 610)内均匀分布，平均约330字节
+const uint64_t OBJ_BYTES_SPAN = 560;
+
+static uint64_t residentBytes()
+{
+  FILE *f = fopen("/proc/self/statm", "r");
+  uint64_t total = 0, resident = 0;
+  if (f == nullptr || fscanf(f, "%lu %lu", &total, &resident) != 2)
+  {
+    ERROR("cannot read /proc/self/statm\n");
+  }
+  fclose(f);
+  return resident * sysconf(_SC_PAGESIZE);
+}
+
+// 对象大小由id决定，同一对象每次插入大小相同
+static candidate_t makeItem(uint64_t id)
+{
+  uint64_t h = id * 0x9e3779b97f4a7c15ULL;
+  return candidate_t{.id = id, .obj_size = (int64_t)(MIN_OBJ_BYTES + (h >> 32) % OBJ_BYTES_SPAN), .hit_count = 0, .oracle_count = 0};
+}
+
+static double nsPerOp(chrono::steady_clock::time_point start, uint64_t ops)
+{
+  return chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / ops;
+}
+
+int main(int argc, char *argv[])
+{
+  if (argc < 2 || argc > 5)
+  {
+    fprintf(stderr, "Usage: ./sets_bench <flash-GB> [set-bytes] [rrip-bits] [max-sets]\n"
+                    "  max-sets bounds the sets simulated; DRAM for the whole layer is extrapolated per set\n");
+    exit(-1);
+  }
+  uint64_t flash_bytes = (uint64_t)(atof(argv[1]) * (1ULL << 30));
+  uint64_t set_capacity = argc > 2 ? atoi(argv[2]) : 4096;
+  int rrip_bits = argc > 3 ? atoi(argv[3]) : 3;
+  uint64_t max_sets = argc > 4 ? atoll(argv[4]) : (1ULL << 22);
+  uint64_t total_sets = flash_bytes / set_capacity;
+  // 集合之间相互独立，集合过多时只模拟其中一部分，每个集合的负载不变
+  uint64_t num_sets = min(total_sets, max_sets);
+  if (num_sets == 0)
+  {
+    ERROR("flash smaller than one set\n");
+  }
+  // 对象数为集合层容量可容纳对象数的2倍，稳态下约一半的查找命中
+  uint64_t key_space = 2 * num_sets * set_capacity / (MIN_OBJ_BYTES + OBJ_BYTES_SPAN / 2);
+
+  stats::StatsCollector sc("/dev/null");
+  auto &set_stats = sc.createLocalCollector("sets");
+  uint64_t rss_before = residentBytes();
+  flashCache::RripSets sets(num_sets, set_capacity, set_stats, nullptr, 1, rrip_bits);
+  mt19937_64 rng(1);
+  vector<candidate_t> batch(BENCH_BATCH);
+  auto insertBatch = [&]()
+  {
+    for (auto &item : batch)
+    {
+      item = makeItem(rng() % key_space + 1);
+    }
+    sets.insert(batch);
+  };
+
+  // 写满集合层
+  for (uint64_t n = 0; n < 2 * key_space && sets.ratioCapacityUsed() < 0.95; n += BENCH_BATCH)
+  {
+    insertBatch();
+  }
+  uint64_t rss_after = residentBytes();
+
+  auto start = chrono::steady_clock::now();
+  for (uint64_t n = 0; n < BENCH_OPS; n += BENCH_BATCH)
+  {
+    insertBatch();
+  }
+  double insert_ns = nsPerOp(start, BENCH_OPS);
+
+  uint64_t hits = 0;
+  start = chrono::steady_clock::now();
+  for (uint64_t n = 0; n < BENCH_OPS; n++)
+  {
+    hits += sets.find(makeItem(rng() % key_space + 1));
+  }
+  double find_ns = nsPerOp(start, BENCH_OPS);
+
+  double dram_per_set = (rss_after - rss_before) / (double)num_sets;
+  printf("flash %.1f GB, %lu sets of %lu B (%lu simulated), rrip bits %d\n",
+         flash_bytes / (double)(1ULL << 30), total_sets, set_capacity, num_sets, rrip_bits);
+  printf("capacity used %.3f, find hit ratio %.3f\n", sets.ratioCapacityUsed(), hits / (double)BENCH_OPS);
+  printf("insert %.1f ns/object, find %.1f ns/lookup\n", insert_ns, find_ns);
+  printf("DRAM %.1f B/set (page image %.1f B/set), %.2f GB for the whole sets layer\n",
+         dram_per_set, set_stats["pageMemoryBytes"] / (double)num_sets,
+         dram_per_set * total_sets / (1ULL << 30));
+  return 0;
+}
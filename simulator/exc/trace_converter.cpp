@@ -0,0 +1,104 @@
+#include <sys/stat.h>
+
+#include "parsers/parser.hpp"
+#include "parsers/columnar_trace.hpp"
+#include "lib/zstdReader.h"
+#include "config_reader.hpp"
+#include "common/logging.h"
+
+using namespace std;
+
+parser::columnar::Writer *_writer;
+
+void convertRequest(const parser::Request *req)
+{
+  _writer->append(req);
+}
+
+// 将二进制负载（可以是普通zstd压缩的）重新压缩为按记录对齐的seekable zstd格式
+int writeSeekable(int argc, char *argv[])
+{
+  size_t record_bytes = atoi(argv[4]);
+  size_t frame_requests = argc > 5 ? atoi(argv[5]) : parser::SEEKABLE_FRAME_REQUESTS;
+  int zstd_level = argc > 6 ? atoi(argv[6]) : parser::COLUMNAR_ZSTD_LEVEL;
+  if (record_bytes == 0 || frame_requests == 0)
+  {
+    ERROR("record bytes and frame requests must be positive\n");
+  }
+  return zstd_write_seekable(argv[2], argv[3], record_bytes * frame_requests, zstd_level) == 0 ? 0 : EXIT_FAILURE;
+}
+
+int main(int argc, char *argv[])
+{
+  if (argc >= 5 && argc <= 7 && strcmp(argv[1], "--seekable") == 0)
+  {
+    return writeSeekable(argc, argv);
+  }
+  if (argc < 3 || argc > 5)
+  {
+    fprintf(stderr, "Usage: ./trace_converter <config-file> <output-file> [chunk-requests] [zstd-level]\n"
+                    "       ./trace_converter --seekable <input.bin|input.zst> <output.zst> <record-bytes> [frame-requests] [zstd-level]\n");
+    exit(-1);
+  }
+
+  libconfig::Config cfgFile;
+  try
+  {
+    cfgFile.readFile(argv[1]);
+  }
+  catch (const libconfig::FileIOException &fioex)
+  {
+    ERROR("I/O error while reading config file.\n");
+    return (EXIT_FAILURE);
+  }
+  catch (const libconfig::ParseException &pex)
+  {
+    ERROR("Parse error at %s:%d - %s\n", pex.getFile(), pex.getLine(), pex.getError());
+    return (EXIT_FAILURE);
+  }
+
+  // 输入负载沿用模拟器的trace配置，转换后的负载与原负载回放出的请求序列一致
+  const libconfig::Setting &root = cfgFile.getRoot();
+  misc::ConfigReader cfg(root);
+  parser::Parser *parserInstance = parser::Parser::create(root);
+
+  // 只有二进制负载携带下一次访问/失效时间字段
+  uint32_t column_mask = parser::columnar::BASE_COLUMNS;
+  std::string format = cfg.read<const char *>("trace.format");
+  if (format == "Binary" || format == "BlockBinary")
+  {
+    std::string fmt_str = cfg.read<const char *>("trace.formatString");
+    if (fmt_str.length() >= 6)
+    {
+      column_mask |= parser::columnar::NEXT_ACCESS_COLUMNS;
+    }
+    if (fmt_str.length() >= 7)
+    {
+      column_mask |= parser::columnar::FUTURE_INVALID_COLUMNS;
+    }
+  }
+  uint32_t chunk_requests = argc > 3 ? atoi(argv[3]) : parser::COLUMNAR_CHUNK_REQUESTS;
+  int zstd_level = argc > 4 ? atoi(argv[4]) : parser::COLUMNAR_ZSTD_LEVEL;
+  _writer = new parser::columnar::Writer(argv[2], column_mask, chunk_requests, zstd_level);
+
+  time_t start = time(NULL);
+  INFO("Start converting requests\n");
+  parserInstance->go(convertRequest);
+  _writer->finish();
+  time_t end = time(NULL);
+
+  uint64_t in_bytes = 0;
+  struct stat st;
+  if (!parserInstance->trace_path_.empty() && stat(parserInstance->trace_path_.c_str(), &st) == 0)
+  {
+    in_bytes = st.st_size;
+  }
+  INFO("Converted %lu requests in %ld seconds, %lu -> %lu bytes (%.2lf bytes/req)\n",
+       (unsigned long)_writer->numRequests(), end - start, (unsigned long)in_bytes,
+       (unsigned long)_writer->bytesWritten(),
+       1. * _writer->bytesWritten() / std::max<uint64_t>(_writer->numRequests(), 1));
+
+  delete parserInstance;
+  delete _writer;
+  return 0;
+}
@@ -1,3 +1,9 @@
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#include "common/hash.hpp"
+#include "common/logging.h"
 #include "constants.hpp"
 #include "rotating_log.hpp"
 #include "stats/stats.hpp"
@@ -6,14 +12,19 @@ namespace flashCache
 {
 
     // 添加了一个set逻辑结构，表示日志结构中各个对象所映射到的集合，在驱逐到集合缓存时会将其驱逐到对应的集合中
-    RotatingLog::RotatingLog(uint64_t log_capacity, uint64_t block_size, SetsAbstract *sets,
-                             stats::LocalStatsCollector &log_stats, uint64_t readmit) : _sets(sets),
-                                                                                        _log_stats(log_stats),
-                                                                                        _total_capacity(log_capacity),
-                                                                                        _total_size(0),
-                                                                                        _active_block(0),
-                                                                                        _readmit(readmit)
+    RotatingLog::RotatingLog(uint64_t log_capacity, uint64_t block_size, SetsAbstract *sets, uint64_t num_sets,
+                             stats::LocalStatsCollector &log_stats, uint64_t readmit,
+                             uint64_t num_partitions) : _sets(sets),
+                                                        _log_stats(log_stats),
+                                                        _num_partitions(num_partitions),
+                                                        _num_sets(num_sets),
+                                                        _total_capacity(log_capacity),
+                                                        _total_size(0),
+                                                        _active_block(0),
+                                                        _readmit(readmit)
     {
+        assert(_sets && _num_sets); // 索引按集合分桶
+        assert(_num_partitions > 0);
         _log_stats["logCapacity"] = _total_capacity; // 日志缓存容量
         _num_blocks = log_capacity / block_size;     // 擦除块数量
         Block template_block = Block(block_size);
@@ -25,6 +36,132 @@ namespace flashCache
             template_block._capacity = log_capacity % block_size;
             _blocks.push_back(template_block);
         }
+        if (_num_blocks >= (1ULL << 21))
+        {
+            ERROR("log has %lu blocks, the log index addresses at most 2^21, increase log.flushBlockSizeKB\n", _num_blocks);
+        }
+
+        _partitions.resize(_num_partitions);
+        for (auto &part : _partitions)
+        {
+            part.buckets.assign((_num_sets + _num_partitions - 1) / _num_partitions, NULL_ENTRY);
+        }
+
+        /* modeled layout of a real index entry: tag, hit counter, valid bit,
+         * flash page offset and a partition-local next pointer sized for the
+         * expected number of objects */
+        uint64_t num_pages = std::max<uint64_t>(_total_capacity / MIN_FLASH_WRITE_BYTES, 2);
+        uint64_t entries_per_partition = _total_capacity / AVG_OBJ_SIZE_BYTES / _num_partitions + 2;
+        _pointer_bits = (uint64_t)std::ceil(std::log2(entries_per_partition));
+        _entry_bits = LOG_INDEX_TAG_BITS + LOG_INDEX_HIT_BITS + 1 + (uint64_t)std::ceil(std::log2(num_pages)) + _pointer_bits;
+        _log_stats["indexEntryBits"] = _entry_bits;
+        std::cout << "Log index: " << _num_partitions << " partitions, "
+                  << _entry_bits << " bits per entry" << std::endl;
+    }
+
+    uint32_t RotatingLog::_tag(const candidate_t &item)
+    {
+        return misc::mix64(item.id, LOG_TAG_SEED) >> (64 - LOG_INDEX_TAG_BITS);
+    }
+
+    // 在索引中为对象分配表项，插入到所属集合链表的头部
+    void RotatingLog::_indexInsert(candidate_t item, uint64_t block)
+    {
+        uint64_t set_num = _setNum(item);
+        uint64_t part_num = set_num % _num_partitions;
+        IndexPartition &part = _partitions[part_num];
+        uint32_t idx = part.free_head;
+        if (idx != NULL_ENTRY)
+        {
+            part.free_head = part.entries[idx].next;
+        }
+        else
+        {
+            idx = part.entries.size();
+            if (idx >= NULL_ENTRY)
+            {
+                ERROR("log index partition %lu is full, increase log.indexPartitions\n", part_num);
+            }
+            part.entries.emplace_back();
+            part.flash.emplace_back();
+        }
+        uint32_t &head = part.buckets[set_num / _num_partitions];
+        IndexEntry &entry = part.entries[idx];
+        entry.next = head;
+        entry.block = block;
+        entry.tag = _tag(item);
+        entry.hits = 0;
+        entry.active = 1;
+        entry.flushed = 0;
+        head = idx;
+        part.flash[idx] = item;
+        part.num_entries++;
+        _blocks[block]._entries.push_back((part_num << 32) | idx);
+    }
+
+    // 将表项从所属集合的链表中摘除并回收
+    void RotatingLog::_indexRemove(uint64_t set_num, uint32_t idx)
+    {
+        IndexPartition &part = _partition(set_num);
+        uint32_t &head = part.buckets[set_num / _num_partitions];
+        if (head == idx)
+        {
+            head = part.entries[idx].next;
+        }
+        else
+        {
+            uint32_t prev = head;
+            while (part.entries[prev].next != idx)
+            {
+                prev = part.entries[prev].next;
+                assert(prev != NULL_ENTRY);
+            }
+            part.entries[prev].next = part.entries[idx].next;
+        }
+        part.entries[idx].next = part.free_head;
+        part.free_head = idx;
+        part.num_entries--;
+    }
+
+    // 沿集合链表比较tag，tag匹配时需要读flash确认对象id
+    uint32_t RotatingLog::_indexLookup(const candidate_t &item, uint64_t set_num, bool count_reads)
+    {
+        IndexPartition &part = _partition(set_num);
+        uint32_t tag = _tag(item);
+        for (uint32_t idx = part.buckets[set_num / _num_partitions]; idx != NULL_ENTRY; idx = part.entries[idx].next)
+        {
+            if (part.entries[idx].tag != tag)
+            {
+                continue;
+            }
+            if (count_reads)
+            {
+                _log_stats["flashReads"]++;
+            }
+            if (part.flash[idx].id == item.id)
+            {
+                return idx;
+            }
+            if (count_reads)
+            {
+                _log_stats["falsePositiveReads"]++;
+            }
+        }
+        return NULL_ENTRY;
+    }
+
+    void RotatingLog::_updateIndexStats()
+    {
+        uint64_t num_entries = 0;
+        for (auto &part : _partitions)
+        {
+            num_entries += part.num_entries;
+        }
+        _log_stats["indexEntries"] = num_entries;
+        if (num_entries)
+        {
+            _log_stats["indexBitsPerObject"] = (num_entries * _entry_bits + _num_sets * _pointer_bits) / num_entries;
+        }
     }
 
     // 插入一个对象
@@ -35,107 +172,123 @@ namespace flashCache
         _log_stats["stores_requested_bytes"] += item.obj_size;
         _total_size += item.obj_size;
         item.hit_count = 0;
-        _blocks[_active_block].insert(item); // 向开放块中插入对象
-        _per_item_hits[item] = 0;
-        if (_sets) // 若有set
-        {
-            uint64_t set_num = *(_sets->findSetNums(item).begin()); // 找到当前对象映射到的第一个集合
-            _set_to_items[set_num].push_back(item);                 // 在相应的集合中加入当前对象
-        }
-        _item_active[item] = true;
+        _indexInsert(item, _active_block); // 向开放块中插入对象
+        _blocks[_active_block]._size += item.obj_size;
         assert(_blocks[_active_block]._size <= _blocks[_active_block]._capacity);
     }
 
-    // 打开一个新开放块，驱逐其中所有有效对象
-    std::vector<candidate_t> RotatingLog::_incrementBlockAndFlush()
+    // 打开一个新开放块，擦除其中所有对象，返回需要下刷的集合
+    std::vector<uint64_t> RotatingLog::_incrementBlockAndFlush()
     {
-        std::vector<candidate_t> evicted;
+        std::vector<uint64_t> set_nums;
         _active_block = (_active_block + 1) % _num_blocks; // 下一个开放块
         Block &current_block = _blocks[_active_block];
 
         if (current_block._size) // 若当前开放块不为空，则先驱逐其中所有对象
         {
-            evicted.reserve(current_block._items.size());
-            for (auto item : current_block._items)
+            set_nums.reserve(current_block._entries.size());
+            for (uint64_t ref : current_block._entries)
             {
-                if (_item_active[item])
+                IndexPartition &part = _partitions[ref >> 32];
+                uint32_t idx = (uint32_t)ref;
+                uint64_t set_num = _setNum(part.flash[idx]);
+                if (part.entries[idx].active)
                 {
                     // only move if not already in sets
-                    evicted.push_back(item);
+                    part.entries[idx].flushed = 1;
+                    set_nums.push_back(set_num);
+                }
+                else
+                {
+                    _indexRemove(set_num, idx);
                 }
-                // should always remove an item, otherwise code bug
-                _item_active.erase(item);
             }
-            _log_stats["numEvictions"] += current_block._items.size();
+            _log_stats["numEvictions"] += current_block._entries.size();
             _log_stats["sizeEvictions"] += current_block._size;
             _log_stats["numLogFlushes"]++;
             _total_size -= current_block._size;
-            current_block._items.clear();
+            current_block._entries.clear();
             current_block._size = 0;
         }
-        return evicted;
+        return set_nums;
     }
 
-    //
-    std::vector<candidate_t> RotatingLog::_addSetMatches(std::vector<candidate_t> evicted)
+    // 按驱逐顺序，每个被驱逐的对象处理一次其集合：同一集合再次出现时，移动上次因EVICT_SET_LIMIT留下的对象
+    std::vector<candidate_t> RotatingLog::_addSetMatches(const std::vector<uint64_t> &set_nums)
     {
-        if (_sets == nullptr)
-        {
-            return evicted;
-        }
         std::vector<candidate_t> ret; // 要驱逐到集合缓存的对象
-        for (auto item : evicted)     // 遍历要驱逐的对象
+        std::vector<uint32_t> chain;
+        for (uint64_t set_num : set_nums)
         {
-            uint64_t set_num = *(_sets->findSetNums(item).begin()); // 当前对象映射到的集合
-            /* if already in set_indices, already moved over */
-            if (_set_to_items[set_num].size())
+            IndexPartition &part = _partition(set_num);
+            uint32_t &head = part.buckets[set_num / _num_partitions];
+            chain.clear();
+            for (uint32_t idx = head; idx != NULL_ENTRY; idx = part.entries[idx].next)
+            {
+                chain.push_back(idx);
+            }
+
+            // 链表头是最新插入的对象，按插入顺序从旧到新处理，留下的表项重新串成链表
+            uint64_t size_moved = 0;
+            uint32_t kept = NULL_ENTRY;
+            for (auto it = chain.rbegin(); it != chain.rend(); ++it)
             {
-                ret.reserve(ret.size() + _set_to_items[set_num].size()); // 预留空间
-                uint64_t size_moved = 0;
-                std::vector<candidate_t> not_moved;
-                for (auto item_evicted : _set_to_items[set_num]) // 遍历日志缓存中和当前对象属于同一集合的对象
+                uint32_t idx = *it;
+                IndexEntry &entry = part.entries[idx];
+                bool already_evicted = entry.flushed;
+                // 已经移动到集合的对象，或者要移动的对象大小已经超过阈值，留在日志中
+                if (!already_evicted && (!entry.active || size_moved > EVICT_SET_LIMIT))
                 {
-                    // 判断当前对象是否为有效对象，即是否已经被驱逐
-                    bool already_evicted = _item_active.find(item_evicted) == _item_active.end();
-                    // 若当前对象有效，但要移动的对象大小已经超过阈值
-                    if (!already_evicted && size_moved > EVICT_SET_LIMIT)
-                    {
-                        not_moved.push_back(item_evicted); // 不移动
-                        continue;
-                    }
-                    item_evicted.hit_count = _per_item_hits[item_evicted]; // 当前对象的命中次数
-                    size_moved += item_evicted.obj_size;                   // 移动对象的总大小
-                    ret.push_back(item_evicted);                           // 驱逐
+                    entry.next = kept;
+                    kept = idx;
+                    continue;
+                }
+                candidate_t item_evicted = part.flash[idx];
+                item_evicted.hit_count = entry.hits; // 当前对象的命中次数
+                size_moved += item_evicted.obj_size; // 移动对象的总大小
+                ret.push_back(item_evicted);         // 驱逐
 
-                    if (!already_evicted) // 若当前对象有效
-                    {
-                        // do not update stats for items force evicted
-                        _log_stats["num_early_evict"]++;
-                        _log_stats["size_early_evict"] += item_evicted.obj_size;
-                        _item_active[item_evicted] = false;
-                    }
+                if (already_evicted) // 所在块已被擦除，回收表项
+                {
+                    entry.next = part.free_head;
+                    part.free_head = idx;
+                    part.num_entries--;
+                }
+                else
+                {
+                    // do not update stats for items force evicted
+                    _log_stats["num_early_evict"]++;
+                    _log_stats["size_early_evict"] += item_evicted.obj_size;
+                    entry.active = 0;
+                    entry.next = kept;
+                    kept = idx;
                 }
-                _set_to_items[set_num] = not_moved;
             }
+            head = kept;
         }
         return ret;
     }
 
     std::vector<candidate_t> RotatingLog::insert(std::vector<candidate_t> items)
     {
-        std::vector<candidate_t> evicted;
+        std::vector<uint64_t> set_nums;
         for (auto item : items)
         {
             Block &current_block = _blocks[_active_block];
             if (item.obj_size + current_block._size > current_block._capacity) // 当前开放块不够容纳当前对象
             {
                 /* move active block pointer */
-                std::vector<candidate_t> local_evict = _incrementBlockAndFlush(); // 打开新的开放块，驱逐其中的对象
-                evicted.insert(evicted.end(), local_evict.begin(), local_evict.end());
+                std::vector<uint64_t> local_sets = _incrementBlockAndFlush(); // 打开新的开放块，擦除其中的对象
+                set_nums.insert(set_nums.end(), local_sets.begin(), local_sets.end());
             }
             _insert(item); // 在新的开放块中插入对象
         }
-        evicted = _addSetMatches(evicted); // 将与驱逐对象同一集合的对象加入到驱逐列表中
+        std::vector<candidate_t> evicted;
+        if (set_nums.size())
+        {
+            evicted = _addSetMatches(set_nums); // 将与擦除对象同一集合的对象一起驱逐
+            _updateIndexStats();
+        }
         assert(_total_capacity >= _total_size);
         _log_stats["current_size"] = _total_size;
         return evicted;
@@ -143,13 +296,13 @@ namespace flashCache
 
     void RotatingLog::insertFromSets(candidate_t item)
     {
-        uint64_t set_num = *(_sets->findSetNums(item).begin()); // 当前对象映射到的集合
-        if (_item_active.find(item) != _item_active.end())      // 对象有效，则不用再次插入到开放块中
+        uint64_t set_num = _setNum(item); // 当前对象映射到的集合
+        uint32_t idx = _indexLookup(item, set_num, false);
+        if (idx != NULL_ENTRY) // 对象仍在日志中，则不用再次插入到开放块中
         {
             _log_stats["num_early_evict"]--;                 // 撤销驱逐
             _log_stats["size_early_evict"] -= item.obj_size; // 撤销驱逐
-            _item_active[item] = true;
-            _set_to_items[set_num].push_back(item); // 在相应的集合中加入当前对象
+            _partition(set_num).entries[idx].active = 1;
             return;
         }
         Block &current_block = _blocks[_active_block]; // 当前开放块
@@ -164,25 +317,23 @@ namespace flashCache
         _log_stats["num_readmitted"]++;
         _log_stats["bytes_written"] += item.obj_size;
         _total_size += item.obj_size;
-        current_block.insert(item);
-        _item_active[item] = true;
-        _set_to_items[set_num].push_back(item);
-        _per_item_hits[item] = 0;
+        _indexInsert(item, _active_block);
+        current_block._size += item.obj_size;
     }
 
     void RotatingLog::readmit(std::vector<candidate_t> items)
     {
         for (auto item : items)
         {
-            uint64_t set_num = *(_sets->findSetNums(item).begin());
-            if (_item_active.find(item) != _item_active.end()) // 对象有效
+            uint64_t set_num = _setNum(item);
+            uint32_t idx = _indexLookup(item, set_num, false);
+            if (idx != NULL_ENTRY) // 对象仍在日志中
             {
                 _log_stats["num_early_evict"]--;
                 _log_stats["size_early_evict"] -= item.obj_size;
-                _item_active[item] = true;
-                _set_to_items[set_num].push_back(item);
+                _partition(set_num).entries[idx].active = 1;
             }
-            else if (_readmit && _per_item_hits[item] > _readmit) // 对象访问次数超过了准入阈值
+            else if (_readmit && (uint64_t)item.hit_count > _readmit) // 对象在日志中的命中次数超过了准入阈值
             {
                 // 当前开放块空间不够，将当前对象驱逐出flash cache
                 if (_blocks[_active_block]._size + item.obj_size > _blocks[_active_block]._capacity)
@@ -190,19 +341,15 @@ namespace flashCache
                     /* don't want to clean another block, could be back in this mess */
                     _log_stats["readmit_evicted"]++;
                     _log_stats["readmit_evicted_size"] += item.obj_size;
-                    _per_item_hits.erase(item);
                     continue;
                 }
                 _log_stats["bytes_readmitted"] += item.obj_size;
                 _log_stats["num_readmitted"]++;
                 _log_stats["bytes_written"] += item.obj_size;
-                _set_to_items[set_num].push_back(item);
                 _total_size += item.obj_size;
-                _blocks[_active_block].insert(item);
-                _per_item_hits[item] = 0;
-                _item_active[item] = true;
+                _indexInsert(item, _active_block);
+                _blocks[_active_block]._size += item.obj_size;
             }
-            _per_item_hits.erase(item);
         }
         _log_stats["current_size"] = _total_size;
         assert(_total_capacity >= _total_size);
@@ -210,29 +357,28 @@ namespace flashCache
 
     bool RotatingLog::find(candidate_t item)
     {
-        auto it = _item_active.find(item);
-        if (it == _item_active.end())
+        uint64_t set_num = _setNum(item);
+        uint32_t idx = _indexLookup(item, set_num, true);
+        if (idx == NULL_ENTRY)
         {
             _log_stats["misses"]++;
             return false;
         }
-        else if (!(it->second)) // 若在日志缓存中没找到
+        _log_stats["hits"]++;
+        if (!_partition(set_num).entries[idx].active) // 对象已经被移动到集合中
         {
-            _log_stats["hits"]++;
             // pass along for hit tracking in sets
             bool found = _sets->trackHit(item); // 在集合缓存中找
             if (!found)
             {
-                it->second = true;
+                _partition(set_num).entries[idx].active = 1;
             }
-            return true;
         }
-        else
+        else if (_partition(set_num).entries[idx].hits < MAX_HITS) // 饱和计数
         {
-            _log_stats["hits"]++;
-            _per_item_hits[item]++;
-            return true;
+            _partition(set_num).entries[idx].hits++;
         }
+        return true;
     }
 
     double RotatingLog::ratioCapacityUsed()
@@ -260,6 +406,16 @@ namespace flashCache
         _log_stats["size_early_evict"] = 0;
         _log_stats["bytes_rejected_from_sets"] = 0;
         _log_stats["num_rejected_from_sets"] = 0;
+        _log_stats["flashReads"] = 0;
+        _log_stats["falsePositiveReads"] = 0;
+    }
+
+    // DRAM中日志索引的大小：按预期对象数分配的表项加上每个集合一个链表头
+    uint64_t RotatingLog::calcMemoryConsumption()
+    {
+        uint64_t expected_entries = _total_capacity / AVG_OBJ_SIZE_BYTES;
+        uint64_t bits = expected_entries * _entry_bits + _num_sets * _pointer_bits;
+        return bits / 8;
     }
 
 } // namespace flashCache
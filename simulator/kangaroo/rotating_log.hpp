@@ -1,10 +1,8 @@
 #pragma once
 
 #include <vector>
-#include <list>
-#include <unordered_map>
-#include <unordered_set>
 #include "candidate.hpp"
+#include "constants.hpp"
 #include "log_abstract.hpp"
 #include "sets_abstract.hpp"
 #include "stats/stats.hpp"
@@ -17,8 +15,9 @@ namespace flashCache
     {
 
     public:
-        RotatingLog(uint64_t log_capacity, uint64_t block_size, SetsAbstract *sets,
-                    stats::LocalStatsCollector &log_stats, uint64_t readmit);
+        RotatingLog(uint64_t log_capacity, uint64_t block_size, SetsAbstract *sets, uint64_t num_sets,
+                    stats::LocalStatsCollector &log_stats, uint64_t readmit,
+                    uint64_t num_partitions = LOG_INDEX_PARTITIONS);
 
         /* ----------- Basic functionality --------------- */
 
@@ -46,45 +45,82 @@ namespace flashCache
 
         double calcWriteAmp();
         void flushStats(); // does not print update before clearing
+        uint64_t calcMemoryConsumption();
 
     private:
-        /* TODO: repetitive metadata structure, want to change in non-sim */
+        /* Kangaroo-style partitioned DRAM index. Sets are spread over partitions
+         * and each partition keeps one bucket (chain head) per set plus a table
+         * of chained entries, so a log flush finds everything headed for a set
+         * by walking one chain. Entries only hold a short tag, the object itself
+         * is only known after reading it from flash, so tag collisions show up
+         * as false-positive flash reads. */
+        struct IndexEntry
+        {
+            uint64_t next : 28;                // 同一集合链表中的下一个表项，NULL_ENTRY表示结尾
+            uint64_t block : 21;               // 对象所在的日志块
+            uint64_t tag : LOG_INDEX_TAG_BITS; // 对象id哈希的高位
+            uint64_t hits : LOG_INDEX_HIT_BITS;
+            uint64_t active : 1;               // 对象只在日志中，未被移动到集合
+            uint64_t flushed : 1;              // 所在日志块已被擦除，等待移动到集合
+        };
+        static_assert(sizeof(IndexEntry) == sizeof(uint64_t), "log index entries are packed into 64 bits");
+        static constexpr uint32_t NULL_ENTRY = (1u << 28) - 1;
+        static constexpr uint32_t MAX_HITS = (1u << LOG_INDEX_HIT_BITS) - 1;
+
+        struct IndexPartition
+        {
+            std::vector<uint32_t> buckets; // 每个集合一个链表头
+            std::vector<IndexEntry> entries;
+            std::vector<candidate_t> flash; // 与entries一一对应，表示flash上的对象内容，不计入DRAM
+            uint32_t free_head = NULL_ENTRY;
+            uint64_t num_entries = 0;
+        };
+
+        /* the flash contents of a block are tracked as references to its index
+         * entries, <partition, entry> packed into a uint64_t */
         struct Block
         {
-            std::unordered_set<candidate_t> _items;
+            std::vector<uint64_t> _entries;
             uint64_t _capacity;
             uint64_t _size;
 
             Block(uint64_t capacity) : _capacity(capacity), _size(0) {}
-
-            void insert(candidate_t item)
-            {
-                _items.insert(item);
-                _size += item.obj_size;
-                assert(_size <= _capacity);
-            }
         };
 
         void _insert(candidate_t item);
-        /* will only return forced evictions */
-        std::vector<candidate_t> _incrementBlockAndFlush();
-        /* adds set matches (assumes 1 hash) to evicted and marks them
-         * as duplicates in _item_to_block */
-        std::vector<candidate_t> _addSetMatches(std::vector<candidate_t> evicted);
+        /* marks the active block's entries as flushed and returns the sets that
+         * have to be drained, entries already moved to sets are dropped */
+        std::vector<uint64_t> _incrementBlockAndFlush();
+        /* moves the logged items of each set to the returned list (assumes 1 hash),
+         * flushed entries are removed from the index, others stay behind as
+         * inactive copies */
+        std::vector<candidate_t> _addSetMatches(const std::vector<uint64_t> &set_nums);
+
+        /* index helpers */
+        uint64_t _setNum(const candidate_t &item) { return _sets->findSetNums(item).front(); }
+        IndexPartition &_partition(uint64_t set_num) { return _partitions[set_num % _num_partitions]; }
+        uint32_t &_bucket(uint64_t set_num) { return _partition(set_num).buckets[set_num / _num_partitions]; }
+        uint32_t _tag(const candidate_t &item);
+        void _indexInsert(candidate_t item, uint64_t block);
+        void _indexRemove(uint64_t set_num, uint32_t idx);
+        /* returns the entry holding item or NULL_ENTRY, count_reads tracks flash reads
+         * for lookups from the request path */
+        uint32_t _indexLookup(const candidate_t &item, uint64_t set_num, bool count_reads);
+        void _updateIndexStats();
 
         SetsAbstract *_sets;
         stats::LocalStatsCollector &_log_stats;
         std::vector<Block> _blocks;
-        /* whether object is unique to log (ie not in sets) */
-        std::unordered_map<candidate_t, bool> _item_active;
-        std::unordered_map<candidate_t, uint64_t> _per_item_hits;
-        std::unordered_map<uint64_t, std::vector<candidate_t>> _set_to_items;
+        std::vector<IndexPartition> _partitions;
+        uint64_t _num_partitions;
+        uint64_t _num_sets;
         uint64_t _total_capacity;
         uint64_t _total_size;
         uint64_t _active_block;
         uint64_t _num_blocks;
-        bool _track_hits_per_item;
         uint64_t _readmit;
+        uint64_t _entry_bits;   // 真实布局下每个索引表项的位数
+        uint64_t _pointer_bits; // 真实布局下链表指针的位数
     };
 
 } // namespace flashCache
@@ -1,7 +1,9 @@
-#include <list>
+#include <cstring>
+#include <immintrin.h>
 #include <math.h>
 
 #include "caches/mem_log_sets_cache.hpp"
+#include "common/logging.h"
 #include "constants.hpp"
 #include "rrip_sets.hpp"
 #include "stats/stats.hpp"
@@ -11,64 +13,234 @@ namespace flashCache
 
     RripSets::RripSets(uint64_t num_sets, uint64_t set_capacity,
                        stats::LocalStatsCollector &set_stats, cache::MemLogSetsCache *ref_cache,
-                       int num_hash_functions, int bits, bool promotion_rrip, bool mixed_rrip) : _set_stats(set_stats),
-                                                                                                 _set_capacity(set_capacity),
-                                                                                                 _num_sets(num_sets),
-                                                                                                 _total_size(0),
-                                                                                                 _total_capacity(set_capacity * num_sets),
-                                                                                                 _cache(ref_cache),
-                                                                                                 _num_hash_functions(num_hash_functions),
-                                                                                                 _bits(bits),
-                                                                                                 _max_rrpv(exp2(bits) - RRIP_DISTANT_DIFF),
-                                                                                                 _mixed(mixed_rrip),
-                                                                                                 _promotion_only(promotion_rrip)
+                       int num_hash_functions, int bits, bool promotion_rrip, bool mixed_rrip,
+                       uint32_t max_items_per_set, double bloom_bits_per_object) : _set_stats(set_stats),
+                                                     _pages(num_sets, set_capacity, true),
+                                                     _max_items_per_set(max_items_per_set),
+                                                     _set_capacity(set_capacity),
+                                                     _num_sets(num_sets),
+                                                     _total_size(0),
+                                                     _total_capacity(set_capacity * num_sets),
+                                                     _cache(ref_cache),
+                                                     _num_hash_functions(num_hash_functions),
+                                                     _bits(bits),
+                                                     _max_rrpv(exp2(bits) - RRIP_DISTANT_DIFF),
+                                                     _mixed(mixed_rrip),
+                                                     _promotion_only(promotion_rrip),
+                                                     _bloom(num_sets, set_capacity / AVG_OBJ_SIZE_BYTES, bloom_bits_per_object)
     {
-        _bins.resize(_num_sets);
+        assert(_num_hash_functions < MAX_SET_CHOICES);
+        if (_bits < 1 || _bits > 4)
+        {
+            ERROR("rripBits must be in [1, 4] to fit packed rrpv nibbles, got %d\n", _bits);
+        }
+        _bin_sizes.resize(_num_sets, 0);
         _set_stats["numSets"] = _num_sets;                    // 集合数
         _set_stats["setCapacity"] = _set_capacity;            // 每个集合的容量
+        _set_stats["maxItemsPerSet"] = _max_items_per_set;    // 每个集合最多的对象数，0表示不限制
         _set_stats["numHashFunctions"] = _num_hash_functions; // 哈希函数数量
         _set_stats["rripBits"] = bits;                        // 每个缓存项使用的rrpv位数
+        if (_bloom.enabled())
+        {
+            _set_stats["bloomBitsPerSet"] = _bloom.bitsPerSet();
+            _set_stats["bloomMemoryBytes"] = _bloom.memoryBytes();
+            std::cout << "Set bloom filters: " << _bloom.bitsPerSet() << " bits per set, "
+                      << _bloom.numHashes() << " hashes" << std::endl;
+        }
+    }
+
+    int RripSets::_getRrpv(uint64_t bin_num, uint32_t slot)
+    {
+        return (_pages.rrpvWords(bin_num)[slot / 16] >> (4 * (slot % 16))) & 0xF;
+    }
+
+    void RripSets::_setRrpv(uint64_t bin_num, uint32_t slot, int rrpv)
+    {
+        uint64_t &word = _pages.rrpvWords(bin_num)[slot / 16];
+        int shift = 4 * (slot % 16);
+        word = (word & ~(0xFULL << shift)) | ((uint64_t)rrpv << shift);
+    }
+
+    // 集合中的最大rrpv值，未使用的槽位rrpv始终为0
+    int RripSets::_maxRrpv(uint64_t bin_num)
+    {
+        const uint64_t *words = _pages.rrpvWords(bin_num);
+        uint32_t num_words = (_pages.count(bin_num) + 15) / 16;
+        int max_rrpv = 0;
+#ifdef __SSE2__
+        const __m128i nibble = _mm_set1_epi8(0x0F);
+        __m128i vmax = _mm_setzero_si128();
+        uint32_t w = 0;
+        for (; w + 2 <= num_words; w += 2) // 每次处理32个rrpv
+        {
+            __m128i v = _mm_loadu_si128((const __m128i *)(words + w));
+            __m128i lo = _mm_and_si128(v, nibble);
+            __m128i hi = _mm_and_si128(_mm_srli_epi16(v, 4), nibble);
+            vmax = _mm_max_epu8(vmax, _mm_max_epu8(lo, hi));
+        }
+        vmax = _mm_max_epu8(vmax, _mm_srli_si128(vmax, 8));
+        vmax = _mm_max_epu8(vmax, _mm_srli_si128(vmax, 4));
+        vmax = _mm_max_epu8(vmax, _mm_srli_si128(vmax, 2));
+        vmax = _mm_max_epu8(vmax, _mm_srli_si128(vmax, 1));
+        max_rrpv = _mm_cvtsi128_si32(vmax) & 0xFF;
+        for (; w < num_words; w++)
+#else
+        for (uint32_t w = 0; w < num_words; w++)
+#endif
+        {
+            for (uint64_t word = words[w]; word; word >>= 4)
+            {
+                max_rrpv = std::max(max_rrpv, (int)(word & 0xF));
+            }
+        }
+        return max_rrpv;
+    }
+
+    // 第一个rrpv等于给定值的槽位，即具有该rrpv的最老对象
+    uint32_t RripSets::_firstSlotWithRrpv(uint64_t bin_num, int rrpv)
+    {
+        const uint64_t *words = _pages.rrpvWords(bin_num);
+        uint32_t count = _pages.count(bin_num);
+        uint32_t num_words = (count + 15) / 16;
+        uint32_t w = 0;
+#ifdef __SSE2__
+        const __m128i nibble = _mm_set1_epi8(0x0F);
+        const __m128i key = _mm_set1_epi8(rrpv);
+        for (; w + 2 <= num_words; w += 2)
+        {
+            __m128i v = _mm_loadu_si128((const __m128i *)(words + w));
+            __m128i lo = _mm_and_si128(v, nibble);
+            __m128i hi = _mm_and_si128(_mm_srli_epi16(v, 4), nibble);
+            // 交错低/高半字节，恢复槽位顺序
+            uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_unpacklo_epi8(lo, hi), key)) |
+                            ((uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_unpackhi_epi8(lo, hi), key)) << 16);
+            if (mask)
+            {
+                uint32_t slot = w * 16 + __builtin_ctz(mask);
+                assert(slot < count);
+                return slot;
+            }
+        }
+#endif
+        for (uint32_t slot = w * 16; slot < count; slot++)
+        {
+            if (_getRrpv(bin_num, slot) == rrpv)
+            {
+                return slot;
+            }
+        }
+        assert(false);
+        return count;
+    }
+
+    // 删除一个槽位，后面的槽位依次前移
+    void RripSets::_removeSlot(uint64_t bin_num, uint32_t slot)
+    {
+        uint32_t count = _pages.count(bin_num);
+        _pages.move(bin_num, slot, slot + 1, count - slot - 1);
+
+        uint64_t *words = _pages.rrpvWords(bin_num);
+        uint32_t last_word = (count - 1) / 16;
+        uint32_t w = slot / 16;
+        uint32_t off = slot % 16;
+        uint64_t low_mask = off ? (~0ULL >> (64 - 4 * off)) : 0;
+        for (; w <= last_word; w++)
+        {
+            uint64_t carry = (w + 1 <= last_word) ? (words[w + 1] & 0xF) : 0;
+            words[w] = (words[w] & low_mask) | ((words[w] >> 4) & ~low_mask) | (carry << 60);
+            low_mask = 0;
+        }
+        _pages.resize(bin_num, count - 1);
+    }
+
+    void RripSets::_appendSlot(uint64_t bin_num, candidate_t item, int rrpv)
+    {
+        uint32_t count = _pages.count(bin_num);
+        assert(!_max_items_per_set || count < _max_items_per_set);
+        _pages.resize(bin_num, count + 1);
+        _pages.put(bin_num, count, item.id, item.obj_size);
+        _setRrpv(bin_num, count, rrpv);
+    }
+
+    int RripSets::_findSlot(uint64_t bin_num, uint64_t id)
+    {
+        int best = -1;
+        _pages.find(bin_num, id, [&](int slot)
+                    {
+                        if (best < 0 || _getRrpv(bin_num, slot) > _getRrpv(bin_num, best))
+                        {
+                            best = slot;
+                        }
+                        return true; });
+        return best;
+    }
+
+    void RripSets::_promote(uint64_t bin_num, uint32_t slot)
+    {
+        int rrpv = _getRrpv(bin_num, slot);
+        if (rrpv == 0) // rrpv已经为0，位置不变
+        {
+            return;
+        }
+        candidate_t item = {.id = _pages.id(bin_num, slot),
+                            .obj_size = _pages.size(bin_num, slot),
+                            .hit_count = 0,
+                            .oracle_count = 0};
+        _removeSlot(bin_num, slot);
+        // 将对象的rrpv更新为0或减1，并放到末尾
+        _appendSlot(bin_num, item, (_mixed || _promotion_only) ? 0 : rrpv - 1);
     }
 
-    // 将指定集合中所有对象的rrpv值更新为最大rrpv值
+    // 将指定集合中所有对象的rrpv值整体增加，使最大rrpv等于_max_rrpv
     void RripSets::_incrementRrpvValues(uint64_t bin_num)
     {
-        Bin &bin = _bins[bin_num]; // 当前缓存集合
-        if (bin.rrpv_to_items.empty())
+        uint32_t count = _pages.count(bin_num); // 当前缓存集合中的对象数
+        if (count == 0)
         {
             return;
         }
 
         /* increment highest key to max rrpv value */
-        int current_max = (bin.rrpv_to_items.begin())->first; // 获取当前集合中的最大rrpv值
+        int current_max = _maxRrpv(bin_num); // 获取当前集合中的最大rrpv值
         int diff = _max_rrpv - current_max;
         if (diff <= 0)
         {
             return;
         }
 
-        auto it = bin.rrpv_to_items.begin();
-        while (it != bin.rrpv_to_items.end()) // 遍历所有rrpv值，将各个rrpv值的对象集合全部移动到最大rrpv的集合
+        // 每个半字节加diff，结果不超过_max_rrpv，不会进位到相邻半字节
+        uint64_t *words = _pages.rrpvWords(bin_num);
+        uint32_t num_words = (count + 15) / 16;
+        uint32_t w = 0;
+#ifdef __SSE2__
+        const __m128i add = _mm_set1_epi8((char)(diff * 0x11));
+        for (; w + 2 <= num_words; w += 2)
+        {
+            __m128i v = _mm_loadu_si128((const __m128i *)(words + w));
+            _mm_storeu_si128((__m128i *)(words + w), _mm_add_epi8(v, add));
+        }
+#endif
+        for (; w < num_words; w++)
         {
-            bin.rrpv_to_items[it->first + diff] = it->second;
-            it = bin.rrpv_to_items.erase(it);
+            words[w] += diff * 0x1111111111111111ULL;
+        }
+        // 未使用的槽位rrpv清零
+        if (count % 16)
+        {
+            words[num_words - 1] &= ~0ULL >> (64 - 4 * (count % 16));
         }
     }
 
-    // 计算rrip大于insertion_point的所有对象的大小总和
-    int64_t RripSets::_calcAllowableSize(Bin &bin, int insertion_point)
+    // 计算rrpv不小于insertion_point的所有对象的大小总和
+    int64_t RripSets::_calcAllowableSize(uint64_t bin_num, int insertion_point)
     {
         int64_t allowable_size = 0;
-        for (auto it = bin.rrpv_to_items.begin(); it != bin.rrpv_to_items.end(); it++)
+        for (uint32_t i = 0; i < _pages.count(bin_num); i++)
         {
-            if (it->first < insertion_point)
+            if (_getRrpv(bin_num, i) >= insertion_point)
             {
-                break;
+                allowable_size += _pages.size(bin_num, i);
             }
-            // 计算rrip不小于insertion_point的所有对象的大小总和
-            allowable_size += std::accumulate(it->second.begin(), it->second.end(), 0,
-                                              [](int64_t a, candidate_t b)
-                                              { return a + b.obj_size; });
         }
         return allowable_size;
     }
@@ -77,12 +249,12 @@ namespace flashCache
     std::vector<candidate_t> RripSets::_insert(candidate_t item, uint64_t bin_num)
     {
         assert((uint64_t)item.obj_size <= _set_capacity);
-        std::unordered_set<uint64_t> potential_bins = findSetNums(item); // 当前对象可能映射到的集合列表
-        assert(potential_bins.find(bin_num) != potential_bins.end());
+        SetNums potential_bins = findSetNums(item); // 当前对象可能映射到的集合列表
+        assert(potential_bins.contains(bin_num));
 
         std::vector<candidate_t> evicted;
         assert(!(item.obj_size == 0 && item.id == 0));
-        Bin &bin = _bins[bin_num]; // 要插入的集合
+        int64_t &bin_size = _bin_sizes[bin_num]; // 要插入的集合中对象的总大小
 
         // 计算当前对象的rrpv
         int insert_val = _max_rrpv - RRIP_LONG_DIFF - item.hit_count;
@@ -96,7 +268,7 @@ namespace flashCache
         }
 
         // 若当前对象大小大于已有对象大小之和，且当前集合容量不够容纳当前对象，则不准入当前对象
-        if (_calcAllowableSize(bin, insert_val) < item.obj_size && (uint64_t)item.obj_size + bin.bin_size > _set_capacity)
+        if (_calcAllowableSize(bin_num, insert_val) < item.obj_size && (uint64_t)item.obj_size + bin_size > _set_capacity)
         {
             _set_stats["numEvictions"]++;
             _set_stats["sizeEvictions"] += item.obj_size;
@@ -113,72 +285,70 @@ namespace flashCache
             return evicted;
         }
 
-        // 若准入当前对象，且集合空间不足，则驱逐直到空间足够容纳当前对象
-        while ((uint64_t)item.obj_size + bin.bin_size > _set_capacity)
+        // 若准入当前对象，且集合空间不足（或达到maxItemsPerSet），则驱逐rrpv最大的最老对象，直到能够容纳当前对象
+        while ((uint64_t)item.obj_size + bin_size > _set_capacity ||
+               (_max_items_per_set && _pages.count(bin_num) == _max_items_per_set))
         {
-            assert(!bin.rrpv_to_items.begin()->second.empty());
-            candidate_t old = bin.rrpv_to_items.begin()->second.front();
+            assert(_pages.count(bin_num) > 0);
+            if ((uint64_t)item.obj_size + bin_size <= _set_capacity)
+            {
+                _set_stats["numSlotLimitEvictions"]++; // 因达到maxItemsPerSet而驱逐
+            }
+            uint32_t victim = _firstSlotWithRrpv(bin_num, _maxRrpv(bin_num));
+            candidate_t old = {.id = _pages.id(bin_num, victim),
+                               .obj_size = _pages.size(bin_num, victim),
+                               .hit_count = 0,
+                               .oracle_count = 0};
             _set_stats["numEvictions"]++;
             _set_stats["sizeEvictions"] += old.obj_size;
-            bin.bin_size -= old.obj_size;
+            bin_size -= old.obj_size;
             _total_size -= old.obj_size;
             evicted.push_back(old);
-            bin.rrpv_to_items.begin()->second.pop_front();
-            if (bin.rrpv_to_items.begin()->second.empty()) // 若当前rrpv集合中的对象已经被驱逐完了
-            {
-                // 当你从std::map中删除一个项时，该项的键和值都会被销毁
-                bin.rrpv_to_items.erase(bin.rrpv_to_items.begin()); // 删除当前rrpv对应的集合，自动遍历下一个集合
-            }
+            _removeSlot(bin_num, victim);
         }
-        // 在C++的std::map中，如果你尝试访问一个不存在的键，会自动创建一个新的键值对，键是你提供的键，值是该类型的默认值
-        bin.rrpv_to_items[insert_val].push_back(item);
-        bin.bin_size += item.obj_size; // 当前集合中对象总大小
+        _appendSlot(bin_num, item, insert_val);
+        bin_size += item.obj_size;     // 当前集合中对象总大小
         _total_size += item.obj_size;  // 当前所有对象总大小
         _set_stats["current_size"] = _total_size;
         return evicted;
     }
 
-    // 插入一批对象
+    // 插入一批对象：整批计算集合号并按集合排序，每个集合的对象连续插入，集合只需重写一次
     std::vector<candidate_t> RripSets::insert(std::vector<candidate_t> items)
     {
-        std::vector<bool> sets_touched(_num_sets, false);
+        SetBatch batch = groupBySet(this, items);
         std::vector<candidate_t> evicted;
-        for (auto item : items) // 遍历要插入的对象
+        for (auto &run : batch.runs)
         {
-            uint64_t bin_num = *findSetNums(item).begin(); // 选取当前对象可能映射到的集合中的第一个
-            assert(bin_num < _num_sets);
-            if (!sets_touched[bin_num]) // 当前集合没被访问过
-            {
-                _incrementRrpvValues(bin_num);
-            }
-            sets_touched[bin_num] = true;
-            std::vector<candidate_t> local_evict = _insert(item, bin_num);         // 将对象插入到当前集合，获取驱逐对象列表
-            evicted.insert(evicted.end(), local_evict.begin(), local_evict.end()); // 将驱逐对象列表添加到总的驱逐对象列表中
-            _updateStatsRequestedStore(item);                                      // 更新存储的请求数量和总字节数
+            std::vector<candidate_t> local_evict = insert(run.set_num, batch.begin(run), batch.end(run));
+            evicted.insert(evicted.end(), local_evict.begin(), local_evict.end());
         }
-        // 插入所有对象后，共插入到了多少个集合
-        uint64_t num_sets_touched = std::count(sets_touched.begin(), sets_touched.end(), true);
-        _updateStatsActualStore(num_sets_touched); // 由于更新需要对整个集合进行重写，更新实际写入的字节数，即更新的集合数乘以集合容量
-        assert(_total_capacity >= _total_size);
-        return evicted; // 返回驱逐对象列表
+        return evicted;
     }
 
-    // 向指定集合插入一批对象
     std::vector<candidate_t> RripSets::insert(uint64_t set_num, std::vector<candidate_t> items)
+    {
+        return insert(set_num, items.data(), items.data() + items.size());
+    }
+
+    // 向指定集合插入一批对象
+    std::vector<candidate_t> RripSets::insert(uint64_t set_num, const candidate_t *first, const candidate_t *last)
     {
         std::vector<candidate_t> evicted;
         assert(set_num < _num_sets);
         _incrementRrpvValues(set_num);
-        for (auto item : items) // 遍历要插入的对象
+        for (auto it = first; it != last; ++it) // 遍历要插入的对象
         {
-            std::vector<candidate_t> local_evict = _insert(item, set_num);
+            std::vector<candidate_t> local_evict = _insert(*it, set_num);
             evicted.insert(evicted.end(), local_evict.begin(), local_evict.end());
-            _updateStatsRequestedStore(item);
         }
-        if (items.size() > 0)
+        if (first != last)
         {
+            _updateStatsRequestedStore(first, last);
             _updateStatsActualStore(1); // 只更新了1个集合，实际写入量为一个集合的容量
         }
+        _rebuildBloom(set_num);
+        _set_stats["pageMemoryBytes"] = _pages.memoryBytes();
         assert(_total_capacity >= _total_size);
         return evicted;
     }
@@ -190,53 +360,45 @@ namespace flashCache
     }
 
     // 更新请求指定的写入字节数
-    void RripSets::_updateStatsRequestedStore(candidate_t item)
+    void RripSets::_updateStatsRequestedStore(const candidate_t *first, const candidate_t *last)
     {
-        _set_stats["stores_requested"]++;
-        _set_stats["stores_requested_bytes"] += item.obj_size;
+        uint64_t bytes = 0;
+        for (auto it = first; it != last; ++it)
+        {
+            bytes += it->obj_size;
+        }
+        _set_stats["stores_requested"] += last - first;
+        _set_stats["stores_requested_bytes"] += bytes;
     }
 
     // 查找一个对象
     bool RripSets::find(candidate_t item)
     {
-        std::unordered_set<uint64_t> possible_bins = findSetNums(item); // 对象可能映射到的集合列表
+        SetNums possible_bins = findSetNums(item); // 对象可能映射到的集合列表
+        _set_stats["lookups"]++;
         for (uint64_t bin_num : possible_bins)
         { // 遍历可能映射到的集合
-            auto it = _bins[bin_num].rrpv_to_items.begin();
-            // 遍历当前集合中的所有rrpv值对应的deque
-            while (it != _bins[bin_num].rrpv_to_items.end())
+            // 布隆过滤器判断不在集合中时不需要读flash页
+            bool read_page = !_bloom.enabled() || _bloom.mayContain(bin_num, item.id);
+            int slot = read_page ? _findSlot(bin_num, item.id) : -1;
+            if (read_page)
             {
-                // 遍历deque中的各个对象
-                for (auto vec_it = it->second.begin(); vec_it != it->second.end(); vec_it++)
+                _set_stats["flashPageReads"]++;
+                if (slot < 0 && _bloom.enabled())
                 {
-                    if (*vec_it == item) // 找到了当前对象
-                    {
-                        if (it->first != 0) // 若对象所属的rrpv不为0
-                        {
-                            if (_mixed || _promotion_only)
-                            { // 将对象的rrpv更新为0
-                                _bins[bin_num].rrpv_to_items[0].push_back(*vec_it);
-                            }
-                            else
-                            { // 将对象的rrpv减1
-                                _bins[bin_num].rrpv_to_items[it->first - 1].push_back(*vec_it);
-                            }
-                            it->second.erase(vec_it); // 将对象从原rrpv的deque中删除
-                            if (it->second.empty())   // 若原rrpv的deque为空，则erase
-                            {
-                                _bins[bin_num].rrpv_to_items.erase(it);
-                            }
-                        }
-                        _set_stats["hits"]++;
-                        if (_hit_dist) // 按集合粒度统计的hit/miss分布
-                        {
-                            std::string name = "setHits" + std::to_string(bin_num);
-                            _set_stats[name]++;
-                        }
-                        return true;
-                    }
+                    _set_stats["bloomFalsePositiveReads"]++;
+                }
+            }
+            if (slot >= 0) // 找到了当前对象
+            {
+                _promote(bin_num, slot);
+                _set_stats["hits"]++;
+                if (_hit_dist) // 按集合粒度统计的hit/miss分布
+                {
+                    std::string name = "setHits" + std::to_string(bin_num);
+                    _set_stats[name]++;
                 }
-                it++;
+                return true;
             }
             if (_hit_dist) // 按集合粒度统计的hit/miss分布  // 这里是只要对集合进行了遍历读取且没找到要找的对象，就算miss
             {
@@ -250,18 +412,9 @@ namespace flashCache
     }
 
     // 获取当前对象能够映射到的集合列表
-    std::unordered_set<uint64_t> RripSets::findSetNums(candidate_t item)
+    SetNums RripSets::findSetNums(candidate_t item)
     {
-        std::unordered_set<uint64_t> possibilities;
-        uint64_t current_value = (uint64_t)item.id;    // 对象id
-        for (int i = 0; i <= _num_hash_functions; i++) // 根据哈希函数数量，计算当前对象能够映射到的各个集合
-        {
-            // 计算当前哈希值取模之后映射到的集合编号
-            possibilities.insert(current_value % _num_sets);
-            // 将当前哈希值使用std::hash、转string之后再次hash，作为下一次迭代的哈希值
-            current_value = std::hash<std::string>{}(std::to_string(std::hash<uint64_t>{}(current_value)));
-        }
-        return possibilities;
+        return calcSetNums(item.id, _num_sets, _num_hash_functions);
     }
 
     double RripSets::ratioCapacityUsed()
@@ -274,6 +427,27 @@ namespace flashCache
         return _set_stats["bytes_written"] / (double)_set_stats["stores_requested_bytes"];
     }
 
+    // 每次查找平均读取的flash页数
+    double RripSets::calcReadAmp()
+    {
+        int64_t lookups = _set_stats["lookups"];
+        return lookups ? _set_stats["flashPageReads"] / (double)lookups : 0.;
+    }
+
+    // 集合重写后按当前内容重建布隆过滤器
+    void RripSets::_rebuildBloom(uint64_t bin_num)
+    {
+        if (!_bloom.enabled())
+        {
+            return;
+        }
+        _bloom.clear(bin_num);
+        for (uint32_t i = 0; i < _pages.count(bin_num); i++)
+        {
+            _bloom.add(bin_num, _pages.id(bin_num, i));
+        }
+    }
+
     double RripSets::ratioEvictedToCapacity()
     {
         return _set_stats["sizeEvictions"] / (double)_total_capacity;
@@ -283,6 +457,9 @@ namespace flashCache
     {
         _set_stats["misses"] = 0;
         _set_stats["hits"] = 0;
+        _set_stats["lookups"] = 0;
+        _set_stats["flashPageReads"] = 0;
+        _set_stats["bloomFalsePositiveReads"] = 0;
         _set_stats["bytes_written"] = 0;
         _set_stats["stores_requested"] = 0;
         _set_stats["stores_requested_bytes"] = 0;
@@ -296,49 +473,26 @@ namespace flashCache
     // 估计set缓存的内存占用，主要是为每个对象所维护的rrpv元数据开销
     uint64_t RripSets::calcMemoryConsumption()
     {
-        /* TODO: add bloom filters */
         /* this is a strong estimate based on avg obj_size */
         // 每个集合使用的bit数 = 每个缓存项使用的bit数 * 每个集合中平均对象数量，直接使用了平均对象大小来进行统计
         double bits_per_set = _bits * (_set_capacity / AVG_OBJ_SIZE_BYTES);
         // 总内存占用 = 每个集合使用的bit数 * 集合数
         uint64_t sets_memory_consumption_bits = (uint64_t)bits_per_set * _num_sets;
-        return sets_memory_consumption_bits / 8; // 单位转换为字节
+        return sets_memory_consumption_bits / 8 + _bloom.memoryBytes(); // 单位转换为字节，加上布隆过滤器
     }
 
     // 跟find差不多，是在log中未命中，在set中再判断一下是否命中吗？
     bool RripSets::trackHit(candidate_t item)
     {
-        std::unordered_set<uint64_t> possible_bins = findSetNums(item);
+        SetNums possible_bins = findSetNums(item);
         for (uint64_t bin_num : possible_bins)
         {
-            auto it = _bins[bin_num].rrpv_to_items.begin();
-            while (it != _bins[bin_num].rrpv_to_items.end())
+            int slot = _findSlot(bin_num, item.id);
+            if (slot >= 0)
             {
-                for (auto vec_it = it->second.begin(); vec_it != it->second.end(); vec_it++)
-                {
-                    if (*vec_it == item)
-                    {
-                        if (it->first != 0)
-                        {
-                            if (_mixed || _promotion_only)
-                            {
-                                _bins[bin_num].rrpv_to_items[0].push_back(*vec_it);
-                            }
-                            else
-                            {
-                                _bins[bin_num].rrpv_to_items[it->first - 1].push_back(*vec_it);
-                            }
-                            it->second.erase(vec_it);
-                            if (it->second.empty())
-                            {
-                                _bins[bin_num].rrpv_to_items.erase(it);
-                            }
-                        }
-                        _set_stats["hitsSharedWithLog"]++;
-                        return true;
-                    }
-                }
-                it++;
+                _promote(bin_num, slot);
+                _set_stats["hitsSharedWithLog"]++;
+                return true;
             }
         }
         _set_stats["trackHitsFailed"]++;
@@ -1,11 +1,10 @@
 #pragma once
 
-#include <deque>
-#include <functional>
-#include <map>
 #include <vector>
 
 #include "candidate.hpp"
+#include "kangaroo/set_bloom.hpp"
+#include "kangaroo/set_pages.hpp"
 #include "log_abstract.hpp"
 #include "sets_abstract.hpp"
 #include "stats/stats.hpp"
@@ -25,7 +24,8 @@ namespace flashCache
         RripSets(uint64_t num_sets, uint64_t set_capacity,
                  stats::LocalStatsCollector &set_stats, cache::MemLogSetsCache *ref_cache = nullptr,
                  int num_hash_functions = 1, int bits = 2, bool promotion_rrip = false,
-                 bool mixed_rrip = false); // 默认哈希函数数量为1，为每个缓存项使用2位RRIP计数
+                 bool mixed_rrip = false, uint32_t max_items_per_set = 0,
+                 double bloom_bits_per_object = 0); // 默认哈希函数数量为1，为每个缓存项使用2位RRIP计数
         ~RripSets() {}
 
         /* ----------- Basic functionality --------------- */
@@ -39,6 +39,7 @@ namespace flashCache
          * will fail assert if any items cannot be matched to provided set_num
          */
         std::vector<candidate_t> insert(uint64_t set_num, std::vector<candidate_t> items);
+        std::vector<candidate_t> insert(uint64_t set_num, const candidate_t *first, const candidate_t *last);
 
         /* returns true if the item is in sets layer */
         bool find(candidate_t item);
@@ -46,7 +47,7 @@ namespace flashCache
         /* ----------- Useful for Admission Policies --------------- */
 
         /* returns the set numbers that item could be mapped to */
-        std::unordered_set<uint64_t> findSetNums(candidate_t item);
+        SetNums findSetNums(candidate_t item);
 
         /* returns ratio of total capacity used */
         double ratioCapacityUsed();
@@ -54,6 +55,7 @@ namespace flashCache
         /* ----------- Other Bookeeping --------------- */
 
         double calcWriteAmp();
+        double calcReadAmp();
         double ratioEvictedToCapacity();
         void flushStats(); // does not print update before clearing
         uint64_t calcMemoryConsumption();
@@ -62,15 +64,16 @@ namespace flashCache
         void enableHitDistributionOverSets();
 
     private:
-        struct Bin
-        {
-            // rrpv = re-reference pointer value
-            // rrpv到缓存项的映射，即哪些对象具有当前rrpv值
-            std::map<int, std::deque<candidate_t>, std::greater<int>> rrpv_to_items; // 按照键值降序排列
-            int64_t bin_size;
-        };
+        /* each set's ids, sizes and rrpv (re-reference prediction value)
+         * nibbles are packed in _pages. Slots are kept in the order items
+         * entered their current rrpv, so for any rrpv the first slot holding
+         * it is the oldest item with that value. */
         stats::LocalStatsCollector &_set_stats;
-        std::vector<Bin> _bins; // 多路映射缓存集合，一个Bin为一个集合
+        std::vector<int64_t> _bin_sizes; // 每个集合中对象的总大小
+        SetPages _pages;
+        /* optional cap on the objects per set (sets.maxItemsPerSet), 0 for
+         * none; a set at the cap evicts like a full one */
+        uint32_t _max_items_per_set;
         uint64_t _set_capacity;
         uint64_t _num_sets;
         uint64_t _total_size;
@@ -81,6 +84,9 @@ namespace flashCache
         int _max_rrpv;
         bool _dist_tracking = false;
         bool _hit_dist = false;
+        SetBloomFilters _bloom; // 每个集合的布隆过滤器，在集合重写时重建
+
+        void _rebuildBloom(uint64_t bin_num);
 
         /*
          * control promotion rrip where items reset to 0 on hit instead
@@ -95,12 +101,27 @@ namespace flashCache
          */
         std::vector<candidate_t> _insert(candidate_t item, uint64_t bin_num);
 
-        int64_t _calcAllowableSize(Bin &bin, int insertion_point);
+        int64_t _calcAllowableSize(uint64_t bin_num, int insertion_point);
         void _incrementRrpvValues(uint64_t bin_num);
 
+        /* packed rrpv lane helpers */
+        int _getRrpv(uint64_t bin_num, uint32_t slot);
+        void _setRrpv(uint64_t bin_num, uint32_t slot, int rrpv);
+        int _maxRrpv(uint64_t bin_num);
+        uint32_t _firstSlotWithRrpv(uint64_t bin_num, int rrpv);
+        void _removeSlot(uint64_t bin_num, uint32_t slot);
+        void _appendSlot(uint64_t bin_num, candidate_t item, int rrpv);
+
+        /* slot of id in set, -1 if absent; duplicates resolve to the highest
+         * rrpv, oldest first, like the previous per-rrpv queues */
+        int _findSlot(uint64_t bin_num, uint64_t id);
+
+        /* hit on slot, promote (to 0 or by one) and requeue */
+        void _promote(uint64_t bin_num, uint32_t slot);
+
         /* update stats related to flash writes */
         void _updateStatsActualStore(uint64_t num_sets_updated);
-        void _updateStatsRequestedStore(candidate_t item);
+        void _updateStatsRequestedStore(const candidate_t *first, const candidate_t *last);
     };
 
 } // namespace flashCache
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <stdint.h>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "common/hash.hpp"
+#include "constants.hpp"
+
+namespace flashCache
+{
+
+    /* one fixed-size Bloom filter per set, kept in DRAM so that a sets lookup
+     * only reads the set's flash page when the filter says the object may be
+     * there; filters are rebuilt from scratch whenever their set is rewritten,
+     * so they never hold stale members. Disabled when bits_per_object is 0 */
+    class SetBloomFilters
+    {
+    public:
+        SetBloomFilters(uint64_t num_sets, uint64_t expected_items_per_set, double bits_per_object)
+        {
+            if (bits_per_object <= 0)
+            {
+                return;
+            }
+            _words_per_set = std::max<uint64_t>(1, (uint64_t)std::ceil(expected_items_per_set * bits_per_object / 64));
+            _bits_per_set = _words_per_set * 64;
+            // 最优哈希函数个数 k = (m/n) * ln2
+            _num_hashes = std::min(8, std::max(1, (int)std::round(bits_per_object * std::log(2.))));
+            _bits.assign(num_sets * _words_per_set, 0);
+        }
+
+        bool enabled() const { return _words_per_set != 0; }
+
+        void clear(uint64_t set_num)
+        {
+            std::fill(_bits.begin() + set_num * _words_per_set, _bits.begin() + (set_num + 1) * _words_per_set, 0);
+        }
+
+        void add(uint64_t set_num, uint64_t id)
+        {
+            uint64_t *words = _bits.data() + set_num * _words_per_set;
+            uint64_t h = misc::mix64(id, BLOOM_HASH_SEED);
+            uint64_t delta = (h >> 32) | (h << 32) | 1; // 双重哈希生成k个位置
+            for (int i = 0; i < _num_hashes; i++, h += delta)
+            {
+                uint64_t bit = misc::fastRange(h, _bits_per_set);
+                words[bit / 64] |= 1ULL << (bit % 64);
+            }
+        }
+
+        bool mayContain(uint64_t set_num, uint64_t id) const
+        {
+            const uint64_t *words = _bits.data() + set_num * _words_per_set;
+            uint64_t h = misc::mix64(id, BLOOM_HASH_SEED);
+            uint64_t delta = (h >> 32) | (h << 32) | 1;
+            for (int i = 0; i < _num_hashes; i++, h += delta)
+            {
+                uint64_t bit = misc::fastRange(h, _bits_per_set);
+                if (!(words[bit / 64] & (1ULL << (bit % 64))))
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        uint64_t bitsPerSet() const { return _bits_per_set; }
+        int numHashes() const { return _num_hashes; }
+        uint64_t memoryBytes() const { return _bits.size() * sizeof(uint64_t); }
+
+    private:
+        uint64_t _words_per_set = 0;
+        uint64_t _bits_per_set = 0;
+        int _num_hashes = 0;
+        std::vector<uint64_t> _bits;
+    };
+
+} // namespace flashCache
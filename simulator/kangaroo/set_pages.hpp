@@ -0,0 +1,264 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <vector>
+#include <immintrin.h>
+
+namespace flashCache
+{
+
+    /* DRAM image of the sets' flash pages. Each set owns one allocation with
+     * the packed lanes of its objects, in flash order: ids, sizes and, for
+     * RRIP, 4-bit rrpvs packed 16 per word. Lanes grow in steps of SLOT_STEP
+     * slots as a set fills and shrink when it empties, so memory follows the
+     * objects actually stored, not the page's worst case. Ids are 4 bytes
+     * while every id seen fits (all pages widen to 8 bytes the first time one
+     * does not), sizes are 2 bytes when a page is at most 64 KiB. There is no
+     * slot limit: a page holds as many objects as its bytes allow */
+    class SetPages
+    {
+    public:
+        static const uint32_t SLOT_STEP = 16; // 一个rrpv字，或两次AVX2比较的4字节id
+
+        SetPages(uint64_t num_sets, uint64_t set_capacity, bool rrpv_lane)
+            : _pages(num_sets), _size_bytes(set_capacity <= UINT16_MAX ? 2 : 4), _rrpv_lane(rrpv_lane)
+        {
+        }
+
+        ~SetPages()
+        {
+            for (auto &page : _pages)
+            {
+                free(page.data);
+            }
+        }
+
+        inline uint32_t count(uint64_t set_num) const { return _pages[set_num].count; }
+
+        inline uint64_t id(uint64_t set_num, uint32_t slot) const
+        {
+            const Page &page = _pages[set_num];
+            assert(slot < page.slots);
+            return _wide_ids ? ((const uint64_t *)page.data)[slot] : ((const uint32_t *)page.data)[slot];
+        }
+
+        inline uint32_t size(uint64_t set_num, uint32_t slot) const
+        {
+            const Page &page = _pages[set_num];
+            const uint8_t *sizes = _sizeLane(page);
+            return _size_bytes == 2 ? ((const uint16_t *)sizes)[slot] : ((const uint32_t *)sizes)[slot];
+        }
+
+        // 写入一个槽位，槽位须在resize分配的范围内
+        inline void put(uint64_t set_num, uint32_t slot, uint64_t id, uint32_t size)
+        {
+            if (!_wide_ids && id > UINT32_MAX)
+            {
+                _widenIds();
+            }
+            Page &page = _pages[set_num];
+            assert(slot < page.slots);
+            if (_wide_ids)
+                ((uint64_t *)page.data)[slot] = id;
+            else
+                ((uint32_t *)page.data)[slot] = (uint32_t)id;
+            uint8_t *sizes = _sizeLane(page);
+            if (_size_bytes == 2)
+                ((uint16_t *)sizes)[slot] = (uint16_t)size;
+            else
+                ((uint32_t *)sizes)[slot] = size;
+        }
+
+        // 将n个槽位的id和大小从src移动到dst（可重叠），rrpv由调用者维护
+        inline void move(uint64_t set_num, uint32_t dst, uint32_t src, uint32_t n)
+        {
+            if (n == 0)
+                return;
+            Page &page = _pages[set_num];
+            int id_bytes = _idBytes();
+            memmove(page.data + dst * id_bytes, page.data + src * id_bytes, n * id_bytes);
+            uint8_t *sizes = _sizeLane(page);
+            memmove(sizes + dst * _size_bytes, sizes + src * _size_bytes, n * _size_bytes);
+        }
+
+        /* sets the number of objects in the set, growing the lanes when
+         * needed and shrinking them when less than half is used; slots past
+         * the old count are left for the caller to fill */
+        void resize(uint64_t set_num, uint32_t count)
+        {
+            Page &page = _pages[set_num];
+            uint32_t needed = (count + SLOT_STEP - 1) / SLOT_STEP * SLOT_STEP;
+            if (needed > page.slots || needed < page.slots / 2)
+            {
+                _relayout(page, needed, _wide_ids, std::min(page.count, count));
+            }
+            page.count = count;
+        }
+
+        // 集合的rrpv字，16个槽位一个字，未使用槽位的rrpv为0
+        inline uint64_t *rrpvWords(uint64_t set_num)
+        {
+            assert(_rrpv_lane);
+            Page &page = _pages[set_num];
+            return (uint64_t *)(_sizeLane(page) + page.slots * _size_bytes);
+        }
+
+        /* slot of the first (oldest) copy of id in the set, -1 if absent.
+         * fn(slot) is called on every copy when given */
+        template <typename Fn>
+        int find(uint64_t set_num, uint64_t id, Fn &&fn) const
+        {
+            const Page &page = _pages[set_num];
+            int first = -1;
+            uint32_t i = 0;
+            if (_wide_ids)
+            {
+                const uint64_t *ids = (const uint64_t *)page.data;
+#ifdef __AVX2__
+                __m256i key = _mm256_set1_epi64x(id);
+                for (; i + 4 <= page.count; i += 4) // 每次比较4个id
+                {
+                    __m256i lane = _mm256_loadu_si256((const __m256i *)(ids + i));
+                    int mask = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(lane, key)));
+                    for (; mask; mask &= mask - 1)
+                    {
+                        int slot = i + __builtin_ctz(mask);
+                        first = first < 0 ? slot : first;
+                        if (!fn(slot))
+                            return first;
+                    }
+                }
+#endif
+                for (; i < page.count; i++)
+                {
+                    if (ids[i] == id)
+                    {
+                        first = first < 0 ? (int)i : first;
+                        if (!fn(i))
+                            return first;
+                    }
+                }
+                return first;
+            }
+            if (id > UINT32_MAX) // 所有id都不超过32位
+            {
+                return -1;
+            }
+            const uint32_t *ids = (const uint32_t *)page.data;
+#ifdef __AVX2__
+            __m256i key = _mm256_set1_epi32((uint32_t)id);
+            for (; i + 8 <= page.count; i += 8) // 每次比较8个id
+            {
+                __m256i lane = _mm256_loadu_si256((const __m256i *)(ids + i));
+                int mask = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(lane, key)));
+                for (; mask; mask &= mask - 1)
+                {
+                    int slot = i + __builtin_ctz(mask);
+                    first = first < 0 ? slot : first;
+                    if (!fn(slot))
+                        return first;
+                }
+            }
+#endif
+            for (; i < page.count; i++)
+            {
+                if (ids[i] == (uint32_t)id)
+                {
+                    first = first < 0 ? (int)i : first;
+                    if (!fn(i))
+                        return first;
+                }
+            }
+            return first;
+        }
+
+        int find(uint64_t set_num, uint64_t id) const
+        {
+            return find(set_num, id, [](int)
+                        { return false; });
+        }
+
+        // 页面镜像占用的内存：槽位数组、每个集合的页头和分配的空间
+        uint64_t memoryBytes() const { return _pages.size() * sizeof(Page) + _bytes; }
+
+    private:
+        struct Page
+        {
+            uint8_t *data = nullptr; // id数组，大小数组，rrpv字
+            uint32_t count = 0;
+            uint32_t slots = 0; // 已分配的槽位数
+        };
+
+        inline int _idBytes() const { return _wide_ids ? 8 : 4; }
+        inline uint64_t _pageBytes(uint32_t slots, bool wide) const
+        {
+            return (uint64_t)slots * ((wide ? 8 : 4) + _size_bytes) + (_rrpv_lane ? slots / 16 * 8 : 0);
+        }
+        inline uint8_t *_sizeLane(const Page &page) const { return page.data + page.slots * _idBytes(); }
+
+        /* reallocates the page for the new slot count and id width, keeping
+         * the first keep objects (keep <= slots; shrinking drops the rest) */
+        void _relayout(Page &page, uint32_t slots, bool wide, uint32_t keep)
+        {
+            assert(keep <= slots && keep <= page.count);
+            uint8_t *data = nullptr;
+            if (slots > 0)
+            {
+                data = (uint8_t *)calloc(_pageBytes(slots, wide), 1);
+                assert(data);
+                int old_id_bytes = _idBytes();
+                if (wide && !_wide_ids)
+                {
+                    for (uint32_t i = 0; i < keep; i++)
+                        ((uint64_t *)data)[i] = ((const uint32_t *)page.data)[i];
+                }
+                else
+                {
+                    memcpy(data, page.data, (uint64_t)keep * old_id_bytes);
+                }
+                uint8_t *sizes = data + slots * (wide ? 8 : 4);
+                memcpy(sizes, _sizeLane(page), (uint64_t)keep * _size_bytes);
+                if (_rrpv_lane && keep > 0)
+                {
+                    uint64_t *old_rrpvs = (uint64_t *)(_sizeLane(page) + page.slots * _size_bytes);
+                    uint64_t *rrpvs = (uint64_t *)(sizes + slots * _size_bytes);
+                    memcpy(rrpvs, old_rrpvs, (uint64_t)(keep + 15) / 16 * 8);
+                    // 丢弃的槽位rrpv清零
+                    if (keep % 16)
+                    {
+                        rrpvs[keep / 16] &= ~0ULL >> (64 - 4 * (keep % 16));
+                    }
+                }
+            }
+            _bytes -= page.data ? _pageBytes(page.slots, _wide_ids) : 0;
+            _bytes += _pageBytes(slots, wide);
+            free(page.data);
+            page.data = data;
+            page.slots = slots;
+        }
+
+        // 出现超过32位的id时，所有页面的id数组扩展为8字节
+        void _widenIds()
+        {
+            for (auto &page : _pages)
+            {
+                if (page.data != nullptr)
+                {
+                    _relayout(page, page.slots, true, page.count);
+                }
+            }
+            _wide_ids = true;
+        }
+
+        std::vector<Page> _pages;
+        int _size_bytes;
+        bool _rrpv_lane;
+        bool _wide_ids = false;
+        uint64_t _bytes = 0; // 所有页面分配的字节数
+    };
+
+} // namespace flashCache
@@ -1,4 +1,4 @@
-#include <list>
+#include <algorithm>
 
 #include "caches/mem_log_sets_cache.hpp"
 #include "constants.hpp"
@@ -10,27 +10,33 @@ namespace flashCache
 
     Sets::Sets(uint64_t num_sets, uint64_t set_capacity,
                stats::LocalStatsCollector &set_stats, cache::MemLogSetsCache *ref_cache,
-               int num_hash_functions, bool nru) : _set_stats(set_stats),
-                                                   _set_capacity(set_capacity),
-                                                   _num_sets(num_sets),
-                                                   _total_size(0),
-                                                   _total_capacity(set_capacity * num_sets),
-                                                   _cache(ref_cache),
-                                                   _num_hash_functions(num_hash_functions),
-                                                   _nru(nru)
+               int num_hash_functions, bool nru, uint32_t max_items_per_set,
+               double bloom_bits_per_object) : _set_stats(set_stats),
+                                                _pages(num_sets, set_capacity, false),
+                                                _max_items_per_set(max_items_per_set),
+                                                _set_capacity(set_capacity),
+                                                _num_sets(num_sets),
+                                                _total_size(0),
+                                                _total_capacity(set_capacity * num_sets),
+                                                _cache(ref_cache),
+                                                _num_hash_functions(num_hash_functions),
+                                                _nru(nru),
+                                                _bloom(num_sets, set_capacity / AVG_OBJ_SIZE_BYTES, bloom_bits_per_object)
     {
-        _bins.resize(_num_sets);
+        static_assert(HIT_BIT_VECTOR_SIZE <= 32, "hit bits are packed into a uint32_t per set");
+        assert(_num_hash_functions < MAX_SET_CHOICES);
+        _bins.resize(_num_sets, Bin{0, 0, 0});
         _set_stats["numSets"] = _num_sets;
         _set_stats["setCapacity"] = _set_capacity;
+        _set_stats["maxItemsPerSet"] = _max_items_per_set;
         _set_stats["numHashFunctions"] = _num_hash_functions;
         _set_stats["nru"] = _nru;
-        if (_nru)
+        if (_bloom.enabled())
         {
-            _hits_in_sets.resize(_num_sets);
-            for (auto &set_hits : _hits_in_sets)
-            {
-                set_hits.resize(HIT_BIT_VECTOR_SIZE, false);
-            }
+            _set_stats["bloomBitsPerSet"] = _bloom.bitsPerSet();
+            _set_stats["bloomMemoryBytes"] = _bloom.memoryBytes();
+            std::cout << "Set bloom filters: " << _bloom.bitsPerSet() << " bits per set, "
+                      << _bloom.numHashes() << " hashes" << std::endl;
         }
     }
 
@@ -38,14 +44,30 @@ namespace flashCache
     std::vector<candidate_t> Sets::_insert(candidate_t item, uint64_t bin_num)
     {
         assert((uint64_t)item.obj_size <= _set_capacity);
-        std::unordered_set<uint64_t> potential_bins = findSetNums(item); // 可能映射到的集合列表
-        assert(potential_bins.find(bin_num) != potential_bins.end());    // 给定的bin_num须在映射到的potential_bins中
+        SetNums potential_bins = findSetNums(item);   // 可能映射到的集合列表
+        assert(potential_bins.contains(bin_num)); // 给定的bin_num须在映射到的potential_bins中
 
         std::vector<candidate_t> evicted;
         assert(!(item.obj_size == 0 && item.id == 0));
         Sets::Bin &bin = _bins[bin_num];
-        assert(std::find(bin.items.begin(), bin.items.end(), item) == bin.items.end());
-        while ((uint64_t)item.obj_size + bin.bin_size > _set_capacity) // 驱逐直到空间足够容纳当前对象
+        uint32_t count = _pages.count(bin_num);
+        assert(_pages.find(bin_num, item.id) == -1);
+
+        // 从集合头部驱逐的对象数，最后统一前移
+        uint32_t num_popped = 0;
+        auto pop_front = [&]()
+        {
+            if (num_popped)
+            {
+                _pages.move(bin_num, 0, num_popped, count - num_popped);
+                count -= num_popped;
+                _pages.resize(bin_num, count);
+            }
+        };
+
+        // 驱逐直到空间足够容纳当前对象；设置了maxItemsPerSet时还要有空闲槽位
+        while ((uint64_t)item.obj_size + bin.bin_size > _set_capacity ||
+               (_max_items_per_set && count - num_popped == _max_items_per_set))
         {
             // 当前对象没有被命中过，且当前集合全是命中过的对象，则不准入
             if (bin.no_hit_insert_loc == 0 && !item.hit_count)
@@ -55,10 +77,16 @@ namespace flashCache
                 _set_stats["numEvictionsImmediate"]++;
                 _set_stats["sizeEvictionsImmediate"] += item.obj_size;
                 evicted.push_back(item);
+                pop_front();
                 return evicted;
             }
+            if ((uint64_t)item.obj_size + bin.bin_size <= _set_capacity)
+            {
+                _set_stats["numSlotLimitEvictions"]++; // 因达到maxItemsPerSet而驱逐
+            }
             // 驱逐集合头部的对象
-            candidate_t old = bin.items.front();
+            candidate_t old = {.id = _pages.id(bin_num, num_popped), .obj_size = _pages.size(bin_num, num_popped), .hit_count = 0, .oracle_count = 0};
+            num_popped++;
             _set_stats["numEvictions"]++;
             _set_stats["sizeEvictions"] += old.obj_size;
             bin.bin_size -= old.obj_size;
@@ -81,21 +109,23 @@ namespace flashCache
                     evicted.push_back(old);
                 }
             }
-            bin.items.pop_front();
         }
+        pop_front();
 
+        _pages.resize(bin_num, count + 1);
+        uint32_t loc = count;
         if (item.hit_count) // 当前对象被访问过
         {
-            item.hit_count = 0;
-            bin.items.push_back(item); // 放到最后
+            item.hit_count = 0; // 放到最后
         }
         else // 当前对象没被访问过
         {
-            assert(bin.no_hit_insert_loc <= bin.items.size());
-            auto it = bin.items.begin() + bin.no_hit_insert_loc;
-            bin.items.insert(it, item); // 放到未命中对象的最后
-            bin.no_hit_insert_loc++;    // 更新未命中对象的插入位置
+            assert(bin.no_hit_insert_loc <= count);
+            loc = bin.no_hit_insert_loc; // 放到未命中对象的最后
+            _pages.move(bin_num, loc + 1, loc, count - loc);
+            bin.no_hit_insert_loc++; // 更新未命中对象的插入位置
         }
+        _pages.put(bin_num, loc, item.id, item.obj_size);
         bin.bin_size += item.obj_size;
         _total_size += item.obj_size;
         _set_stats["current_size"] = _total_size;
@@ -110,76 +140,71 @@ namespace flashCache
     {
         assert(bin_num < _num_sets);
         Bin &bin = _bins[bin_num];
-        std::vector<bool> &set_hits = _hits_in_sets[bin_num]; // 命中标记
-        std::list<candidate_t> hit_items;                     // 命中过的对象
-        std::list<candidate_t> no_hit_items;                  // 未命中过的对象
-        uint64_t i = 0;
+        uint32_t count = _pages.count(bin_num);
+        // 命中过的对象只可能在前HIT_BIT_VECTOR_SIZE个槽位中，暂存到栈上
+        uint64_t hit_ids[HIT_BIT_VECTOR_SIZE];
+        uint32_t hit_sizes[HIT_BIT_VECTOR_SIZE];
+        uint32_t num_hits = 0;
+        uint32_t num_no_hits = 0;
         uint64_t size_hits = 0;
-        for (auto const &it : bin.items) // 遍历集合对象
+        for (uint32_t i = 0; i < count; i++) // 遍历集合对象，稳定划分
         {
-            assert(!(it.obj_size == 0 && it.id == 0));
-            if (i >= HIT_BIT_VECTOR_SIZE || !set_hits[i]) // 若当前对象未命中过
+            uint64_t id = _pages.id(bin_num, i);
+            uint32_t size = _pages.size(bin_num, i);
+            assert(!(size == 0 && id == 0));
+            if (i >= HIT_BIT_VECTOR_SIZE || !(bin.hits & (1u << i))) // 若当前对象未命中过
             {
-                no_hit_items.push_back(it);
+                _pages.put(bin_num, num_no_hits, id, size);
+                num_no_hits++;
             }
             else // 当前对象命中过
             {
                 if (_dist_tracking)
                 {
-                    size_hits += it.obj_size;
+                    size_hits += size;
                 }
-                hit_items.push_back(it);
+                hit_ids[num_hits] = id;
+                hit_sizes[num_hits] = size;
+                num_hits++;
             }
-            i++;
         }
-        std::fill(set_hits.begin(), set_hits.end(), false); // 重置命中标记
-        bin.items.clear();
-        bin.items.insert(bin.items.end(), no_hit_items.begin(), no_hit_items.end()); // 未命中对象放到前面
-        bin.items.insert(bin.items.end(), hit_items.begin(), hit_items.end());       // 命中对象放到后面
+        bin.hits = 0; // 重置命中标记
+        // 命中对象放到后面
+        for (uint32_t i = 0; i < num_hits; i++)
+        {
+            _pages.put(bin_num, num_no_hits + i, hit_ids[i], hit_sizes[i]);
+        }
         if (_dist_tracking)
         {
-            std::string num_name = "numItemsWithHits" + std::to_string(hit_items.size());
+            std::string num_name = "numItemsWithHits" + std::to_string(num_hits);
             size_hits = (size_hits / cache::SIZE_BUCKETING) * cache::SIZE_BUCKETING; // 按SIZE_BUCKETING取整
             std::string size_name = "sizeItemsWithHits" + std::to_string(size_hits);
             _set_stats[num_name]++;
             _set_stats[size_name]++;
         }
-        return no_hit_items.size();
+        return num_no_hits;
     }
 
-    // 插入若干对象
+    // 插入一批对象：整批计算集合号并按集合排序，每个集合的对象连续插入，集合只需重写一次
     std::vector<candidate_t> Sets::insert(std::vector<candidate_t> items)
     {
-        std::vector<bool> sets_touched(_num_sets, false);
+        SetBatch batch = groupBySet(this, items);
         std::vector<candidate_t> evicted;
-        for (auto item : items) // 遍历每个要插入的对象
+        for (auto &run : batch.runs)
         {
-            uint64_t bin_num = *findSetNums(item).begin(); // 对象可能映射到的集合列表，取第一个
-            assert(bin_num < _num_sets);
-            Bin &bin = _bins[bin_num];
-            if (!sets_touched[bin_num] && _nru) // 若当前集合没被记录过，且采用的是NRU策略
-            {
-                // 集合内对象重排序一下，更新未命中对象的插入位置
-                bin.no_hit_insert_loc = _reorder_set_nru(bin_num);
-            }
-            else if (!sets_touched[bin_num]) // 未采用NRU策略，则默认为FIFO
-            {
-                // 未命中对象的插入位置为集合末尾
-                bin.no_hit_insert_loc = bin.items.size();
-            }
-            sets_touched[bin_num] = true;
-            std::vector<candidate_t> local_evict = _insert(item, bin_num);
+            std::vector<candidate_t> local_evict = insert(run.set_num, batch.begin(run), batch.end(run));
             evicted.insert(evicted.end(), local_evict.begin(), local_evict.end());
-            _updateStatsRequestedStore(item); // 记录请求数以及请求所需写入的字节数
         }
-        uint64_t num_sets_touched = std::count(sets_touched.begin(), sets_touched.end(), true);
-        _updateStatsActualStore(num_sets_touched); // 记录集合实际写入的字节数
-        assert(_total_capacity >= _total_size);
         return evicted;
     }
 
-    // 向指定集合插入若干对象
     std::vector<candidate_t> Sets::insert(uint64_t set_num, std::vector<candidate_t> items)
+    {
+        return insert(set_num, items.data(), items.data() + items.size());
+    }
+
+    // 向指定集合插入若干对象
+    std::vector<candidate_t> Sets::insert(uint64_t set_num, const candidate_t *first, const candidate_t *last)
     {
         std::vector<candidate_t> evicted;
         assert(set_num < _num_sets);
@@ -190,18 +215,20 @@ namespace flashCache
         }
         else
         {
-            bin.no_hit_insert_loc = bin.items.size();
+            bin.no_hit_insert_loc = _pages.count(set_num);
         }
-        for (auto item : items)
+        for (auto it = first; it != last; ++it)
         {
-            std::vector<candidate_t> local_evict = _insert(item, set_num);
+            std::vector<candidate_t> local_evict = _insert(*it, set_num);
             evicted.insert(evicted.end(), local_evict.begin(), local_evict.end());
-            _updateStatsRequestedStore(item);
         }
-        if (items.size() > 0)
+        if (first != last)
         {
+            _updateStatsRequestedStore(first, last);
             _updateStatsActualStore(1);
         }
+        _rebuildBloom(set_num);
+        _set_stats["pageMemoryBytes"] = _pages.memoryBytes();
         assert(_total_capacity >= _total_size);
         return evicted;
     }
@@ -211,36 +238,48 @@ namespace flashCache
         _set_stats["bytes_written"] += (num_sets_updated * _set_capacity);
     }
 
-    void Sets::_updateStatsRequestedStore(candidate_t item)
+    void Sets::_updateStatsRequestedStore(const candidate_t *first, const candidate_t *last)
     {
-        _set_stats["stores_requested"]++;
-        _set_stats["stores_requested_bytes"] += item.obj_size;
+        uint64_t bytes = 0;
+        for (auto it = first; it != last; ++it)
+        {
+            bytes += it->obj_size;
+        }
+        _set_stats["stores_requested"] += last - first;
+        _set_stats["stores_requested_bytes"] += bytes;
     }
 
     // 查找指定对象
     bool Sets::find(candidate_t item)
     {
-        std::unordered_set<uint64_t> possible_bins = findSetNums(item);
+        SetNums possible_bins = findSetNums(item);
+        _set_stats["lookups"]++;
         for (uint64_t bin_num : possible_bins)
         {
-            uint64_t i = 0;
-            for (candidate_t stored_item : _bins[bin_num].items)
+            // 布隆过滤器判断不在集合中时不需要读flash页
+            bool read_page = !_bloom.enabled() || _bloom.mayContain(bin_num, item.id);
+            int i = read_page ? _pages.find(bin_num, item.id) : -1;
+            if (read_page)
             {
-                if (stored_item == item)
+                _set_stats["flashPageReads"]++;
+                if (i < 0 && _bloom.enabled())
                 {
-                    if (_nru) // 若为NRU策略，则更新命中标记，用于NRU的重排序
-                    {
-                        _hits_in_sets[bin_num][i] = true;
-                    }
-                    if (_hit_dist) // 按集合粒度统计命中次数
-                    {
-                        std::string name = "set" + std::to_string(bin_num);
-                        _set_stats[name]++;
-                    }
-                    _set_stats["hits"]++;
-                    return true;
+                    _set_stats["bloomFalsePositiveReads"]++;
                 }
-                i++;
+            }
+            if (i >= 0)
+            {
+                if (_nru && i < HIT_BIT_VECTOR_SIZE) // 若为NRU策略，则更新命中标记，用于NRU的重排序
+                {
+                    _bins[bin_num].hits |= 1u << i;
+                }
+                if (_hit_dist) // 按集合粒度统计命中次数
+                {
+                    std::string name = "set" + std::to_string(bin_num);
+                    _set_stats[name]++;
+                }
+                _set_stats["hits"]++;
+                return true;
             }
             if (_hit_dist) // 按集合粒度统计未命中次数
             {
@@ -253,16 +292,9 @@ namespace flashCache
     }
 
     // 对象可能映射到的集合列表
-    std::unordered_set<uint64_t> Sets::findSetNums(candidate_t item)
+    SetNums Sets::findSetNums(candidate_t item)
     {
-        std::unordered_set<uint64_t> possibilities;
-        uint64_t current_value = (uint64_t)item.id;
-        for (int i = 0; i <= _num_hash_functions; i++)
-        {
-            possibilities.insert(current_value % _num_sets);
-            current_value = std::hash<std::string>{}(std::to_string(std::hash<uint64_t>{}(current_value)));
-        }
-        return possibilities;
+        return calcSetNums(item.id, _num_sets, _num_hash_functions);
     }
 
     double Sets::ratioCapacityUsed()
@@ -275,6 +307,27 @@ namespace flashCache
         return _set_stats["bytes_written"] / (double)_set_stats["stores_requested_bytes"];
     }
 
+    // 每次查找平均读取的flash页数
+    double Sets::calcReadAmp()
+    {
+        int64_t lookups = _set_stats["lookups"];
+        return lookups ? _set_stats["flashPageReads"] / (double)lookups : 0.;
+    }
+
+    // 集合重写后按当前内容重建布隆过滤器
+    void Sets::_rebuildBloom(uint64_t bin_num)
+    {
+        if (!_bloom.enabled())
+        {
+            return;
+        }
+        _bloom.clear(bin_num);
+        for (uint32_t i = 0; i < _pages.count(bin_num); i++)
+        {
+            _bloom.add(bin_num, _pages.id(bin_num, i));
+        }
+    }
+
     double Sets::ratioEvictedToCapacity()
     {
         return _set_stats["sizeEvictions"] / (double)_total_capacity;
@@ -284,6 +337,9 @@ namespace flashCache
     {
         _set_stats["misses"] = 0;
         _set_stats["hits"] = 0;
+        _set_stats["lookups"] = 0;
+        _set_stats["flashPageReads"] = 0;
+        _set_stats["bloomFalsePositiveReads"] = 0;
         _set_stats["bytes_written"] = 0;
         _set_stats["stores_requested"] = 0;
         _set_stats["stores_requested_bytes"] = 0;
@@ -296,13 +352,12 @@ namespace flashCache
 
     uint64_t Sets::calcMemoryConsumption()
     {
-        /* TODO: replace 0 w/ bloom filters */
-        uint64_t sets_memory_consumption = 0;
+        uint64_t sets_memory_consumption = _bloom.memoryBytes(); // 布隆过滤器
         if (_nru) // 若为NRU，则为每个对象维护1位命中标记
         {
             // 每个set一个HIT_BIT_VECTOR_SIZE位的命中标记数组
             uint64_t bytes_per_set = HIT_BIT_VECTOR_SIZE / 8;
-            sets_memory_consumption = bytes_per_set * _num_sets;
+            sets_memory_consumption += bytes_per_set * _num_sets;
         }
         return sets_memory_consumption;
     }
@@ -310,22 +365,18 @@ namespace flashCache
     // 判断对象是否在集合缓存中
     bool Sets::trackHit(candidate_t item)
     {
-        std::unordered_set<uint64_t> possible_bins = findSetNums(item);
+        SetNums possible_bins = findSetNums(item);
         for (uint64_t bin_num : possible_bins)
         {
-            uint64_t i = 0;
-            for (candidate_t stored_item : _bins[bin_num].items)
+            int i = _pages.find(bin_num, item.id);
+            if (i >= 0)
             {
-                if (stored_item == item)
+                if (_nru && i < HIT_BIT_VECTOR_SIZE)
                 {
-                    if (_nru)
-                    {
-                        _hits_in_sets[bin_num][i] = true;
-                    }
-                    _set_stats["hitsSharedWithLog"]++;
-                    return true;
+                    _bins[bin_num].hits |= 1u << i;
                 }
-                i++;
+                _set_stats["hitsSharedWithLog"]++;
+                return true;
             }
         }
         _set_stats["trackHitsFailed"]++;
@@ -1,9 +1,9 @@
 #pragma once
 
-#include <deque>
 #include <vector>
-#include <unordered_set>
 #include "candidate.hpp"
+#include "kangaroo/set_bloom.hpp"
+#include "kangaroo/set_pages.hpp"
 #include "log_abstract.hpp"
 #include "sets_abstract.hpp"
 #include "stats/stats.hpp"
@@ -22,7 +22,8 @@ namespace flashCache
     public:
         Sets(uint64_t num_sets, uint64_t set_capacity,
              stats::LocalStatsCollector &set_stats, cache::MemLogSetsCache *ref_cache = nullptr,
-             int num_hash_functions = 1, bool nru = false);
+             int num_hash_functions = 1, bool nru = false, uint32_t max_items_per_set = 0,
+             double bloom_bits_per_object = 0);
         ~Sets() {}
 
         /* ----------- Basic functionality --------------- */
@@ -36,6 +37,7 @@ namespace flashCache
          * will fail assert if any items cannot be matched to provided set_num
          */
         std::vector<candidate_t> insert(uint64_t set_num, std::vector<candidate_t> items);
+        std::vector<candidate_t> insert(uint64_t set_num, const candidate_t *first, const candidate_t *last);
 
         /* returns true if the item is in sets layer */
         bool find(candidate_t item);
@@ -43,7 +45,7 @@ namespace flashCache
         /* ----------- Useful for Admission Policies --------------- */
 
         /* returns the set numbers that item could be mapped to */
-        std::unordered_set<uint64_t> findSetNums(candidate_t item);
+        SetNums findSetNums(candidate_t item);
 
         /* returns ratio of total capacity used */
         double ratioCapacityUsed();
@@ -51,6 +53,7 @@ namespace flashCache
         /* ----------- Other Bookeeping --------------- */
 
         double calcWriteAmp();
+        double calcReadAmp();
         double ratioEvictedToCapacity();
         void flushStats(); // does not print update before clearing
         uint64_t calcMemoryConsumption();
@@ -59,15 +62,20 @@ namespace flashCache
         void enableHitDistributionOverSets();
 
     private:
+        /* each set mirrors an on-flash page: the ids and sizes of its items
+         * are packed in _pages, slots in flash order, oldest first */
         struct Bin
         {
-            std::deque<candidate_t> items;
             int64_t bin_size;
-            uint64_t no_hit_insert_loc; // where to put non-hit log items
+            uint32_t no_hit_insert_loc; // where to put non-hit log items
+            uint32_t hits;              // bit i set if slot i was hit, for nru
         };
         stats::LocalStatsCollector &_set_stats;
         std::vector<Bin> _bins;
-        std::vector<std::vector<bool>> _hits_in_sets;
+        SetPages _pages;
+        /* optional cap on the objects per set (sets.maxItemsPerSet), 0 for
+         * none; a set at the cap evicts like a full one */
+        uint32_t _max_items_per_set;
         uint64_t _set_capacity;
         uint64_t _num_sets;
         uint64_t _total_size;
@@ -77,6 +85,9 @@ namespace flashCache
         bool _nru;
         bool _dist_tracking = false;
         bool _hit_dist = false;
+        SetBloomFilters _bloom; // 每个集合的布隆过滤器，在集合重写时重建
+
+        void _rebuildBloom(uint64_t bin_num);
 
         /*
          * internal insert, ensures that a bucket is not overfull
@@ -89,7 +100,7 @@ namespace flashCache
 
         /* update stats related to flash writes */
         void _updateStatsActualStore(uint64_t num_sets_updated);
-        void _updateStatsRequestedStore(candidate_t item);
+        void _updateStatsRequestedStore(const candidate_t *first, const candidate_t *last);
     };
 
 } // namespace flashCache
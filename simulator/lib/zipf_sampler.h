@@ -0,0 +1,117 @@
+#pragma once
+#include <math.h>
+#include <stdint.h>
+#include <cassert>
+
+/*
+ Rejection-inversion sampler for a Zipf distribution over ranks 1..n with
+ P(k) ~ 1 / k^alpha (W. Hörmann, G. Derflinger, "Rejection-inversion to
+ generate variates from monotone discrete distributions", 1996).
+
+ 与ZipfRequests不同，这里不需要物化任何对象表：构造时只预计算几个常量，
+ 每次采样的期望拒绝次数小于1.2，因此内存为O(1)，每次采样为O(1)。
+ 适用于任意alpha >= 0（alpha = 0时退化为均匀分布）。
+*/
+class RejectionInversionZipf
+{
+public:
+    RejectionInversionZipf(uint64_t n, double alpha) : n(n), alpha(alpha)
+    {
+        assert(n > 0 && alpha >= 0);
+        hIntegralX1 = hIntegral(1.5) - 1.0;
+        hIntegralN = hIntegral(n + 0.5);
+        s = 2.0 - hIntegralInverse(hIntegral(2.5) - h(2.0));
+    }
+
+    // 返回[1, n]中的排名，rng需提供返回[0, 1)均匀分布的nextDouble()
+    template <typename Rng>
+    inline uint64_t sample(Rng &rng) const
+    {
+        while (true)
+        {
+            double u = hIntegralN + rng.nextDouble() * (hIntegralX1 - hIntegralN);
+            double x = hIntegralInverse(u);
+            double kd = floor(x + 0.5);
+            if (kd < 1)
+            {
+                kd = 1;
+            }
+            else if (kd > n)
+            {
+                kd = n;
+            }
+            // 大部分样本落在被接受区域内，直接返回
+            if (kd - x <= s || u >= hIntegral(kd + 0.5) - h(kd))
+            {
+                return (uint64_t)kd;
+            }
+        }
+    }
+
+    uint64_t numObjects() const { return n; }
+
+private:
+    // h(x) = x^-alpha
+    inline double h(double x) const
+    {
+        return exp(-alpha * log(x));
+    }
+
+    // h的不定积分 (x^(1-alpha) - 1) / (1-alpha)，alpha = 1时为log(x)
+    inline double hIntegral(double x) const
+    {
+        double logX = log(x);
+        return helper2((1.0 - alpha) * logX) * logX;
+    }
+
+    inline double hIntegralInverse(double x) const
+    {
+        double t = x * (1.0 - alpha);
+        if (t < -1.0)
+        {
+            t = -1.0; // 防止数值误差导致log1p的参数越界
+        }
+        return exp(helper1(t) * x);
+    }
+
+    // log(1+x)/x，x接近0时用泰勒展开
+    static inline double helper1(double x)
+    {
+        if (fabs(x) > 1e-8)
+        {
+            return log1p(x) / x;
+        }
+        return 1.0 - x * (0.5 - x * (1.0 / 3.0 - 0.25 * x));
+    }
+
+    // (exp(x)-1)/x，x接近0时用泰勒展开
+    static inline double helper2(double x)
+    {
+        if (fabs(x) > 1e-8)
+        {
+            return expm1(x) / x;
+        }
+        return 1.0 + x * 0.5 * (1.0 + x * (1.0 / 3.0) * (1.0 + 0.25 * x));
+    }
+
+    uint64_t n;
+    double alpha;
+    double hIntegralX1;
+    double hIntegralN;
+    double s;
+};
+
+/* maps a popularity rank to an object id with a bijective 64-bit mixer, so the
+ * hottest objects are spread over the id space instead of being 1, 2, 3...;
+ * different seeds give different, still collision-free, layouts */
+inline uint64_t scrambleZipfId(uint64_t rank, uint64_t seed)
+{
+    // 排名小于2^63，置位种子最高位保证x非0，从而id不会为0
+    uint64_t x = rank ^ (seed | (1ULL << 63));
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
@@ -45,11 +45,19 @@ zstd_reader *create_zstd_reader(const char *trace_path)
 
     reader->zds = ZSTD_createDStream(); // 创建一个Zstd解压缩流，用于解压缩数据
 
+    reader->seek_table = zstd_read_seek_table(reader->ifile);
+    if (reader->seek_table != NULL)
+    {
+        INFO("seekable zstd trace, %u frames\n", reader->seek_table->num_frames);
+    }
+
     return reader;
 }
 
 void free_zstd_reader(zstd_reader *reader)
 {
+    free_zstd_seek_table(reader->seek_table);
+    fclose(reader->ifile);
     ZSTD_freeDStream(reader->zds);
     free(reader->buff_in);
     free(reader->buff_out);
@@ -265,4 +273,261 @@ size_t zstd_reader_read_bytes(zstd_reader *reader, size_t n_byte,
 
         return sz;
     }
-}
\ No newline at end of file
+}
+/* ------------------------- seekable format ------------------------- */
+
+#define SEEKABLE_MAGIC 0x8F92EAB1U
+#define SKIPPABLE_MAGIC 0x184D2A5EU
+#define SEEK_TABLE_FOOTER_SIZE 9
+#define SKIPPABLE_HEADER_SIZE 8
+
+static uint32_t _read_le32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void _write_le32(uint8_t *p, uint32_t v)
+{
+    p[0] = v;
+    p[1] = v >> 8;
+    p[2] = v >> 16;
+    p[3] = v >> 24;
+}
+
+zstd_seek_table *zstd_read_seek_table(FILE *ifile)
+{
+    long old_pos = ftell(ifile);
+    zstd_seek_table *table = NULL;
+    uint8_t *entries = NULL;
+    uint8_t footer[SEEK_TABLE_FOOTER_SIZE];
+
+    // 跳转表的footer：帧数(4B) + 描述符(1B) + magic(4B)
+    if (fseek(ifile, -SEEK_TABLE_FOOTER_SIZE, SEEK_END) != 0 ||
+        fread(footer, 1, SEEK_TABLE_FOOTER_SIZE, ifile) != SEEK_TABLE_FOOTER_SIZE ||
+        _read_le32(footer + 5) != SEEKABLE_MAGIC)
+    {
+        goto out;
+    }
+
+    uint32_t num_frames = _read_le32(footer);
+    uint8_t descriptor = footer[4];
+    size_t entry_size = (descriptor & 0x80) ? 12 : 8; // 最高位表示每项带校验和
+    size_t table_size = (size_t)num_frames * entry_size;
+    if (descriptor & 0x7C)
+    {
+        WARN("seek table descriptor has reserved bits set\n");
+        goto out;
+    }
+
+    uint8_t header[SKIPPABLE_HEADER_SIZE];
+    if (fseek(ifile, -(long)(SEEK_TABLE_FOOTER_SIZE + table_size + SKIPPABLE_HEADER_SIZE), SEEK_END) != 0 ||
+        fread(header, 1, SKIPPABLE_HEADER_SIZE, ifile) != SKIPPABLE_HEADER_SIZE ||
+        _read_le32(header) != SKIPPABLE_MAGIC ||
+        _read_le32(header + 4) != table_size + SEEK_TABLE_FOOTER_SIZE)
+    {
+        WARN("corrupt zstd seek table\n");
+        goto out;
+    }
+
+    entries = malloc(table_size + 1);
+    if (fread(entries, 1, table_size, ifile) != table_size)
+    {
+        goto out;
+    }
+
+    table = malloc(sizeof(zstd_seek_table));
+    table->num_frames = num_frames;
+    table->c_offsets = malloc(sizeof(uint64_t) * (num_frames + 1));
+    table->d_offsets = malloc(sizeof(uint64_t) * (num_frames + 1));
+    table->c_offsets[0] = 0;
+    table->d_offsets[0] = 0;
+    for (uint32_t i = 0; i < num_frames; i++)
+    {
+        table->c_offsets[i + 1] = table->c_offsets[i] + _read_le32(entries + i * entry_size);
+        table->d_offsets[i + 1] = table->d_offsets[i] + _read_le32(entries + i * entry_size + 4);
+    }
+
+out:
+    free(entries);
+    fseek(ifile, old_pos, SEEK_SET);
+    return table;
+}
+
+void free_zstd_seek_table(zstd_seek_table *table)
+{
+    if (table == NULL)
+    {
+        return;
+    }
+    free(table->c_offsets);
+    free(table->d_offsets);
+    free(table);
+}
+
+uint32_t zstd_seek_table_find_frame(const zstd_seek_table *table, uint64_t d_offset)
+{
+    // 二分查找最后一个起始偏移 <= d_offset 的帧
+    uint32_t lo = 0, hi = table->num_frames;
+    while (lo < hi)
+    {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (table->d_offsets[mid + 1] <= d_offset)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+int zstd_reader_seek(zstd_reader *reader, uint64_t d_offset)
+{
+    zstd_seek_table *table = reader->seek_table;
+    if (table == NULL || d_offset > table->d_offsets[table->num_frames])
+    {
+        return -1;
+    }
+
+    // 从目标帧的起点重新开始流式解压
+    uint32_t frame = zstd_seek_table_find_frame(table, d_offset);
+    if (fseek(reader->ifile, (long)table->c_offsets[frame], SEEK_SET) != 0)
+    {
+        return -1;
+    }
+    clearerr(reader->ifile);
+    ZSTD_initDStream(reader->zds);
+    reader->input.size = 0;
+    reader->input.pos = 0;
+    reader->output.pos = 0;
+    reader->buff_out_read_pos = 0;
+    reader->status = OK;
+
+    // 丢弃帧内目标位置之前的数据
+    uint64_t skip = d_offset - table->d_offsets[frame];
+    size_t step = ZSTD_DStreamOutSize();
+    char *tmp;
+    while (skip > 0)
+    {
+        size_t n = skip < step ? skip : step;
+        if (zstd_reader_read_bytes(reader, n, &tmp) != n)
+        {
+            return -1;
+        }
+        skip -= n;
+    }
+    return 0;
+}
+
+int zstd_write_seekable(const char *in_path, const char *out_path, size_t frame_bytes, int level)
+{
+    zstd_reader *in_zstd = NULL;
+    FILE *in = NULL;
+    size_t in_len = strlen(in_path);
+    // 输入可以是普通文件，也可以是普通 zstd 文件
+    if (in_len > 4 && strcmp(in_path + in_len - 4, ".zst") == 0)
+    {
+        in_zstd = create_zstd_reader(in_path);
+    }
+    else if ((in = fopen(in_path, "rb")) == NULL)
+    {
+        ERROR("cannot open %s\n", in_path);
+    }
+    FILE *out = fopen(out_path, "wb");
+    if (out == NULL)
+    {
+        ERROR("cannot open %s for writing\n", out_path);
+    }
+
+    char *raw = malloc(frame_bytes);
+    size_t bound = ZSTD_compressBound(frame_bytes);
+    char *compressed = malloc(bound);
+    size_t capacity = 1024, num_frames = 0;
+    uint8_t *entries = malloc(capacity * 8);
+    size_t step = ZSTD_DStreamOutSize();
+
+    while (true)
+    {
+        size_t n = 0;
+        if (in != NULL)
+        {
+            n = fread(raw, 1, frame_bytes, in);
+        }
+        else
+        {
+            char *data;
+            while (n < frame_bytes)
+            {
+                size_t want = frame_bytes - n < step ? frame_bytes - n : step;
+                size_t got = zstd_reader_read_bytes(in_zstd, want, &data);
+                if (got == 0)
+                {
+                    // 文件末尾不足 want 字节的尾部数据
+                    size_t left = in_zstd->output.pos - in_zstd->buff_out_read_pos;
+                    if (left > 0 && left < want)
+                    {
+                        got = zstd_reader_read_bytes(in_zstd, left, &data);
+                    }
+                    if (got == 0)
+                    {
+                        break;
+                    }
+                }
+                memcpy(raw + n, data, got);
+                n += got;
+            }
+        }
+        if (n == 0)
+        {
+            break;
+        }
+
+        size_t c = ZSTD_compress(compressed, bound, raw, n, level);
+        if (ZSTD_isError(c))
+        {
+            ERROR("zstd compression failed: %s\n", ZSTD_getErrorName(c));
+        }
+        fwrite(compressed, 1, c, out);
+        if (num_frames == capacity)
+        {
+            capacity *= 2;
+            entries = realloc(entries, capacity * 8);
+        }
+        _write_le32(entries + num_frames * 8, (uint32_t)c);
+        _write_le32(entries + num_frames * 8 + 4, (uint32_t)n);
+        num_frames++;
+        if (n < frame_bytes)
+        {
+            break;
+        }
+    }
+
+    // 跳转表：skippable 帧头 + 每帧的(压缩大小, 原始大小) + footer，不带校验和
+    uint8_t header[SKIPPABLE_HEADER_SIZE], footer[SEEK_TABLE_FOOTER_SIZE];
+    _write_le32(header, SKIPPABLE_MAGIC);
+    _write_le32(header + 4, (uint32_t)(num_frames * 8 + SEEK_TABLE_FOOTER_SIZE));
+    _write_le32(footer, (uint32_t)num_frames);
+    footer[4] = 0;
+    _write_le32(footer + 5, SEEKABLE_MAGIC);
+    fwrite(header, 1, SKIPPABLE_HEADER_SIZE, out);
+    fwrite(entries, 1, num_frames * 8, out);
+    fwrite(footer, 1, SEEK_TABLE_FOOTER_SIZE, out);
+    int ret = ferror(out) ? -1 : 0;
+
+    INFO("wrote %zu seekable frames to %s\n", num_frames, out_path);
+    fclose(out);
+    if (in != NULL)
+    {
+        fclose(in);
+    }
+    else
+    {
+        free_zstd_reader(in_zstd);
+    }
+    free(raw);
+    free(compressed);
+    free(entries);
+    return ret;
+}
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <stdint.h>
 #include <stdio.h>
 #include <zstd.h>
 
@@ -19,6 +20,18 @@ extern "C"
      * Zstandard（也称为zstd）是一种实时压缩算法，提供了高压缩比和快速压缩速度。
      * 它由 Facebook 开发并开源，现在已经被广泛应用于各种场景，包括日志压缩、数据存储和网络传输等。
      */
+    /**
+     * zstd seekable format 的跳转表（contrib/seekable_format）：文件由若干独立的
+     * zstd 帧组成，末尾的 skippable 帧记录每一帧压缩前后的大小。
+     * 两个数组都有 num_frames + 1 项，为各帧起始偏移的前缀和。
+     */
+    typedef struct zstd_seek_table
+    {
+        uint32_t num_frames;
+        uint64_t *c_offsets; // 各帧在压缩文件中的起始偏移
+        uint64_t *d_offsets; // 各帧在解压后数据中的起始偏移
+    } zstd_seek_table;
+
     typedef struct zstd_reader
     {
         FILE *ifile;       // 文件指针
@@ -37,6 +50,8 @@ extern "C"
         ZSTD_outBuffer output;
 
         rstatus status; // 当前读取器的状态(错误、正常、结束)
+
+        zstd_seek_table *seek_table; // 文件不是 seekable 格式时为 NULL
     } zstd_reader;
 
     // 创建一个 zstd_reader 对象
@@ -55,6 +70,23 @@ extern "C"
     size_t zstd_reader_read_bytes(zstd_reader *reader, size_t n_byte,
                                   char **data_start);
 
+    // 读取文件末尾的跳转表，不是 seekable 格式时返回 NULL，调用后文件位置不变
+    zstd_seek_table *zstd_read_seek_table(FILE *ifile);
+
+    void free_zstd_seek_table(zstd_seek_table *table);
+
+    // 返回包含解压后偏移 d_offset 的帧号，超出末尾时返回 num_frames
+    uint32_t zstd_seek_table_find_frame(const zstd_seek_table *table, uint64_t d_offset);
+
+    /* seek so that the next read returns the byte at decompressed offset
+     * d_offset; only the frame containing it is decompressed. Returns 0 on
+     * success, -1 if the file has no seek table or the offset is past EOF */
+    int zstd_reader_seek(zstd_reader *reader, uint64_t d_offset);
+
+    /* recompress a file into the seekable format with independent frames of
+     * frame_bytes decompressed bytes each, returns 0 on success */
+    int zstd_write_seekable(const char *in_path, const char *out_path, size_t frame_bytes, int level);
+
 #ifdef __cplusplus
 }
 #endif
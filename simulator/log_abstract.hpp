@@ -36,6 +36,10 @@ namespace flashCache
 
         virtual double calcWriteAmp() = 0;
         virtual void flushStats() = 0;
+
+        /* DRAM needed to index the log in bytes, 0 if the log does not model
+         * its index, the cache then charges a flat overhead ratio instead */
+        virtual uint64_t calcMemoryConsumption() { return 0; }
     };
 
 } // namespace flashCache
@@ -13,8 +13,10 @@
 
 #include "../lib/zstdReader.h"
 #include "../lib/binaryUtils.h"
+#include "parallel_zstd_reader.hpp"
 #include "parser.hpp"
 #include "../common/logging.h"
+#include "../common/profile.hpp"
 
 typedef double double64_t;
 
@@ -25,11 +27,15 @@ namespace parser
     {
 
     public:
-        BinaryParser(std::string trace_path, uint64_t _numRequests, std::string fmt_str, int32_t fields_num, int trace_start_offset = 0)
+        BinaryParser(std::string trace_path, uint64_t _numRequests, std::string fmt_str, int32_t fields_num, int trace_start_offset = 0,
+                     uint64_t fast_forward = 0, uint64_t fast_forward_time = 0, int decode_threads = 0)
             : numRequests(_numRequests), fmt_str(fmt_str), fields_num(fields_num), trace_start_offset(trace_start_offset)
         {
             trace_path_ = trace_path;
             INFO("Parsing binary trace file: %s\n", trace_path.c_str());
+            mmap_offset = trace_start_offset;
+            is_zstd_file = false;
+            zstd_reader_p = NULL;
             size_t slen = trace_path.length();
             if (trace_path.substr(slen - 4) == ".zst")
             {
@@ -91,6 +97,13 @@ namespace parser
                     (unsigned long)file_size % item_size);
             }
             totalRequests = (uint64_t)data_region_size / (item_size); // 对于bin文件可以计算请求总数，对于zstd压缩的文件无效
+
+            _fastForward(fast_forward, fast_forward_time, decode_threads);
+        }
+
+        ~BinaryParser()
+        {
+            delete parallel_reader;
         }
 
         void go(VisitorFn visit) // VisitorFn visit为缓存的访问函数
@@ -101,9 +114,10 @@ namespace parser
             parser::req_op_e op;
             uint64_t next_access_vtime;
             parser::req_op_e next_access_op;
+            uint64_t future_invalid_time = 0;
 
             Request req;
-            req.req_num = 0;
+            req.req_num = start_req_num;
             while (true)
             {
                 if (fmt_str == "IQQB")
@@ -134,6 +148,22 @@ namespace parser
                     next_access_vtime = *(uint64_t *)(record + 21);
                     next_access_op = static_cast<parser::req_op_e>(*(uint8_t *)(record + 29));
                 }
+                else if (fmt_str == "IQQBQBQ")
+                {
+                    char *record = read_bytes();
+                    if (record == NULL)
+                    {
+                        INFO("Read EOF, Processed %ld Requests\n", req.req_num);
+                        break;
+                    }
+                    clock_time = *(uint32_t *)record;
+                    obj_id = *(uint64_t *)(record + 4);
+                    obj_size = *(uint64_t *)(record + 12);
+                    op = static_cast<parser::req_op_e>(*(uint8_t *)(record + 20));
+                    next_access_vtime = *(uint64_t *)(record + 21);
+                    next_access_op = static_cast<parser::req_op_e>(*(uint8_t *)(record + 29));
+                    future_invalid_time = *(uint64_t *)(record + 30);
+                }
                 else
                 {
                     ERROR("unknown format string %s\n", fmt_str.c_str());
@@ -145,6 +175,7 @@ namespace parser
                 req.type = op;
                 req.next_access_vtime = next_access_vtime;
                 req.next_access_op = next_access_op;
+                req.future_invalid_time = future_invalid_time;
                 req.req_num++;
                 if (req.req_num <= 10)
                     INFO("id:%" PRIu64 ",req_size:%ld,time:%ld,type:%d,next_access_vtime:%ld,next_access_op:%d\n",
@@ -174,6 +205,7 @@ namespace parser
             parser::req_op_e op;
             uint64_t next_access_vtime;
             parser::req_op_e next_access_op;
+            uint64_t future_invalid_time = 0;
 
             if (fmt_str == "IQQB")
             {
@@ -203,6 +235,22 @@ namespace parser
                 next_access_vtime = *(uint64_t *)(record + 21);
                 next_access_op = static_cast<parser::req_op_e>(*(uint8_t *)(record + 29));
             }
+            else if (fmt_str == "IQQBQBQ")
+            {
+                char *record = read_bytes();
+                if (record == NULL)
+                {
+                    INFO("Read EOF, Processed %ld Requests\n", req->req_num);
+                    return 0;
+                }
+                clock_time = *(uint32_t *)record;
+                obj_id = *(uint64_t *)(record + 4);
+                obj_size = *(uint64_t *)(record + 12);
+                op = static_cast<parser::req_op_e>(*(uint8_t *)(record + 20));
+                next_access_vtime = *(uint64_t *)(record + 21);
+                next_access_op = static_cast<parser::req_op_e>(*(uint8_t *)(record + 29));
+                future_invalid_time = *(uint64_t *)(record + 30);
+            }
             else
             {
                 ERROR("unknown format string %s\n", fmt_str.c_str());
@@ -214,6 +262,7 @@ namespace parser
             req->type = op;
             req->next_access_vtime = next_access_vtime;
             req->next_access_op = next_access_op;
+            req->future_invalid_time = future_invalid_time;
             req->req_num++;
             if (req->req_num <= 10)
                 INFO("id:%" PRIu64 ",req_size:%ld,time:%ld,type:%d,next_access_vtime:%ld,next_access_op:%d\n",
@@ -239,9 +288,14 @@ namespace parser
         // 用于直接读取未解压的数据文件
         inline char *read_bytes()
         {
-
+            PROFILE_SCOPE(misc::PHASE_PARSE);
             char *start = NULL;
 
+            if (parallel_reader != NULL)
+            {
+                return parallel_reader->read(item_size);
+            }
+
             if (!is_zstd_file)
             {
                 // 偏移量超过了文件末尾
@@ -273,6 +327,85 @@ namespace parser
         }
 
     private:
+        /* skips the first skip_reqs records, or every record before
+         * start_time when that is set (timestamps must be non-decreasing).
+         * Uncompressed and seekable zstd traces jump there directly, plain
+         * zstd traces are decompressed through. With decode_threads > 0 the
+         * frames of a seekable trace are decompressed in parallel. */
+        void _fastForward(uint64_t skip_reqs, uint64_t start_time, int decode_threads)
+        {
+            zstd_seek_table *table = is_zstd_file ? zstd_reader_p->seek_table : NULL;
+            uint64_t skipped = 0;
+            if (is_zstd_file && table == NULL)
+            {
+                if (skip_reqs > 0 || start_time > 0)
+                {
+                    WARN("%s has no zstd seek table, decompressing through the skipped requests\n", trace_path_.c_str());
+                }
+                char *record;
+                while ((start_time > 0 || skipped < skip_reqs) && (record = read_bytes()) != NULL)
+                {
+                    if (start_time > 0 && *(uint32_t *)record >= start_time)
+                    {
+                        zstd_reader_p->buff_out_read_pos -= item_size; // 退回该记录
+                        break;
+                    }
+                    skipped++;
+                }
+            }
+            else
+            {
+                uint64_t num_records = is_zstd_file ? table->d_offsets[table->num_frames] / item_size : totalRequests;
+                if (start_time > 0)
+                {
+                    skip_reqs = lowerBoundByTime(num_records, start_time, [this](uint64_t i)
+                                                 { return _recordTime(i); });
+                }
+                skipped = std::min(skip_reqs, num_records);
+                if (!is_zstd_file)
+                {
+                    mmap_offset = trace_start_offset + skipped * item_size;
+                }
+                else if (decode_threads <= 0 && zstd_reader_seek(zstd_reader_p, skipped * item_size) != 0)
+                {
+                    ERROR("fail to seek zstd trace\n");
+                }
+            }
+
+            if (decode_threads > 0)
+            {
+                if (table != NULL)
+                {
+                    parallel_reader = new ParallelZstdReader(trace_path_, table, decode_threads, skipped * item_size);
+                }
+                else
+                {
+                    WARN("trace.decodeThreads needs a seekable zstd trace, decoding serially\n");
+                }
+            }
+            start_req_num = skipped;
+            if (skipped > 0)
+            {
+                INFO("Fast forwarded %lu requests\n", (unsigned long)skipped);
+            }
+        }
+
+        // 第i个记录的时间戳，仅用于可随机访问的负载
+        uint32_t _recordTime(uint64_t i)
+        {
+            if (!is_zstd_file)
+            {
+                return *(uint32_t *)(mapped_file + trace_start_offset + i * item_size);
+            }
+            char *record;
+            if (zstd_reader_seek(zstd_reader_p, i * item_size) != 0 ||
+                zstd_reader_read_bytes(zstd_reader_p, item_size, &record) != item_size)
+            {
+                ERROR("fail to seek zstd trace\n");
+            }
+            return *(uint32_t *)record;
+        }
+
         uint64_t numRequests;
         int64_t totalRequests;
 
@@ -287,6 +420,9 @@ namespace parser
 
         struct zstd_reader *zstd_reader_p; // 用于读取zstd文件
         bool is_zstd_file;                 // 是否是 zstd 格式
+
+        ParallelZstdReader *parallel_reader = NULL; // trace.decodeThreads > 0 时并行解压各帧
+        uint64_t start_req_num = 0;                 // 快进跳过的请求数
     };
 
 } // namespace parser
@@ -13,8 +13,10 @@
 
 #include "../lib/zstdReader.h"
 #include "../lib/binaryUtils.h"
+#include "parallel_zstd_reader.hpp"
 #include "parser.hpp"
 #include "../common/logging.h"
+#include "../common/profile.hpp"
 
 typedef double double64_t;
 
@@ -25,11 +27,16 @@ namespace parser
     {
 
     public:
-        BlockBinaryParser(std::string trace_path, int32_t _page_size, uint64_t _numRequests, std::string fmt_str, int32_t fields_num, int trace_start_offset = 0)
-            : page_size(_page_size), numRequests(_numRequests), fmt_str(fmt_str), fields_num(fields_num), trace_start_offset(trace_start_offset)
+        BlockBinaryParser(std::string trace_path, int32_t _page_size, uint64_t _numRequests, std::string fmt_str, int32_t fields_num, int trace_start_offset = 0,
+                          uint64_t fast_forward = 0, uint64_t fast_forward_time = 0, int decode_threads = 0, bool extent_mode = false)
+            : page_size(_page_size), numRequests(_numRequests), fmt_str(fmt_str), fields_num(fields_num), trace_start_offset(trace_start_offset),
+              extent_mode(extent_mode)
         {
             trace_path_ = trace_path;
             INFO("Parsing binary trace file: %s\n", trace_path.c_str());
+            mmap_offset = trace_start_offset;
+            is_zstd_file = false;
+            zstd_reader_p = NULL;
             size_t slen = trace_path.length();
             if (trace_path.substr(slen - 4) == ".zst")
             {
@@ -92,9 +99,16 @@ namespace parser
             }
             totalRequests = (uint64_t)data_region_size / (item_size); // 对于bin文件可以计算请求总数，对于zstd压缩的文件无效
 
+            _fastForward(fast_forward, fast_forward_time, decode_threads);
+
             rest_lba.first = -1;
         }
 
+        ~BlockBinaryParser()
+        {
+            delete parallel_reader;
+        }
+
         void go(VisitorFn visit) // VisitorFn visit为缓存的访问函数
         {
             uint32_t clock_time;
@@ -106,7 +120,7 @@ namespace parser
             uint64_t future_invalid_time;
 
             Request req;
-            req.req_num = 0;
+            req.req_num = start_req_num;
             while (true)
             {
                 if (fmt_str == "IQQB")
@@ -176,17 +190,27 @@ namespace parser
                 int block_num = (io_size + page_size - 1) / page_size;
                 // req.req_num++;
 
-                for (int i = 0; i < block_num; i++)
+                if (extent_mode)
                 {
+                    // 整个I/O作为一个区间请求交给缓存，req_num按I/O计数
                     req.req_num++;
-                    req.id = lba + i;
-                    req.req_size = page_size;
-                    // req.req_size = io_size >= page_size ? page_size : io_size;
-                    // io_size -= req.req_size;
-                    visit(&req);
+                    req.req_size = (int64_t)block_num * page_size;
+                    if (block_num > 0)
+                        visit(&req);
+                }
+                else
+                {
+                    for (int i = 0; i < block_num; i++)
+                    {
+                        req.req_num++;
+                        req.id = lba + i;
+                        req.req_size = page_size;
+                        // req.req_size = io_size >= page_size ? page_size : io_size;
+                        // io_size -= req.req_size;
+                        visit(&req);
+                    }
                 }
 
-                visit(&req);
                 if (numRequests < 0) // numRequests < 0表示不限制请求数量
                     continue;
                 if (numRequests != 0)
@@ -286,10 +310,17 @@ namespace parser
             // req->req_num++;
 
             req->req_num++;
-            req->id = lba;
-            req->req_size = page_size;
-            rest_lba.first = lba + 1;
-            rest_lba.second = block_num - 1;
+            if (extent_mode)
+            {
+                req->req_size = (int64_t)block_num * page_size;
+            }
+            else
+            {
+                req->id = lba;
+                req->req_size = page_size;
+                rest_lba.first = lba + 1;
+                rest_lba.second = block_num - 1;
+            }
             // req->req_size = io_size >= page_size ? page_size : io_size;
             // io_size -= req->req_size;
 
@@ -302,14 +333,20 @@ namespace parser
                 INFO("Finished Processing %ld Requests\n", req->req_num);
                 return 0;
             }
+            return 1;
         }
 
         // 用于直接读取未解压的数据文件
         inline char *read_bytes()
         {
-
+            PROFILE_SCOPE(misc::PHASE_PARSE);
             char *start = NULL;
 
+            if (parallel_reader != NULL)
+            {
+                return parallel_reader->read(item_size);
+            }
+
             if (!is_zstd_file)
             {
                 // 偏移量超过了文件末尾
@@ -341,6 +378,85 @@ namespace parser
         }
 
     private:
+        /* skips the first skip_reqs records, or every record before
+         * start_time when that is set (timestamps must be non-decreasing).
+         * Uncompressed and seekable zstd traces jump there directly, plain
+         * zstd traces are decompressed through. With decode_threads > 0 the
+         * frames of a seekable trace are decompressed in parallel. */
+        void _fastForward(uint64_t skip_reqs, uint64_t start_time, int decode_threads)
+        {
+            zstd_seek_table *table = is_zstd_file ? zstd_reader_p->seek_table : NULL;
+            uint64_t skipped = 0;
+            if (is_zstd_file && table == NULL)
+            {
+                if (skip_reqs > 0 || start_time > 0)
+                {
+                    WARN("%s has no zstd seek table, decompressing through the skipped requests\n", trace_path_.c_str());
+                }
+                char *record;
+                while ((start_time > 0 || skipped < skip_reqs) && (record = read_bytes()) != NULL)
+                {
+                    if (start_time > 0 && *(uint32_t *)record >= start_time)
+                    {
+                        zstd_reader_p->buff_out_read_pos -= item_size; // 退回该记录
+                        break;
+                    }
+                    skipped++;
+                }
+            }
+            else
+            {
+                uint64_t num_records = is_zstd_file ? table->d_offsets[table->num_frames] / item_size : totalRequests;
+                if (start_time > 0)
+                {
+                    skip_reqs = lowerBoundByTime(num_records, start_time, [this](uint64_t i)
+                                                 { return _recordTime(i); });
+                }
+                skipped = std::min(skip_reqs, num_records);
+                if (!is_zstd_file)
+                {
+                    mmap_offset = trace_start_offset + skipped * item_size;
+                }
+                else if (decode_threads <= 0 && zstd_reader_seek(zstd_reader_p, skipped * item_size) != 0)
+                {
+                    ERROR("fail to seek zstd trace\n");
+                }
+            }
+
+            if (decode_threads > 0)
+            {
+                if (table != NULL)
+                {
+                    parallel_reader = new ParallelZstdReader(trace_path_, table, decode_threads, skipped * item_size);
+                }
+                else
+                {
+                    WARN("trace.decodeThreads needs a seekable zstd trace, decoding serially\n");
+                }
+            }
+            start_req_num = skipped;
+            if (skipped > 0)
+            {
+                INFO("Fast forwarded %lu requests\n", (unsigned long)skipped);
+            }
+        }
+
+        // 第i个记录的时间戳，仅用于可随机访问的负载
+        uint32_t _recordTime(uint64_t i)
+        {
+            if (!is_zstd_file)
+            {
+                return *(uint32_t *)(mapped_file + trace_start_offset + i * item_size);
+            }
+            char *record;
+            if (zstd_reader_seek(zstd_reader_p, i * item_size) != 0 ||
+                zstd_reader_read_bytes(zstd_reader_p, item_size, &record) != item_size)
+            {
+                ERROR("fail to seek zstd trace\n");
+            }
+            return *(uint32_t *)record;
+        }
+
         uint64_t numRequests;
         int64_t totalRequests;
 
@@ -356,7 +472,11 @@ namespace parser
         struct zstd_reader *zstd_reader_p; // 用于读取zstd文件
         bool is_zstd_file;                 // 是否是 zstd 格式
 
+        ParallelZstdReader *parallel_reader = NULL; // trace.decodeThreads > 0 时并行解压各帧
+        uint64_t start_req_num = 0;                 // 快进跳过的请求数
+
         std::pair<int, int> rest_lba;
+        bool extent_mode; // 每个I/O作为一个(起始LBA, 长度)区间请求，不再展开成逐页请求
 
         int page_size;
     };
@@ -0,0 +1,168 @@
+#pragma once
+#include <string>
+#include <stdint.h>
+#include <cassert>
+#include <cstring>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+
+#include "columnar_trace.hpp"
+#include "parser.hpp"
+#include "../common/logging.h"
+
+namespace parser
+{
+
+    /* replays a columnar trace written by trace_converter: chunks are
+     * decompressed one at a time and each column is decoded in a single
+     * tight loop before requests are handed out row by row */
+    class ColumnarParser : public virtual Parser
+    {
+    public:
+        ColumnarParser(std::string trace_path, int64_t _numRequests) : numRequests(_numRequests)
+        {
+            trace_path_ = trace_path;
+            INFO("Parsing columnar trace file: %s\n", trace_path.c_str());
+
+            int fd;
+            struct stat st;
+            if ((fd = open(trace_path.c_str(), O_RDONLY)) < 0)
+            {
+                ERROR("Unable to open '%s', %s\n", trace_path.c_str(), strerror(errno));
+            }
+            if ((fstat(fd, &st)) < 0)
+            {
+                close(fd);
+                ERROR("Unable to fstat '%s', %s\n", trace_path.c_str(), strerror(errno));
+            }
+            file_size = st.st_size;
+            if (file_size < sizeof(columnar::FileHeader) + sizeof(columnar::FileFooter))
+            {
+                ERROR("'%s' is too small to be a columnar trace\n", trace_path.c_str());
+            }
+            mapped_file = static_cast<uint8_t *>(mmap(NULL, file_size, PROT_READ, MAP_SHARED, fd, 0));
+            close(fd);
+            if (mapped_file == MAP_FAILED)
+            {
+                ERROR("Unable to mmap %lu bytes, %s\n", (unsigned long)file_size, strerror(errno));
+            }
+            madvise(mapped_file, file_size, MADV_SEQUENTIAL);
+
+            memcpy(&header, mapped_file, sizeof(header));
+            columnar::FileFooter footer;
+            memcpy(&footer, mapped_file + file_size - sizeof(footer), sizeof(footer));
+            if (memcmp(header.magic, columnar::MAGIC, sizeof(columnar::MAGIC)) != 0 ||
+                memcmp(footer.magic, columnar::MAGIC, sizeof(columnar::MAGIC)) != 0)
+            {
+                ERROR("'%s' is not a columnar trace (missing footer, conversion not finished?)\n", trace_path.c_str());
+            }
+            if (header.version != columnar::VERSION)
+            {
+                ERROR("unsupported columnar trace version %u\n", header.version);
+            }
+            if (footer.index_offset + footer.num_chunks * sizeof(columnar::ChunkIndexEntry) + sizeof(footer) != file_size)
+            {
+                ERROR("corrupt chunk index in '%s'\n", trace_path.c_str());
+            }
+            index.resize(footer.num_chunks);
+            memcpy(index.data(), mapped_file + footer.index_offset, index.size() * sizeof(columnar::ChunkIndexEntry));
+            tot_req = footer.num_requests;
+            INFO("%lu requests in %lu chunks\n", (unsigned long)tot_req, (unsigned long)index.size());
+        }
+
+        ~ColumnarParser()
+        {
+            munmap(mapped_file, file_size);
+        }
+
+        void go(VisitorFn visit)
+        {
+            Request req;
+            memset(&req, 0, sizeof(req));
+            while (_nextChunk())
+            {
+                for (; cursor < chunk.size; cursor++)
+                {
+                    _fill(&req);
+                    visit(&req);
+                    if (numRequests < 0) // numRequests < 0表示不限制请求数量
+                        continue;
+                    if (numRequests != 0)
+                        numRequests--;
+                    else
+                    {
+                        INFO("Finished Processing %ld Requests\n", req.req_num);
+                        return;
+                    }
+                }
+            }
+            INFO("Read EOF, Processed %ld Requests\n", req.req_num);
+        }
+
+        int read_one_req(parser::Request *req)
+        {
+            if (cursor >= chunk.size && !_nextChunk())
+            {
+                INFO("Read EOF, Processed %ld Requests\n", req->req_num);
+                return 0;
+            }
+            _fill(req);
+            cursor++;
+            if (numRequests < 0) // numRequests < 0表示不限制请求数量
+                return 1;
+            if (numRequests != 0)
+            {
+                numRequests--;
+                return 1;
+            }
+            INFO("Finished Processing %ld Requests\n", req->req_num);
+            return 0;
+        }
+
+    private:
+        // 解码下一个块，没有剩余块时返回false
+        bool _nextChunk()
+        {
+            if (next_chunk >= index.size())
+            {
+                return false;
+            }
+            auto &entry = index[next_chunk++];
+            if (entry.offset + entry.compressed_bytes > file_size)
+            {
+                ERROR("corrupt chunk index in '%s'\n", trace_path_.c_str());
+            }
+            chunk.decode(mapped_file + entry.offset, entry, header.column_mask);
+            cursor = 0;
+            return true;
+        }
+
+        inline void _fill(Request *req)
+        {
+            using namespace columnar;
+            req->time = chunk.cols[COL_TIME][cursor];
+            req->req_num = chunk.cols[COL_REQ_NUM][cursor];
+            req->id = chunk.cols[COL_ID][cursor];
+            req->req_size = chunk.cols[COL_SIZE][cursor];
+            req->type = (req_op_e)chunk.cols[COL_OP][cursor];
+            req->next_access_vtime = chunk.cols[COL_NEXT_VTIME][cursor];
+            req->next_access_op = (req_op_e)chunk.cols[COL_NEXT_OP][cursor];
+            req->future_invalid_time = chunk.cols[COL_FUTURE_INVALID][cursor];
+        }
+
+        int64_t numRequests;
+
+        uint8_t *mapped_file; // 映射文件的指针
+        size_t file_size;
+        columnar::FileHeader header;
+        std::vector<columnar::ChunkIndexEntry> index;
+
+        columnar::Chunk chunk; // 当前解码的块
+        size_t cursor = 0;     // 当前块中下一个请求的位置
+        size_t next_chunk = 0;
+    };
+
+} // namespace parser
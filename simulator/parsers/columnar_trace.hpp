@@ -0,0 +1,377 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <cassert>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <zstd.h>
+
+#include "../common/logging.h"
+#include "../constants.hpp"
+#include "parser.hpp"
+
+namespace parser
+{
+
+    /* Chunked columnar trace format written by trace_converter and read by
+     * ColumnarParser. Layout:
+     *
+     *   FileHeader | chunk 0 | chunk 1 | ... | ChunkIndexEntry[num_chunks] | FileFooter
+     *
+     * A chunk is one zstd frame holding up to chunk_requests requests. The
+     * decompressed chunk starts with uint32_t column_bytes[NUM_COLUMNS]
+     * followed by the columns back to back. Integer columns are LEB128
+     * varints, either plain or zigzag deltas against the previous row of the
+     * same chunk (each chunk decodes on its own); next_access_vtime is stored
+     * relative to req_num. Op columns are one byte per request. Optional
+     * columns that are absent from column_mask have zero bytes. */
+    namespace columnar
+    {
+
+        const char MAGIC[8] = {'L', 'S', 'C', 'T', 'R', 'A', 'C', 'E'};
+        const uint32_t VERSION = 1;
+
+        enum Column
+        {
+            COL_TIME = 0,
+            COL_REQ_NUM,
+            COL_ID,
+            COL_SIZE,
+            COL_OP,
+            COL_NEXT_VTIME,
+            COL_NEXT_OP,
+            COL_FUTURE_INVALID,
+            NUM_COLUMNS
+        };
+
+        // 必需列，其余列按column_mask可选
+        const uint32_t BASE_COLUMNS = (1u << COL_TIME) | (1u << COL_REQ_NUM) | (1u << COL_ID) | (1u << COL_SIZE) | (1u << COL_OP);
+        const uint32_t NEXT_ACCESS_COLUMNS = (1u << COL_NEXT_VTIME) | (1u << COL_NEXT_OP);
+        const uint32_t FUTURE_INVALID_COLUMNS = 1u << COL_FUTURE_INVALID;
+
+        struct FileHeader
+        {
+            char magic[8];
+            uint32_t version;
+            uint32_t chunk_requests;
+            uint32_t column_mask;
+            uint32_t reserved;
+        };
+
+        struct ChunkIndexEntry
+        {
+            uint64_t offset;           // 压缩块在文件中的偏移
+            uint32_t compressed_bytes;
+            uint32_t raw_bytes;
+            uint32_t num_requests;
+            uint32_t reserved;
+            uint64_t first_time;       // 块内第一个请求的时间戳
+            int64_t first_req_num;     // 块内第一个请求的req_num
+        };
+
+        struct FileFooter
+        {
+            uint64_t index_offset;
+            uint64_t num_chunks;
+            uint64_t num_requests;
+            char magic[8];
+        };
+
+        /* ----------------- varint / zigzag --------------------- */
+
+        inline uint64_t zigzag(int64_t v) { return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63); }
+        inline int64_t unzigzag(uint64_t v) { return (int64_t)(v >> 1) ^ -(int64_t)(v & 1); }
+
+        inline void putVarint(std::vector<uint8_t> &out, uint64_t v)
+        {
+            while (v >= 0x80)
+            {
+                out.push_back((uint8_t)v | 0x80);
+                v >>= 7;
+            }
+            out.push_back((uint8_t)v);
+        }
+
+        /* decodes n varints from [p, end) into out, returns the number of
+         * bytes consumed or 0 on a truncated column. Runs of eight one-byte
+         * varints (the common case for deltas) are expanded a word at a time. */
+        inline size_t getVarints(const uint8_t *p, const uint8_t *end, uint64_t *out, size_t n)
+        {
+            const uint8_t *start = p;
+            size_t i = 0;
+            while (i < n)
+            {
+                if (i + 8 <= n && p + 8 <= end)
+                {
+                    uint64_t word;
+                    memcpy(&word, p, 8);
+                    if ((word & 0x8080808080808080ULL) == 0)
+                    {
+                        for (int k = 0; k < 8; k++)
+                        {
+                            out[i + k] = (word >> (8 * k)) & 0xFF;
+                        }
+                        i += 8;
+                        p += 8;
+                        continue;
+                    }
+                }
+                uint64_t v = 0;
+                int shift = 0;
+                while (true)
+                {
+                    if (p >= end || shift > 63)
+                    {
+                        return 0;
+                    }
+                    uint8_t b = *p++;
+                    v |= (uint64_t)(b & 0x7F) << shift;
+                    if (!(b & 0x80))
+                    {
+                        break;
+                    }
+                    shift += 7;
+                }
+                out[i++] = v;
+            }
+            return p - start;
+        }
+
+        // 将zigzag差值就地还原为原始值
+        inline void undelta(uint64_t *v, size_t n)
+        {
+            uint64_t prev = 0;
+            for (size_t i = 0; i < n; i++)
+            {
+                prev += (uint64_t)unzigzag(v[i]);
+                v[i] = prev;
+            }
+        }
+
+        inline bool isDeltaColumn(int col)
+        {
+            return col == COL_TIME || col == COL_REQ_NUM || col == COL_ID || col == COL_FUTURE_INVALID;
+        }
+
+        /* one decoded chunk, column by column */
+        struct Chunk
+        {
+            size_t size = 0;
+            std::vector<uint64_t> cols[NUM_COLUMNS];
+            std::vector<uint8_t> raw;
+
+            /* decompresses and decodes a chunk frame, ERRORs on corruption */
+            void decode(const uint8_t *frame, const ChunkIndexEntry &entry, uint32_t column_mask)
+            {
+                raw.resize(entry.raw_bytes);
+                size_t got = ZSTD_decompress(raw.data(), raw.size(), frame, entry.compressed_bytes);
+                if (ZSTD_isError(got) || got != entry.raw_bytes)
+                {
+                    ERROR("corrupt columnar chunk at offset %lu\n", (unsigned long)entry.offset);
+                }
+
+                size = entry.num_requests;
+                uint32_t col_bytes[NUM_COLUMNS];
+                memcpy(col_bytes, raw.data(), sizeof(col_bytes));
+                const uint8_t *p = raw.data() + sizeof(col_bytes);
+                const uint8_t *end = raw.data() + raw.size();
+                for (int col = 0; col < NUM_COLUMNS; col++)
+                {
+                    const uint8_t *col_end = p + col_bytes[col];
+                    if (col_end > end)
+                    {
+                        ERROR("corrupt columnar chunk at offset %lu\n", (unsigned long)entry.offset);
+                    }
+                    if (!(column_mask & (1u << col)))
+                    {
+                        cols[col].assign(size, 0);
+                    }
+                    else if (col == COL_OP || col == COL_NEXT_OP)
+                    {
+                        if (col_bytes[col] != size)
+                        {
+                            ERROR("corrupt columnar chunk at offset %lu\n", (unsigned long)entry.offset);
+                        }
+                        cols[col].assign(p, col_end);
+                    }
+                    else
+                    {
+                        cols[col].resize(size);
+                        if (getVarints(p, col_end, cols[col].data(), size) == 0 && size > 0)
+                        {
+                            ERROR("corrupt columnar chunk at offset %lu\n", (unsigned long)entry.offset);
+                        }
+                        if (isDeltaColumn(col))
+                        {
+                            undelta(cols[col].data(), size);
+                        }
+                    }
+                    p = col_end;
+                }
+                if (column_mask & (1u << COL_NEXT_VTIME))
+                {
+                    for (size_t i = 0; i < size; i++)
+                    {
+                        cols[COL_NEXT_VTIME][i] = cols[COL_REQ_NUM][i] + (uint64_t)unzigzag(cols[COL_NEXT_VTIME][i]);
+                    }
+                }
+            }
+        };
+
+        /* streams requests into a columnar trace file; finish() (or the
+         * destructor) writes the chunk index and footer */
+        class Writer
+        {
+        public:
+            Writer(const std::string &path, uint32_t column_mask, uint32_t chunk_requests = COLUMNAR_CHUNK_REQUESTS,
+                   int zstd_level = COLUMNAR_ZSTD_LEVEL) : _column_mask(column_mask | BASE_COLUMNS),
+                                                           _chunk_requests(chunk_requests),
+                                                           _zstd_level(zstd_level)
+            {
+                assert(chunk_requests > 0);
+                _file = fopen(path.c_str(), "wb");
+                if (_file == nullptr)
+                {
+                    ERROR("cannot open %s for writing\n", path.c_str());
+                }
+                FileHeader header = {};
+                memcpy(header.magic, MAGIC, sizeof(MAGIC));
+                header.version = VERSION;
+                header.chunk_requests = _chunk_requests;
+                header.column_mask = _column_mask;
+                _write(&header, sizeof(header));
+                for (int col = 0; col < NUM_COLUMNS; col++)
+                {
+                    _cols[col].reserve(_chunk_requests);
+                }
+            }
+
+            ~Writer()
+            {
+                if (_file != nullptr)
+                {
+                    finish();
+                }
+            }
+
+            void append(const Request *req)
+            {
+                _cols[COL_TIME].push_back(req->time);
+                _cols[COL_REQ_NUM].push_back(req->req_num);
+                _cols[COL_ID].push_back(req->id);
+                _cols[COL_SIZE].push_back(req->req_size);
+                _cols[COL_OP].push_back(req->type);
+                _cols[COL_NEXT_VTIME].push_back(zigzag(req->next_access_vtime - req->req_num));
+                _cols[COL_NEXT_OP].push_back(req->next_access_op);
+                _cols[COL_FUTURE_INVALID].push_back(req->future_invalid_time);
+                if (_cols[COL_TIME].size() == _chunk_requests)
+                {
+                    _flushChunk();
+                }
+            }
+
+            void finish()
+            {
+                _flushChunk();
+                FileFooter footer = {};
+                footer.index_offset = _offset;
+                footer.num_chunks = _index.size();
+                footer.num_requests = _num_requests;
+                memcpy(footer.magic, MAGIC, sizeof(MAGIC));
+                _write(_index.data(), _index.size() * sizeof(ChunkIndexEntry));
+                _write(&footer, sizeof(footer));
+                fclose(_file);
+                _file = nullptr;
+            }
+
+            uint64_t numRequests() const { return _num_requests; }
+            uint64_t bytesWritten() const { return _offset; }
+
+        private:
+            void _write(const void *data, size_t bytes)
+            {
+                if (bytes > 0 && fwrite(data, 1, bytes, _file) != bytes)
+                {
+                    ERROR("columnar trace write failed\n");
+                }
+                _offset += bytes;
+            }
+
+            void _flushChunk()
+            {
+                size_t n = _cols[COL_TIME].size();
+                if (n == 0)
+                {
+                    return;
+                }
+
+                uint32_t col_bytes[NUM_COLUMNS] = {0};
+                _raw.assign(sizeof(col_bytes), 0);
+                for (int col = 0; col < NUM_COLUMNS; col++)
+                {
+                    size_t before = _raw.size();
+                    if (_column_mask & (1u << col))
+                    {
+                        uint64_t prev = 0;
+                        for (uint64_t v : _cols[col])
+                        {
+                            if (col == COL_OP || col == COL_NEXT_OP)
+                            {
+                                _raw.push_back((uint8_t)v);
+                            }
+                            else if (isDeltaColumn(col))
+                            {
+                                putVarint(_raw, zigzag((int64_t)(v - prev)));
+                                prev = v;
+                            }
+                            else
+                            {
+                                putVarint(_raw, v);
+                            }
+                        }
+                    }
+                    col_bytes[col] = _raw.size() - before;
+                }
+                memcpy(_raw.data(), col_bytes, sizeof(col_bytes));
+
+                _compressed.resize(ZSTD_compressBound(_raw.size()));
+                size_t compressed = ZSTD_compress(_compressed.data(), _compressed.size(), _raw.data(), _raw.size(), _zstd_level);
+                if (ZSTD_isError(compressed))
+                {
+                    ERROR("zstd compression failed: %s\n", ZSTD_getErrorName(compressed));
+                }
+
+                ChunkIndexEntry entry = {};
+                entry.offset = _offset;
+                entry.compressed_bytes = compressed;
+                entry.raw_bytes = _raw.size();
+                entry.num_requests = n;
+                entry.first_time = _cols[COL_TIME][0];
+                entry.first_req_num = _cols[COL_REQ_NUM][0];
+                _index.push_back(entry);
+                _write(_compressed.data(), compressed);
+
+                _num_requests += n;
+                for (int col = 0; col < NUM_COLUMNS; col++)
+                {
+                    _cols[col].clear();
+                }
+            }
+
+            FILE *_file;
+            uint32_t _column_mask;
+            uint32_t _chunk_requests;
+            int _zstd_level;
+            uint64_t _offset = 0;
+            uint64_t _num_requests = 0;
+            std::vector<uint64_t> _cols[NUM_COLUMNS];
+            std::vector<uint8_t> _raw;
+            std::vector<uint8_t> _compressed;
+            std::vector<ChunkIndexEntry> _index;
+        };
+
+    } // namespace columnar
+
+} // namespace parser
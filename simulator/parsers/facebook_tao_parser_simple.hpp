@@ -10,6 +10,7 @@
 #include <string>
 #include <stdint.h>
 #include <cassert>
+#include <cstring>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/ioctl.h>
@@ -18,6 +19,7 @@
 
 #include "../constants.hpp"
 #include "../lib/csv.h"
+#include "parallel_csv_reader.hpp"
 
 namespace parser
 {
@@ -27,12 +29,18 @@ namespace parser
   class FacebookTaoSimpleParser : public virtual Parser
   {
   public:
-    FacebookTaoSimpleParser(std::string filename, uint64_t _numRequests, double _sampling, double _seed, double _object_scaling)
+    FacebookTaoSimpleParser(std::string filename, uint64_t _numRequests, double _sampling, double _seed, double _object_scaling,
+                            int _parse_threads = 0)
     {
       std::cout << "Parsing simple tao, object file: " << filename << std::endl;
 
-      reader = new FacebookSimpleCSVformat(filename);
-      reader->set_header("fbid", "size", "op_count");
+      parse_threads = _parse_threads;
+      trace_filename = filename;
+      if (parse_threads <= 0)
+      {
+        reader = new FacebookSimpleCSVformat(filename);
+        reader->set_header("fbid", "size", "op_count");
+      }
 
       numRequests = _numRequests;
       totalRequests = _numRequests;
@@ -47,77 +55,120 @@ namespace parser
 
     void go(VisitorFn visit)
     {
-      std::string tmp;
+      Request req;
+      memset(&req, 0, sizeof(req));
+      req.type = OP_GET; // tao负载中只有读请求
+      if (parse_threads > 0)
+      {
+        // 多线程解析分块，按文件顺序回放
+        ParallelCSVReader csv(trace_filename, parse_threads, _parseRow, false);
+        std::vector<CSVRecord> batch;
+        while (csv.next(batch))
+        {
+          for (auto &rec : batch)
+          {
+            if (!_visitRow(rec, visit, req))
+            {
+              return;
+            }
+          }
+        }
+        return;
+      }
+
       size_t op_count = 0;
-      int64_t shard = 0;
       int64_t req_size = 0;
       std::string fbid;
-      Request req;
-      req.req_num = 0;
       while (reader->read_row(fbid, req_size, op_count))
       {
-        if (numRequests == 0)
+        CSVRecord rec = {std::hash<std::string>{}(fbid), req_size, (uint32_t)op_count, OP_GET};
+        if (!_visitRow(rec, visit, req))
         {
-          std::cout << "Finished Processing "
-                    << totalRequests << " Requests\n";
           return;
         }
+      }
+    }
+
+    int read_one_req(parser::Request *req)
+    {
+      return 0;
+    }
+
+  private:
+    // fbid,size,op_count
+    static bool _parseRow(const char *p, const char *end, CSVRecord &rec)
+    {
+      std::string_view fbid = ParallelCSVReader::nextField(p, end);
+      rec.id = std::hash<std::string_view>{}(fbid); // 与std::hash<std::string>结果一致
+      rec.size = ParallelCSVReader::toInt(ParallelCSVReader::nextField(p, end));
+      rec.op_count = ParallelCSVReader::toInt(ParallelCSVReader::nextField(p, end));
+      rec.op = OP_GET;
+      return true;
+    }
+
+    // 将一行展开为op_count个请求，达到请求数上限时返回false
+    bool _visitRow(const CSVRecord &rec, VisitorFn visit, Request &req)
+    {
+      int64_t shard = 0;
+
+      if (numRequests == 0)
+      {
+        std::cout << "Finished Processing "
+                  << totalRequests << " Requests\n";
+        return false;
+      }
 
-        if (sampling != 1 && (selected_items.find(shard) == selected_items.end()))
+      if (sampling != 1 && (selected_items.find(shard) == selected_items.end()))
+      {
+        if (discarded_items.find(shard) == discarded_items.end())
         {
-          if (discarded_items.find(shard) == discarded_items.end())
+          double currentRandom = unif(randomGenerator);
+          if (currentRandom < sampling)
           {
-            double currentRandom = unif(randomGenerator);
-            if (currentRandom < sampling)
-            {
-              selected_items.insert(shard);
-            }
-            else
-            {
-              discarded_items.insert(shard);
-              continue;
-            }
+            selected_items.insert(shard);
           }
           else
           {
-            continue;
+            discarded_items.insert(shard);
+            return true;
           }
         }
-
-        req.id = std::hash<std::string>{}(fbid);
-        req.req_size = req_size + SIZE_OF_KEY;
-        double s = req.req_size * scaling;
-        req.req_size = round(s);
-        if (req.req_size >= MAX_TAO_SIZE)
+        else
         {
-          req.req_size = MAX_TAO_SIZE - 1;
-        }
-        else if (req.req_size == 0)
-        {
-          req.req_size = 1;
+          return true;
         }
+      }
 
-        for (uint i = 0; i < op_count; i++)
+      req.id = rec.id;
+      req.req_size = rec.size + SIZE_OF_KEY;
+      double s = req.req_size * scaling;
+      req.req_size = round(s);
+      if (req.req_size >= MAX_TAO_SIZE)
+      {
+        req.req_size = MAX_TAO_SIZE - 1;
+      }
+      else if (req.req_size == 0)
+      {
+        req.req_size = 1;
+      }
+
+      for (uint i = 0; i < rec.op_count; i++)
+      {
+        req.req_num++;
+        req.time = req.req_num;
+        visit(&req);
+        if (numRequests != 0)
         {
-          req.req_num++;
-          req.time = req.req_num;
-          visit(&req);
-          if (numRequests != 0)
-          {
-            numRequests--;
-          }
+          numRequests--;
         }
       }
+      return true;
     }
 
-    int read_one_req(parser::Request *req)
-    {
-      return 0;
-    }
-
-  private:
     typedef io::CSVReader<3, io::trim_chars<' '>, io::no_quote_escape<','>> FacebookSimpleCSVformat;
-    FacebookSimpleCSVformat *reader;
+    FacebookSimpleCSVformat *reader = nullptr;
+    std::string trace_filename;
+    int parse_threads;
     int64_t numRequests;
     int64_t totalRequests;
     double sampling;
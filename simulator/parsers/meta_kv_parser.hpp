@@ -10,6 +10,7 @@
 #include <string>
 #include <stdint.h>
 #include <cassert>
+#include <cstring>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/ioctl.h>
@@ -19,6 +20,7 @@
 #include "../constants.hpp"
 #include "../lib/csv.h"
 #include "parser.hpp"
+#include "parallel_csv_reader.hpp"
 #include "../common/logging.h"
 
 namespace parser
@@ -29,14 +31,20 @@ namespace parser
     class MetaKVParser : public virtual Parser
     {
     public:
-        MetaKVParser(std::string filename, uint64_t _numRequests, double _sampling, double _seed, double _object_scaling)
+        MetaKVParser(std::string filename, uint64_t _numRequests, double _sampling, double _seed, double _object_scaling,
+                     int _parse_threads = 0)
         {
             std::cout << "Parsing MetaKV, object file: " << filename << std::endl;
 
-            reader = new MetaKVCSVformat(filename);
-            // key,op,size,op_count,key_size
-            reader->set_header("key", "op", "size", "op_count", "key_size");
-            reader->read_header(io::ignore_no_column, "key", "op", "size", "op_count", "key_size");
+            parse_threads = _parse_threads;
+            trace_filename = filename;
+            if (parse_threads <= 0)
+            {
+                reader = new MetaKVCSVformat(filename);
+                // key,op,size,op_count,key_size
+                reader->set_header("key", "op", "size", "op_count", "key_size");
+                reader->read_header(io::ignore_no_column, "key", "op", "size", "op_count", "key_size");
+            }
 
             numRequests = _numRequests;
             totalRequests = _numRequests;
@@ -52,7 +60,13 @@ namespace parser
 
         void go(VisitorFn visit)
         {
-            int64_t shard = 0;
+            Request req;
+            memset(&req, 0, sizeof(req));
+            if (parse_threads > 0)
+            {
+                _goParallel(visit, req);
+                return;
+            }
 
             std::string key;
             std::string op;
@@ -60,91 +74,17 @@ namespace parser
             size_t op_count = 0;
             int64_t key_size = 0;
 
-            Request req;
-            req.req_num = 0;
             while (reader->read_row(key, op, size, op_count, key_size))
             {
                 // if (req.req_num <= 10)
                 // INFO("key:%s,op:%s,size:%ld,op_count:%ld,key_size:%ld\n", key.c_str(), op.c_str(), size, op_count, key_size);
 
-                if (numRequests == 0)
+                CSVRecord rec = {std::hash<std::string>{}(key), size + key_size, (uint32_t)op_count,
+                                 ParallelCSVReader::toOp(op)};
+                if (!_visitRow(rec, visit, req))
                 {
-                    std::cout << "Finished Processing "
-                              << totalRequests << " Requests\n";
                     return;
                 }
-
-                if (sampling != 1 && (selected_items.find(shard) == selected_items.end()))
-                {
-                    if (discarded_items.find(shard) == discarded_items.end())
-                    {
-                        double currentRandom = unif(randomGenerator);
-                        if (currentRandom < sampling) // 根据采样率和随机数判断是否采样
-                        {
-                            selected_items.insert(shard);
-                        }
-                        else
-                        {
-                            discarded_items.insert(shard);
-                            continue;
-                        }
-                    }
-                    else
-                    {
-                        continue;
-                    }
-                }
-
-                req.id = std::hash<std::string>{}(key);
-                req.req_size = size + key_size;
-                double s = req.req_size * scaling;
-                req.req_size = round(s);
-
-                // 这里用于控制kv的大小，若过大，放不进一个4kb block，则应特殊处理
-                // 这里是直接设置成大小上限了
-                if (req.req_size >= MAX_TAO_SIZE)
-                {
-                    req.req_size = MAX_TAO_SIZE - 1;
-                }
-                if (req.req_size == 0)
-                {
-                    req.req_size = 1;
-                }
-
-                // if (op == "SET")
-                // {
-                //     req.type = parser::SET;
-                // }
-                // else if (op == "GET")
-                // {
-                //     req.type = parser::GET;
-                // }
-                // else if (op == "DELETE")
-                // {
-                //     req.type = parser::DELETE;
-                // }
-                // else
-                // {
-                //     req.type = parser::OTHER;
-                // }
-
-                for (uint i = 0; i < op_count; i++)
-                {
-                    req.req_num++;
-                    req.time = req.req_num;
-                    visit(&req);
-                    if (numRequests < 0) // numRequests < 0表示不限制请求数量
-                        continue;
-                    if (numRequests != 0)
-                    {
-                        numRequests--;
-                    }
-                    else
-                    {
-                        INFO("Finished Processing %ld Requests\n", req.req_num);
-                        return;
-                    }
-                }
             }
             INFO("Read EOF, Processed %ld Requests\n", req.req_num);
         }
@@ -157,6 +97,11 @@ namespace parser
                 return 1;
             }
 
+            if (reader == nullptr)
+            {
+                ERROR("read_one_req is not supported with trace.parseThreads > 0\n");
+            }
+
             int64_t shard = 0;
 
             std::string key;
@@ -203,8 +148,119 @@ namespace parser
         }
 
     private:
+        /* mmap the trace and parse newline aligned chunks on parse_threads
+         * workers; rows are replayed in file order, so the request stream is
+         * the same as the serial reader's. Columns must be in header order. */
+        void _goParallel(VisitorFn visit, Request &req)
+        {
+            ParallelCSVReader csv(trace_filename, parse_threads, _parseRow, true);
+            if (csv.header().find("key,op,size,op_count,key_size") == std::string::npos)
+            {
+                WARN("unexpected MetaKV header \"%s\", assuming key,op,size,op_count,key_size\n", csv.header().c_str());
+            }
+            std::vector<CSVRecord> batch;
+            while (csv.next(batch))
+            {
+                for (auto &rec : batch)
+                {
+                    if (!_visitRow(rec, visit, req))
+                    {
+                        return;
+                    }
+                }
+            }
+            INFO("Read EOF, Processed %ld Requests\n", req.req_num);
+        }
+
+        // key,op,size,op_count,key_size
+        static bool _parseRow(const char *p, const char *end, CSVRecord &rec)
+        {
+            std::string_view key = ParallelCSVReader::nextField(p, end);
+            std::string_view op = ParallelCSVReader::nextField(p, end);
+            int64_t size = ParallelCSVReader::toInt(ParallelCSVReader::nextField(p, end));
+            int64_t op_count = ParallelCSVReader::toInt(ParallelCSVReader::nextField(p, end));
+            int64_t key_size = ParallelCSVReader::toInt(ParallelCSVReader::nextField(p, end));
+            rec.id = std::hash<std::string_view>{}(key); // 与std::hash<std::string>结果一致
+            rec.size = size + key_size;
+            rec.op_count = op_count;
+            rec.op = ParallelCSVReader::toOp(op);
+            return true;
+        }
+
+        // 将一行展开为op_count个请求，达到请求数上限时返回false
+        bool _visitRow(const CSVRecord &rec, VisitorFn visit, Request &req)
+        {
+            int64_t shard = 0;
+
+            if (numRequests == 0)
+            {
+                std::cout << "Finished Processing "
+                          << totalRequests << " Requests\n";
+                return false;
+            }
+
+            if (sampling != 1 && (selected_items.find(shard) == selected_items.end()))
+            {
+                if (discarded_items.find(shard) == discarded_items.end())
+                {
+                    double currentRandom = unif(randomGenerator);
+                    if (currentRandom < sampling) // 根据采样率和随机数判断是否采样
+                    {
+                        selected_items.insert(shard);
+                    }
+                    else
+                    {
+                        discarded_items.insert(shard);
+                        return true;
+                    }
+                }
+                else
+                {
+                    return true;
+                }
+            }
+
+            req.id = rec.id;
+            req.req_size = rec.size;
+            double s = req.req_size * scaling;
+            req.req_size = round(s);
+
+            // 这里用于控制kv的大小，若过大，放不进一个4kb block，则应特殊处理
+            // 这里是直接设置成大小上限了
+            if (req.req_size >= MAX_TAO_SIZE)
+            {
+                req.req_size = MAX_TAO_SIZE - 1;
+            }
+            if (req.req_size == 0)
+            {
+                req.req_size = 1;
+            }
+            req.type = rec.op;
+
+            for (uint i = 0; i < rec.op_count; i++)
+            {
+                req.req_num++;
+                req.time = req.req_num;
+                visit(&req);
+                if (numRequests < 0) // numRequests < 0表示不限制请求数量
+                    continue;
+                if (numRequests != 0)
+                {
+                    numRequests--;
+                }
+                else
+                {
+                    INFO("Finished Processing %ld Requests\n", req.req_num);
+                    return false;
+                }
+            }
+            return true;
+        }
+
         typedef io::CSVReader<5, io::trim_chars<' '>, io::no_quote_escape<','>> MetaKVCSVformat;
-        MetaKVCSVformat *reader;
+        MetaKVCSVformat *reader = nullptr;
+        std::string trace_filename;
+        int parse_threads;
         int64_t numRequests;
         int64_t totalRequests;
         double sampling;
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace parser
+{
+
+    /* runs produce(i, batch) for i in [0, num_items) on worker threads and
+     * hands the batches to a single consumer strictly in index order. At most
+     * 2 * num_threads batches are in flight, so workers never run far ahead
+     * of the consumer. Batches are recycled, so produce must overwrite
+     * whatever the batch it is given holds. */
+    template <typename Batch>
+    class OrderedPipeline
+    {
+    public:
+        typedef std::function<void(uint64_t item, Batch &batch)> ProduceFn;
+
+        OrderedPipeline(uint64_t num_items, int num_threads, ProduceFn produce) : _produce(produce),
+                                                                                  _num_items(num_items)
+        {
+            assert(num_threads > 0);
+            _depth = 2 * num_threads;
+            _slots.resize(_depth);
+            _ready.assign(_depth, false);
+            for (int i = 0; i < num_threads; i++)
+            {
+                _workers.emplace_back(&OrderedPipeline::_work, this);
+            }
+        }
+
+        ~OrderedPipeline()
+        {
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _stop = true;
+            }
+            _cv_space.notify_all();
+            for (auto &worker : _workers)
+            {
+                worker.join();
+            }
+        }
+
+        // 按顺序取出下一批结果，全部取完后返回false
+        bool next(Batch &batch)
+        {
+            if (_next_deliver >= _num_items)
+            {
+                return false;
+            }
+            uint64_t slot = _next_deliver % _depth;
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _cv_ready.wait(lock, [&]
+                               { return _ready[slot]; });
+                std::swap(batch, _slots[slot]);
+                _ready[slot] = false;
+                _next_deliver++;
+            }
+            _cv_space.notify_all();
+            return true;
+        }
+
+    private:
+        void _work()
+        {
+            Batch batch;
+            while (true)
+            {
+                uint64_t i = _next_item.fetch_add(1);
+                if (i >= _num_items)
+                {
+                    return;
+                }
+                {
+                    // 只允许领先消费者depth个批次
+                    std::unique_lock<std::mutex> lock(_mutex);
+                    _cv_space.wait(lock, [&]
+                                   { return _stop || i < _next_deliver + _depth; });
+                    if (_stop)
+                    {
+                        return;
+                    }
+                }
+
+                _produce(i, batch);
+
+                {
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    std::swap(_slots[i % _depth], batch); // 换回消费者用过的缓冲区，减少内存分配
+                    _ready[i % _depth] = true;
+                }
+                _cv_ready.notify_all();
+            }
+        }
+
+        ProduceFn _produce;
+        uint64_t _num_items;
+        uint64_t _depth;
+
+        std::vector<std::thread> _workers;
+        std::atomic<uint64_t> _next_item{0};
+        uint64_t _next_deliver = 0; // 下一个交给消费者的批次，受_mutex保护
+        bool _stop = false;
+        std::vector<Batch> _slots; // 按批次号取模的环形缓冲
+        std::vector<bool> _ready;
+        std::mutex _mutex;
+        std::condition_variable _cv_ready;
+        std::condition_variable _cv_space;
+    };
+
+} // namespace parser
@@ -0,0 +1,181 @@
+#pragma once
+
+#include <charconv>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <fcntl.h>
+#include <strings.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../common/logging.h"
+#include "../constants.hpp"
+#include "ordered_pipeline.hpp"
+#include "parser.hpp"
+
+namespace parser
+{
+
+    /* compact parsed row, the key is already hashed to a 64-bit id */
+    struct CSVRecord
+    {
+        uint64_t id;
+        int64_t size;
+        uint32_t op_count;
+        req_op_e op;
+    };
+
+    /* mmap based CSV ingest: the file is split into newline aligned chunks
+     * that worker threads parse into CSVRecord batches, batches are handed
+     * back strictly in file order through an OrderedPipeline, so memory stays
+     * bounded however far the workers run ahead. */
+    class ParallelCSVReader
+    {
+    public:
+        // 解析一行（不含换行符），成功返回true，失败的行被跳过
+        typedef std::function<bool(const char *begin, const char *end, CSVRecord &rec)> RowParser;
+
+        ParallelCSVReader(const std::string &filename, int num_threads, RowParser parse_row,
+                          bool skip_header, uint64_t chunk_bytes = CSV_CHUNK_BYTES) : _parse_row(parse_row),
+                                                                                      _chunk_bytes(chunk_bytes)
+        {
+            assert(num_threads > 0 && chunk_bytes > 0);
+            int fd = open(filename.c_str(), O_RDONLY);
+            if (fd < 0)
+            {
+                ERROR("cannot open trace %s\n", filename.c_str());
+            }
+            struct stat st;
+            fstat(fd, &st);
+            _size = st.st_size;
+            if (_size > 0)
+            {
+                _data = (const char *)mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (_data == MAP_FAILED)
+                {
+                    ERROR("cannot mmap trace %s\n", filename.c_str());
+                }
+                madvise((void *)_data, _size, MADV_SEQUENTIAL);
+            }
+            close(fd);
+
+            if (skip_header) // 第一行为表头
+            {
+                const char *nl = _size ? (const char *)memchr(_data, '\n', _size) : nullptr;
+                _header = std::string(_data, nl ? nl - _data : _size);
+                _data_begin = nl ? nl - _data + 1 : _size;
+            }
+            _num_chunks = (_size + _chunk_bytes - 1) / _chunk_bytes;
+            INFO("Parallel CSV ingest: %lu chunks of %lu MB, %d threads\n", _num_chunks, _chunk_bytes >> 20, num_threads);
+            _pipeline.reset(new OrderedPipeline<std::vector<CSVRecord>>(
+                _num_chunks, num_threads, [this](uint64_t i, std::vector<CSVRecord> &records)
+                { _parseChunk(i, records); }));
+        }
+
+        ~ParallelCSVReader()
+        {
+            _pipeline.reset(); // 先停止解析线程再解除映射
+            if (_size > 0)
+            {
+                munmap((void *)_data, _size);
+            }
+        }
+
+        // 按文件顺序取出下一个分块解析出的记录（可能为空），文件读完返回false
+        bool next(std::vector<CSVRecord> &batch)
+        {
+            return _pipeline->next(batch);
+        }
+
+        const std::string &header() const { return _header; }
+
+        /* ----------- field helpers for row parsers --------------- */
+
+        // 取出下一个逗号分隔的字段，并去掉两端的空格
+        static std::string_view nextField(const char *&p, const char *end)
+        {
+            const char *comma = (const char *)memchr(p, ',', end - p);
+            const char *field_end = comma ? comma : end;
+            const char *b = p;
+            const char *e = field_end;
+            while (b < e && *b == ' ')
+            {
+                b++;
+            }
+            while (e > b && (e[-1] == ' ' || e[-1] == '\r'))
+            {
+                e--;
+            }
+            p = comma ? comma + 1 : end;
+            return std::string_view(b, e - b);
+        }
+
+        static int64_t toInt(std::string_view field)
+        {
+            int64_t value = 0;
+            std::from_chars(field.data(), field.data() + field.size(), value);
+            return value;
+        }
+
+        // 按req_op_str将操作名（不区分大小写）转换为请求类型
+        static req_op_e toOp(std::string_view field)
+        {
+            for (int op = OP_NOP; op <= OP_HEAD; op++)
+            {
+                if (strlen(req_op_str[op]) == field.size() &&
+                    strncasecmp(req_op_str[op], field.data(), field.size()) == 0)
+                {
+                    return (req_op_e)op;
+                }
+            }
+            return OP_INVALID;
+        }
+
+    private:
+        // 第i个分块的起点：i*chunk_bytes之后的第一个行首
+        uint64_t _chunkBoundary(uint64_t i)
+        {
+            uint64_t pos = i * _chunk_bytes;
+            if (i == 0 || pos >= _size)
+            {
+                return std::max(std::min(pos, _size), _data_begin);
+            }
+            const char *nl = (const char *)memchr(_data + pos - 1, '\n', _size - pos + 1);
+            return std::max<uint64_t>(nl ? nl - _data + 1 : _size, _data_begin);
+        }
+
+        void _parseChunk(uint64_t i, std::vector<CSVRecord> &records)
+        {
+            records.clear();
+            const char *p = _data + _chunkBoundary(i);
+            const char *end = _data + _chunkBoundary(i + 1);
+            records.reserve((end - p) / 32);
+            while (p < end)
+            {
+                const char *nl = (const char *)memchr(p, '\n', end - p);
+                const char *line_end = nl ? nl : end;
+                CSVRecord rec;
+                if (line_end > p && _parse_row(p, line_end, rec))
+                {
+                    records.push_back(rec);
+                }
+                p = line_end + 1;
+            }
+        }
+
+        RowParser _parse_row;
+        const char *_data = nullptr;
+        uint64_t _size = 0;
+        uint64_t _data_begin = 0;
+        uint64_t _chunk_bytes;
+        uint64_t _num_chunks;
+        std::string _header;
+        std::unique_ptr<OrderedPipeline<std::vector<CSVRecord>>> _pipeline;
+    };
+
+} // namespace parser
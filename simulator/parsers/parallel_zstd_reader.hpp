@@ -0,0 +1,150 @@
+#pragma once
+
+#include <stdint.h>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zstd.h>
+
+#include "../common/logging.h"
+#include "../lib/zstdReader.h"
+#include "ordered_pipeline.hpp"
+
+namespace parser
+{
+
+    /* decodes the frames of a seekable zstd trace on worker threads and
+     * returns the decompressed bytes in file order; records that straddle a
+     * frame boundary are stitched together in a small carry buffer */
+    class ParallelZstdReader
+    {
+    public:
+        ParallelZstdReader(const std::string &path, const zstd_seek_table *table, int num_threads,
+                           uint64_t start_offset = 0) : _table(table)
+        {
+            int fd = open(path.c_str(), O_RDONLY);
+            if (fd < 0)
+            {
+                ERROR("cannot open trace %s\n", path.c_str());
+            }
+            struct stat st;
+            fstat(fd, &st);
+            _size = st.st_size;
+            _data = (const uint8_t *)mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+            close(fd);
+            if (_data == MAP_FAILED)
+            {
+                ERROR("cannot mmap trace %s\n", path.c_str());
+            }
+            if (_table->c_offsets[_table->num_frames] > _size)
+            {
+                ERROR("zstd seek table of %s does not match the file\n", path.c_str());
+            }
+
+            _first_frame = zstd_seek_table_find_frame(_table, start_offset);
+            _skip = start_offset - std::min(start_offset, _table->d_offsets[_first_frame]);
+            INFO("Parallel zstd decode: frames %u-%u, %d threads\n", _first_frame, _table->num_frames, num_threads);
+            _pipeline.reset(new OrderedPipeline<std::vector<char>>(
+                _table->num_frames - _first_frame, num_threads, [this](uint64_t i, std::vector<char> &out)
+                { _decodeFrame(_first_frame + i, i == 0 ? _skip : 0, out); }));
+        }
+
+        ~ParallelZstdReader()
+        {
+            _pipeline.reset(); // 先停止解压线程再解除映射
+            munmap((void *)_data, _size);
+        }
+
+        // 返回指向接下来n字节的指针，剩余数据不足n字节时返回NULL
+        char *read(size_t n)
+        {
+            if (_pos + n <= _cur.size())
+            {
+                char *p = _cur.data() + _pos;
+                _pos += n;
+                return p;
+            }
+
+            // 跨帧的记录拷贝到carry中拼接
+            _carry.assign(_cur.begin() + _pos, _cur.end());
+            while (_pipeline->next(_cur))
+            {
+                if (_carry.empty() && _cur.size() >= n)
+                {
+                    _pos = n;
+                    return _cur.data();
+                }
+                size_t need = n - _carry.size();
+                if (_cur.size() >= need)
+                {
+                    _carry.insert(_carry.end(), _cur.begin(), _cur.begin() + need);
+                    _pos = need;
+                    return _carry.data();
+                }
+                _carry.insert(_carry.end(), _cur.begin(), _cur.end());
+            }
+            _cur.clear();
+            _pos = 0;
+            return NULL;
+        }
+
+    private:
+        void _decodeFrame(uint64_t frame, uint64_t skip, std::vector<char> &out)
+        {
+            // 每个解压线程复用自己的解压上下文
+            static thread_local std::unique_ptr<ZSTD_DCtx, size_t (*)(ZSTD_DCtx *)> dctx(ZSTD_createDCtx(), ZSTD_freeDCtx);
+
+            uint64_t c_begin = _table->c_offsets[frame];
+            uint64_t d_size = _table->d_offsets[frame + 1] - _table->d_offsets[frame];
+            out.resize(d_size);
+            size_t got = ZSTD_decompressDCtx(dctx.get(), out.data(), d_size, _data + c_begin,
+                                             _table->c_offsets[frame + 1] - c_begin);
+            if (ZSTD_isError(got) || got != d_size)
+            {
+                ERROR("fail to decompress zstd frame %lu\n", (unsigned long)frame);
+            }
+            if (skip > 0)
+            {
+                out.erase(out.begin(), out.begin() + skip);
+            }
+        }
+
+        const zstd_seek_table *_table;
+        const uint8_t *_data;
+        uint64_t _size;
+        uint32_t _first_frame;
+        uint64_t _skip; // 起始帧中需要跳过的字节数
+
+        std::unique_ptr<OrderedPipeline<std::vector<char>>> _pipeline;
+        std::vector<char> _cur; // 当前帧解压后的数据
+        size_t _pos = 0;
+        std::vector<char> _carry;
+    };
+
+    /* index of the first record whose timestamp is >= start_time, for traces
+     * with non-decreasing timestamps; time_at(i) reads record i */
+    template <typename TimeAt>
+    uint64_t lowerBoundByTime(uint64_t num_records, uint64_t start_time, TimeAt time_at)
+    {
+        uint64_t lo = 0, hi = num_records;
+        while (lo < hi)
+        {
+            uint64_t mid = lo + (hi - lo) / 2;
+            if (time_at(mid) < start_time)
+            {
+                lo = mid + 1;
+            }
+            else
+            {
+                hi = mid;
+            }
+        }
+        return lo;
+    }
+
+} // namespace parser
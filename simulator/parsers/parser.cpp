@@ -5,9 +5,11 @@
 #include "../config_reader.hpp"
 #include "binary_parser.hpp"
 #include "block_binary_parser.hpp"
+#include "columnar_parser.hpp"
 #include "facebook_tao_parser_simple.hpp"
 #include "meta_kv_parser.hpp"
 #include "zipf_parser.hpp"
+#include "synthetic_parser.hpp"
 
 parser::Parser *parser::Parser::create(const libconfig::Setting &settings) {
     misc::ConfigReader cfg(settings);
@@ -30,19 +32,65 @@ parser::Parser *parser::Parser::create(const libconfig::Setting &settings) {
         auto alpha = cfg.read<float>("trace.alpha");
         auto numObjects = cfg.read<int>("trace.numKObjects");
         auto writeRatio = cfg.read<float>("trace.writeRatio", 0);
-        return new ZipfParser(alpha, numObjects, numRequests, writeRatio);
+        // "bucket"为原有的分桶采样，"rejection"为O(1)内存的rejection-inversion采样
+        std::string sampler = cfg.read<const char *>("trace.zipfSampler", "bucket");
+        if (sampler != "bucket" && sampler != "rejection") {
+            ERROR("unknown trace.zipfSampler %s\n", sampler.c_str());
+        }
+        bool scrambleIds = cfg.read<bool>("trace.scrambleIds", false);
+        uint64_t seed = cfg.read<int>("trace.zipfSeed", 0);
+        int genThreads = cfg.read<int>("trace.genThreads", 0);
+        uint64_t objectSize = cfg.read<int>("trace.objectSize", 4096);
+        return new ZipfParser(alpha, numObjects, numRequests, writeRatio, sampler == "rejection", scrambleIds, seed,
+                              genThreads, objectSize);
+    } else if (parserType == "Churn" || parserType == "Scan" || parserType == "WriteStorm" ||
+               parserType == "Phases" || parserType == "GrowingWSS") {
+        // 合成压力负载，公共参数与Zipf负载相同
+        assert(numRequests > 0);
+        SyntheticConfig synth;
+        synth.numRequests = numRequests;
+        synth.alpha = cfg.read<float>("trace.alpha", 0.8);
+        synth.numObjects = 1000 * (uint64_t)cfg.read<int>("trace.numKObjects");
+        synth.writeRatio = cfg.read<float>("trace.writeRatio", 0);
+        synth.seed = cfg.read<int>("trace.zipfSeed", 0);
+        synth.objectSize = cfg.read<int>("trace.objectSize", 4096);
+        synth.scrambleIds = cfg.read<bool>("trace.scrambleIds", false);
+        if (parserType == "Churn") {
+            double churn = cfg.read<double>("trace.churn", 0.01);
+            return new ChurnParser(synth, churn);
+        } else if (parserType == "Scan") {
+            uint64_t scanPeriod = 1000 * (uint64_t)cfg.read<int>("trace.scanPeriodK", 1000);
+            uint64_t scanLength = 1000 * (uint64_t)cfg.read<int>("trace.scanLengthK", 100);
+            return new ScanParser(synth, scanPeriod, scanLength);
+        } else if (parserType == "WriteStorm") {
+            uint64_t stormPeriod = 1000 * (uint64_t)cfg.read<int>("trace.stormPeriodK", 1000);
+            uint64_t stormLength = 1000 * (uint64_t)cfg.read<int>("trace.stormLengthK", 100);
+            double stormWriteRatio = cfg.read<double>("trace.stormWriteRatio", 1.0);
+            return new WriteStormParser(synth, stormPeriod, stormLength, stormWriteRatio);
+        } else if (parserType == "Phases") {
+            uint64_t phaseLength = 1000 * (uint64_t)cfg.read<int>("trace.phaseLengthK", 1000);
+            std::string writeRatios = cfg.read<const char *>("trace.phaseWriteRatios", "0.05,0.5,0.95");
+            std::string alphas = cfg.read<const char *>("trace.phaseAlphas", std::to_string(synth.alpha).c_str());
+            return new PhasesParser(synth, phaseLength, writeRatios, alphas);
+        } else {
+            uint64_t finalObjects = 1000 * (uint64_t)cfg.read<int>("trace.finalKObjects", 10 * synth.numObjects / 1000);
+            bool newestHot = cfg.read<bool>("trace.newestHot", false);
+            return new GrowingWSSParser(synth, finalObjects, newestHot);
+        }
     } else if (parserType == "FacebookTaoSimple") {
         std::string filename1 = cfg.read<const char *>("trace.filename");
         double sampling = cfg.read<double>("trace.samplingPercent", 1);
         int seed = cfg.read<int>("trace.samplingSeed", 0);
         double scaling = cfg.read<double>("trace.objectScaling", 1);
-        return new FacebookTaoSimpleParser(filename1, numRequests, sampling, seed, scaling);
+        int parseThreads = cfg.read<int>("trace.parseThreads", 0); // >0 时使用多线程mmap分块解析
+        return new FacebookTaoSimpleParser(filename1, numRequests, sampling, seed, scaling, parseThreads);
     } else if (parserType == "MetaKV") {
         std::string filename1 = cfg.read<const char *>("trace.filename");
         double sampling = cfg.read<double>("trace.samplingPercent", 1);
         int seed = cfg.read<int>("trace.samplingSeed", 0);
         double scaling = cfg.read<double>("trace.objectScaling", 1);
-        return new MetaKVParser(filename1, numRequests, sampling, seed, scaling);
+        int parseThreads = cfg.read<int>("trace.parseThreads", 0); // >0 时使用多线程mmap分块解析
+        return new MetaKVParser(filename1, numRequests, sampling, seed, scaling, parseThreads);
     } else if (parserType == "Binary") {
         std::string filename1 = cfg.read<const char *>("trace.filename");
         double sampling = cfg.read<double>("trace.samplingPercent", 1);
@@ -50,7 +98,12 @@ parser::Parser *parser::Parser::create(const libconfig::Setting &settings) {
         double scaling = cfg.read<double>("trace.objectScaling", 1);
         std::string fmt_str = cfg.read<const char *>("trace.formatString");
         // std::string fmt_str = "IQQBQB";
-        return new BinaryParser(filename1, numRequests, fmt_str, fmt_str.length());
+        // 快进：跳过前fastForwardK千个请求，或时间戳小于fastForwardTime的请求
+        int64_t fastForward = 1024 * (int64_t)cfg.read<int>("trace.fastForwardK", FAST_FORWARD / 1024);
+        int64_t fastForwardTime = cfg.read<int>("trace.fastForwardTime", 0);
+        int decodeThreads = cfg.read<int>("trace.decodeThreads", 0); // >0 时并行解压seekable zstd负载
+        return new BinaryParser(filename1, numRequests, fmt_str, fmt_str.length(), 0,
+                                fastForward, fastForwardTime, decodeThreads);
     } else if (parserType == "BlockBinary") {
         std::string filename1 = cfg.read<const char *>("trace.filename");
         double sampling = cfg.read<double>("trace.samplingPercent", 1);
@@ -59,7 +112,17 @@ parser::Parser *parser::Parser::create(const libconfig::Setting &settings) {
         std::string fmt_str = cfg.read<const char *>("trace.formatString");
         int pageSize = cfg.read<int>("trace.pageSize");
         // std::string fmt_str = "IQQBQB";
-        return new BlockBinaryParser(filename1, pageSize, numRequests, fmt_str, fmt_str.length());
+        // 快进：跳过前fastForwardK千个请求，或时间戳小于fastForwardTime的请求
+        int64_t fastForward = 1024 * (int64_t)cfg.read<int>("trace.fastForwardK", FAST_FORWARD / 1024);
+        int64_t fastForwardTime = cfg.read<int>("trace.fastForwardTime", 0);
+        int decodeThreads = cfg.read<int>("trace.decodeThreads", 0); // >0 时并行解压seekable zstd负载
+        bool extentMode = cfg.read<bool>("trace.extentMode", false); // 每个I/O作为一个区间请求，BlockCache按区间处理
+        return new BlockBinaryParser(filename1, pageSize, numRequests, fmt_str, fmt_str.length(), 0,
+                                     fastForward, fastForwardTime, decodeThreads, extentMode);
+    } else if (parserType == "Columnar") {
+        // trace_converter生成的列式压缩负载
+        std::string filename1 = cfg.read<const char *>("trace.filename");
+        return new ColumnarParser(filename1, numRequests);
     } else {
         ERROR("Unknown parser type: %s\n", parserType.c_str());
         // std::cerr << "Unknown parser type: " << parserType << std::endl;
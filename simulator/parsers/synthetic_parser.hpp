@@ -0,0 +1,336 @@
+#pragma once
+#include <stdint.h>
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "parser.hpp"
+#include "../constants.hpp"
+#include "../lib/zipf_sampler.h"
+#include "common/hash.hpp"
+#include "common/logging.h"
+#include "common/rand.hpp"
+
+namespace parser
+{
+
+    // 所有合成负载共用的trace.*配置
+    struct SyntheticConfig
+    {
+        uint64_t numRequests;
+        float alpha;          // trace.alpha
+        uint64_t numObjects;  // trace.numKObjects * 1000
+        float writeRatio;     // trace.writeRatio
+        uint64_t seed;        // trace.zipfSeed
+        uint64_t objectSize;  // trace.objectSize
+        bool scrambleIds;     // trace.scrambleIds
+    };
+
+    /* base of the synthetic stress workloads. Each subclass decides the id
+     * and type of one request at a time in _generate(); popularity always
+     * comes from the O(1)-memory rejection-inversion Zipf sampler and all
+     * randomness from one xoshiro stream, so a (config, seed) pair always
+     * replays the same trace. Requests carry req_num from 0 and time equal
+     * to req_num. */
+    class SyntheticParser : public virtual Parser
+    {
+    public:
+        SyntheticParser(const SyntheticConfig &cfg) : cfg(cfg), rng(cfg.seed)
+        {
+            assert(cfg.numRequests > 0 && cfg.numObjects > 0);
+            tot_req = cfg.numRequests;
+        }
+
+        void go(VisitorFn visit)
+        {
+            Request req;
+            while (read_one_req(&req))
+            {
+                visit(&req);
+            }
+        }
+
+        int read_one_req(parser::Request *req)
+        {
+            if (req_num >= cfg.numRequests)
+            {
+                INFO("Finished Processing %lu Requests\n", (unsigned long)req_num);
+                return 0;
+            }
+            memset(req, 0, sizeof(Request));
+            req->req_num = req_num;
+            req->time = req_num;
+            req->req_size = cfg.objectSize;
+            _generate(req);
+            req_num++;
+            return 1;
+        }
+
+    protected:
+        // 设置req的id和type，req_num、time和req_size已经填好
+        virtual void _generate(Request *req) = 0;
+
+        // 流行度排名或LBA到对象id的映射
+        inline uint64_t _id(uint64_t rank) const
+        {
+            return cfg.scrambleIds ? scrambleZipfId(rank, cfg.seed) : rank;
+        }
+
+        inline bool _coin(double p)
+        {
+            return rng.nextDouble() < p;
+        }
+
+        // [0, n)上的均匀分布
+        inline uint64_t _uniform(uint64_t n)
+        {
+            return misc::fastRange(rng.next(), n);
+        }
+
+        inline req_op_e _op(double writeRatio)
+        {
+            return _coin(writeRatio) ? OP_SET : OP_GET;
+        }
+
+        SyntheticConfig cfg;
+        misc::Xoshiro256 rng;
+        uint64_t req_num = 0;
+    };
+
+    /* popularity churn: a Zipf over a fixed-size active set, where every
+     * request replaces a uniformly chosen active slot with a never-seen
+     * object with probability churn. A hot slot that gets replaced makes
+     * its old object cold at once and a brand new object hot. */
+    class ChurnParser : public SyntheticParser
+    {
+    public:
+        ChurnParser(const SyntheticConfig &cfg, double churn)
+            : SyntheticParser(cfg), zipf(cfg.numObjects, cfg.alpha), churn(churn), active(cfg.numObjects)
+        {
+            for (uint64_t i = 0; i < cfg.numObjects; i++)
+            {
+                active[i] = i + 1;
+            }
+            nextObject = cfg.numObjects + 1;
+            INFO("Churn: %lu active objects, churn %.4f\n", (unsigned long)cfg.numObjects, churn);
+        }
+
+    protected:
+        void _generate(Request *req)
+        {
+            if (_coin(churn))
+            {
+                active[_uniform(active.size())] = nextObject++;
+            }
+            req->id = _id(active[zipf.sample(rng) - 1]);
+            req->type = _op(cfg.writeRatio);
+        }
+
+    private:
+        RejectionInversionZipf zipf;
+        double churn;
+        std::vector<uint64_t> active; // 流行度排名到当前占据该排名的对象
+        uint64_t nextObject;
+    };
+
+    /* Zipf background traffic over LBAs 1..numObjects, interrupted by a
+     * sequential read scan of scanLength LBAs from a random start at the
+     * end of every scanPeriod requests. Ids are LBAs, so scrambleIds is
+     * ignored here to keep scans sequential. */
+    class ScanParser : public SyntheticParser
+    {
+    public:
+        ScanParser(const SyntheticConfig &cfg, uint64_t scanPeriod, uint64_t scanLength)
+            : SyntheticParser(cfg), zipf(cfg.numObjects, cfg.alpha), scanPeriod(scanPeriod),
+              scanLength(std::min(scanLength, cfg.numObjects))
+        {
+            if (scanPeriod <= this->scanLength)
+            {
+                ERROR("scan period %lu must be longer than the scan %lu\n", (unsigned long)scanPeriod,
+                      (unsigned long)this->scanLength);
+            }
+            this->cfg.scrambleIds = false;
+            INFO("Scan: %lu LBAs scanned every %lu requests\n", (unsigned long)this->scanLength,
+                 (unsigned long)scanPeriod);
+        }
+
+    protected:
+        void _generate(Request *req)
+        {
+            uint64_t pos = req_num % scanPeriod;
+            uint64_t scanBegin = scanPeriod - scanLength;
+            if (pos < scanBegin)
+            {
+                req->id = zipf.sample(rng);
+                req->type = _op(cfg.writeRatio);
+                return;
+            }
+            if (pos == scanBegin)
+            {
+                scanStart = 1 + _uniform(cfg.numObjects - scanLength + 1);
+            }
+            req->id = scanStart + pos - scanBegin;
+            req->type = OP_GET;
+        }
+
+    private:
+        RejectionInversionZipf zipf;
+        uint64_t scanPeriod;
+        uint64_t scanLength;
+        uint64_t scanStart = 1;
+    };
+
+    /* Zipf traffic with writeRatio, plus a burst of stormLength requests at
+     * the end of every stormPeriod requests that overwrites uniformly chosen
+     * objects with probability stormWriteRatio. Uniform overwrites
+     * invalidate data everywhere on flash, which is the worst case for
+     * segment GC. */
+    class WriteStormParser : public SyntheticParser
+    {
+    public:
+        WriteStormParser(const SyntheticConfig &cfg, uint64_t stormPeriod, uint64_t stormLength, double stormWriteRatio)
+            : SyntheticParser(cfg), zipf(cfg.numObjects, cfg.alpha), stormPeriod(stormPeriod),
+              stormLength(stormLength), stormWriteRatio(stormWriteRatio)
+        {
+            if (stormPeriod <= stormLength)
+            {
+                ERROR("storm period %lu must be longer than the storm %lu\n", (unsigned long)stormPeriod,
+                      (unsigned long)stormLength);
+            }
+            INFO("WriteStorm: %lu-request storms every %lu requests, storm write ratio %.2f\n",
+                 (unsigned long)stormLength, (unsigned long)stormPeriod, stormWriteRatio);
+        }
+
+    protected:
+        void _generate(Request *req)
+        {
+            if (req_num % stormPeriod < stormPeriod - stormLength)
+            {
+                req->id = _id(zipf.sample(rng));
+                req->type = _op(cfg.writeRatio);
+            }
+            else
+            {
+                req->id = _id(1 + _uniform(cfg.numObjects));
+                req->type = _op(stormWriteRatio);
+            }
+        }
+
+    private:
+        RejectionInversionZipf zipf;
+        uint64_t stormPeriod;
+        uint64_t stormLength;
+        double stormWriteRatio;
+    };
+
+    /* cycles through phases of phaseLength requests, each with its own
+     * write ratio and Zipf alpha. The lists come from comma separated
+     * strings, eg trace.phaseWriteRatios = "0.05,0.5,0.9"; a list of length
+     * one applies to every phase. */
+    class PhasesParser : public SyntheticParser
+    {
+    public:
+        PhasesParser(const SyntheticConfig &cfg, uint64_t phaseLength, const std::string &writeRatios,
+                     const std::string &alphas)
+            : SyntheticParser(cfg), phaseLength(phaseLength)
+        {
+            assert(phaseLength > 0);
+            phaseWriteRatios = _parseList(writeRatios);
+            std::vector<double> phaseAlphas = _parseList(alphas);
+            size_t numPhases = std::max(phaseWriteRatios.size(), phaseAlphas.size());
+            if ((phaseWriteRatios.size() != 1 && phaseWriteRatios.size() != numPhases) ||
+                (phaseAlphas.size() != 1 && phaseAlphas.size() != numPhases))
+            {
+                ERROR("phase lists have different lengths: \"%s\" vs \"%s\"\n", writeRatios.c_str(), alphas.c_str());
+            }
+            phaseWriteRatios.resize(numPhases, phaseWriteRatios.back());
+            phaseAlphas.resize(numPhases, phaseAlphas.back());
+            for (size_t i = 0; i < numPhases; i++)
+            {
+                zipfs.emplace_back(new RejectionInversionZipf(cfg.numObjects, phaseAlphas[i]));
+                INFO("Phase %lu: write ratio %.2f, alpha %.2f\n", (unsigned long)i, phaseWriteRatios[i], phaseAlphas[i]);
+            }
+        }
+
+    protected:
+        void _generate(Request *req)
+        {
+            size_t phase = (req_num / phaseLength) % zipfs.size();
+            req->id = _id(zipfs[phase]->sample(rng));
+            req->type = _op(phaseWriteRatios[phase]);
+        }
+
+    private:
+        static std::vector<double> _parseList(const std::string &list)
+        {
+            std::vector<double> values;
+            const char *p = list.c_str();
+            char *end;
+            while (*p != '\0')
+            {
+                values.push_back(strtod(p, &end));
+                if (end == p || (*end != ',' && *end != '\0'))
+                {
+                    ERROR("malformed phase list \"%s\"\n", list.c_str());
+                }
+                p = *end == ',' ? end + 1 : end;
+            }
+            if (values.empty())
+            {
+                ERROR("empty phase list\n");
+            }
+            return values;
+        }
+
+        uint64_t phaseLength;
+        std::vector<double> phaseWriteRatios;
+        std::vector<std::unique_ptr<RejectionInversionZipf>> zipfs;
+    };
+
+    /* Zipf whose object population grows linearly from numObjects to
+     * finalObjects over the trace. Objects created later get the coldest
+     * ranks, or the hottest ones with newestHot, which models feeds where
+     * new content draws most of the traffic. */
+    class GrowingWSSParser : public SyntheticParser
+    {
+    public:
+        GrowingWSSParser(const SyntheticConfig &cfg, uint64_t finalObjects, bool newestHot)
+            : SyntheticParser(cfg), finalObjects(std::max(finalObjects, cfg.numObjects)), newestHot(newestHot)
+        {
+            _resize();
+            INFO("GrowingWSS: %lu -> %lu objects%s\n", (unsigned long)cfg.numObjects, (unsigned long)this->finalObjects,
+                 newestHot ? ", newest objects hottest" : "");
+        }
+
+    protected:
+        void _generate(Request *req)
+        {
+            // 采样器的构造只需要几次log/exp，但也没必要每个请求都重建
+            if (req_num % SYNTHETIC_RESIZE_REQUESTS == 0)
+            {
+                _resize();
+            }
+            uint64_t rank = zipf->sample(rng);
+            req->id = _id(newestHot ? zipf->numObjects() - rank + 1 : rank);
+            req->type = _op(cfg.writeRatio);
+        }
+
+    private:
+        void _resize()
+        {
+            uint64_t n = cfg.numObjects + (uint64_t)((double)(finalObjects - cfg.numObjects) * req_num / cfg.numRequests);
+            if (!zipf || zipf->numObjects() != n)
+            {
+                zipf.reset(new RejectionInversionZipf(n, cfg.alpha));
+            }
+        }
+
+        uint64_t finalObjects;
+        bool newestHot;
+        std::unique_ptr<RejectionInversionZipf> zipf;
+    };
+
+} // namespace parser
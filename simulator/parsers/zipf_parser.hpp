@@ -6,13 +6,20 @@
 #include <unistd.h>
 
 #include <cassert>
+#include <cstring>
 #include <fstream>
 #include <iostream>
+#include <memory>
+#include <random>
 #include <string>
+#include <vector>
 
 #include "../constants.hpp"
 #include "../lib/zipf.h"
+#include "../lib/zipf_sampler.h"
 #include "common/logging.h"
+#include "common/rand.hpp"
+#include "ordered_pipeline.hpp"
 
 typedef double double64_t;
 
@@ -22,10 +29,30 @@ namespace parser
     class ZipfParser : public virtual Parser
     {
     public:
-        // 参数：alpha为zipf分布的参数，numObjects为对象数量，_numRequests为请求数量
-        ZipfParser(float alpha, uint64_t numObjects, uint64_t _numRequests, float writeRatio)
-            : zipf("", numObjects, alpha, 1), numRequests(_numRequests), writeRatio(writeRatio)
+        // 参数：alpha为zipf分布的参数，numKObjects为对象数量/K个，_numRequests为请求数量
+        /* With rejection unset this keeps the original bucketed ZipfRequests,
+         * which materializes every object up front. With rejection set,
+         * ranks come from an O(1)-memory rejection-inversion sampler and
+         * requests are generated in batches of ZIPF_BATCH_REQUESTS, each
+         * drawn from its own stream derived from (seed, batch), so the
+         * sequence is the same for any genThreads. scrambleIds spreads
+         * popular ranks over the whole id space. */
+        ZipfParser(float alpha, uint64_t numKObjects, uint64_t _numRequests, float writeRatio, bool rejection = false,
+                   bool scrambleIds = false, uint64_t seed = 0, int genThreads = 0, uint64_t objectSize = 4096)
+            : numRequests(_numRequests), writeRatio(writeRatio), scrambleIds(scrambleIds), seed(seed),
+              genThreads(genThreads), objectSize(objectSize)
         {
+            if (rejection)
+            {
+                sampler.reset(new RejectionInversionZipf(numKObjects * 1000, alpha));
+                numBatches = (numRequests + ZIPF_BATCH_REQUESTS - 1) / ZIPF_BATCH_REQUESTS;
+                INFO("rejection-inversion zipf: %lu objects, alpha %.3f, %d generator threads\n",
+                     (unsigned long)sampler->numObjects(), alpha, genThreads);
+            }
+            else
+            {
+                zipf.reset(new ZipfRequests("", numKObjects, alpha, 1));
+            }
         }
 
         void go(VisitorFn visit) // VisitorFn visit为缓存的访问函数
@@ -33,66 +60,122 @@ namespace parser
             std::cout << "go: Generating "
                       << numRequests << " requests\n";
             std::cout << "writeRatio: " << writeRatio << std::endl;
-            Request req;
-            req.type = parser::OP_GET;
-            uint64_t obj_id;
-            uint64_t obj_size;
 
-            // 随机数生成器相关成员变量
-            std::random_device rd;                          // 用于生成种子
-            std::mt19937 gen;                               // 使用 Mersenne Twister 算法的随机数生成器
-            std::uniform_real_distribution<> dis(0.0, 1.0); // 生成 0 到 1 之间的均匀分布的随机数
+            if (sampler)
+            {
+                _goBatches(visit);
+                return;
+            }
 
+            Request req;
+            memset(&req, 0, sizeof(req));
             for (uint64_t i = 0; i < numRequests; i++)
             {
-                zipf.Sample(obj_id, obj_size); // 从zipf分布中采样一个对象，返回对象ID和对象大小
-                req.id = obj_id;               // 请求id赋值为对象id
-                req.req_size = obj_size;       // 请求大小赋值为对象大小
-                req.req_num = i;               // 请求数量
+                _sampleBucket(&req);
+                req.req_num = i; // 请求数量
+                visit(&req);     // 使缓存处理当前请求
+            }
+        }
 
-                // 根据 writeRatio 随机设置 req.type
-                if (dis(gen) < writeRatio)
-                {
-                    req.type = parser::OP_SET;
-                }
-                else
+        int read_one_req(parser::Request *req)
+        {
+            if (sampler)
+            {
+                if (cursor >= batch.size())
                 {
-                    req.type = parser::OP_GET;
+                    if (nextBatch >= numBatches)
+                    {
+                        INFO("Finished Processing %lu Requests\n", (unsigned long)numRequests);
+                        return 0;
+                    }
+                    _generateBatch(nextBatch++, batch);
+                    cursor = 0;
                 }
-
-                // DEBUG("req.id:%d,req.req_size:%d,req.req_num:%d\n", req.id, req.req_size, req.req_num);
-
-                visit(&req); // 使缓存处理当前请求
+                *req = batch[cursor++];
+                return 1;
             }
+
+            _sampleBucket(req);
+            return 1;
         }
 
-        int read_one_req(parser::Request *req)
+    private:
+        // 分桶采样一个请求，根据 writeRatio 随机设置请求类型
+        void _sampleBucket(Request *req)
         {
             uint64_t obj_id;
             uint64_t obj_size;
-            zipf.Sample(obj_id, obj_size); // 从zipf分布中采样一个对象，返回对象ID和对象大小
-            req->id = obj_id;              // 请求id赋值为对象id
-            req->req_size = obj_size;      // 请求大小赋值为对象大小
-            // req->req_num = i;              // 请求数量
+            zipf->Sample(obj_id, obj_size); // 从zipf分布中采样一个对象，返回对象ID和对象大小
+            req->id = obj_id;               // 请求id赋值为对象id
+            req->req_size = obj_size;       // 请求大小赋值为对象大小
+            req->type = dis(gen) < writeRatio ? parser::OP_SET : parser::OP_GET;
+        }
 
-            std::mt19937 gen;                               // 使用 Mersenne Twister 算法的随机数生成器
-            std::uniform_real_distribution<> dis(0.0, 1.0); // 生成 0 到 1 之间的均匀分布的随机数
+        // 生成第b批请求，只依赖seed和b，可以在任意线程上执行
+        void _generateBatch(uint64_t b, std::vector<Request> &out)
+        {
+            uint64_t state = seed ^ (b * 0x9e3779b97f4a7c15ULL);
+            misc::Xoshiro256 rng(misc::splitmix64(state));
+            uint64_t begin = b * ZIPF_BATCH_REQUESTS;
+            uint64_t n = std::min<uint64_t>(ZIPF_BATCH_REQUESTS, numRequests - begin);
+            out.resize(n);
+            memset(out.data(), 0, n * sizeof(Request));
+            for (uint64_t i = 0; i < n; i++)
+            {
+                Request &req = out[i];
+                uint64_t rank = sampler->sample(rng);
+                req.id = scrambleIds ? scrambleZipfId(rank, seed) : rank;
+                req.req_size = objectSize;
+                req.req_num = begin + i;
+                req.type = rng.nextDouble() < writeRatio ? parser::OP_SET : parser::OP_GET;
+            }
+        }
 
-            // 根据 writeRatio 随机设置 req->type
-            if (dis(gen) < writeRatio)
+        void _goBatches(VisitorFn visit)
+        {
+            if (genThreads <= 0)
             {
-                req->type = parser::OP_SET;
+                std::vector<Request> reqs;
+                for (uint64_t b = 0; b < numBatches; b++)
+                {
+                    _generateBatch(b, reqs);
+                    for (auto &req : reqs)
+                    {
+                        visit(&req);
+                    }
+                }
+                return;
             }
-            else
+
+            // 生成线程并行产生批次，按批号顺序交给缓存
+            OrderedPipeline<std::vector<Request>> pipeline(numBatches, genThreads,
+                                                           [this](uint64_t b, std::vector<Request> &out)
+                                                           { _generateBatch(b, out); });
+            std::vector<Request> reqs;
+            while (pipeline.next(reqs))
             {
-                req->type = parser::OP_GET;
+                for (auto &req : reqs)
+                {
+                    visit(&req);
+                }
             }
         }
 
-    private:
-        ZipfRequests zipf;
+        std::unique_ptr<ZipfRequests> zipf;              // 分桶采样器
+        std::unique_ptr<RejectionInversionZipf> sampler; // O(1)内存的采样器
         uint64_t numRequests;
         float writeRatio;
+        bool scrambleIds;
+        uint64_t seed;
+        int genThreads;
+        uint64_t objectSize;
+
+        std::mt19937 gen;                               // 分桶采样时决定请求类型的随机数生成器
+        std::uniform_real_distribution<> dis{0.0, 1.0}; // 生成 0 到 1 之间的均匀分布的随机数
+        uint64_t numBatches = 0;
+        uint64_t nextBatch = 0; // read_one_req下一个要生成的批次
+        std::vector<Request> batch;
+        size_t cursor = 0;
     };
 
 } // namespace parser
@@ -2,6 +2,7 @@
 #include "block_gc.hpp"
 #include "stats/stats.hpp"
 #include "common/logging.h"
+#include "common/profile.hpp"
 
 namespace flashCache
 {
@@ -68,8 +69,11 @@ namespace flashCache
 
     void BlockGC::_do_gc()
     {
+        PROFILE_SCOPE(misc::PHASE_GC);
         uint64_t total_reclaimed = 0;
         std::vector<Block> rewrite_blocks;
+        uint64_t free_before = _free_segments.size();
+        std::vector<GCRecord> records; // 开启GC事件流时每个被回收段一条记录
         // DEBUG("before select: free_segments size:%lu, sealed_segments size:%lu\n", _free_segments.size(), _sealed_segments.size());
         // 选取若干个段GC，保证GC回收的空间不小于一个段的大小
         while (total_reclaimed < Segment::_capacity)
@@ -77,6 +81,10 @@ namespace flashCache
             uint32_t victim_idx = _victim_select(); // 选择一个段进行GC
             // DEBUG("victim_idx:%u\n", victim_idx);
             Segment &victim = *_segments[victim_idx];
+            if (_gc_trace)
+            {
+                records.push_back(_gcRecord(victim_idx, victim._items.size(), 0));
+            }
             uint64_t total_rewrite = 0;
             for (auto &item : victim._items)
             {
@@ -111,6 +119,16 @@ namespace flashCache
             }
             _insert(item); // 将对象插入当前开放块
         }
+        if (_gc_trace)
+        {
+            for (auto &record : records)
+            {
+                record[GC_FREE_BEFORE] = free_before;
+                record[GC_FREE_AFTER] = _free_segments.size();
+                _gc_trace->record(record.data());
+            }
+        }
+        _num_gc++;
         // print_sealed_free_segments();
         // INFO("GC finished\n");
     }
@@ -136,6 +154,7 @@ namespace flashCache
         // DEBUG("increment segment\n");
         // DEBUG("seal —— active_segment:%lu, size:%lu, capacity:%lu\n", _active_segment, _segments[_active_segment]._size, _segments[_active_segment]._capacity);
         _sealed_segments.push_back(_active_segment); // 将当前开放段标号加入已写满段列表
+        _sealSegment(*_segments[_active_segment]);
         _active_segment = _free_segments.front();    // 切换到下一个开放段
         // DEBUG("active_segment:%lu, size:%lu, capacity:%lu\n", _active_segment, _segments[_active_segment]->_size, _segments[_active_segment]->_capacity);
         _free_segments.pop_front();
@@ -163,6 +182,7 @@ namespace flashCache
                 {
                     // 先把当前开放段加入_sealed_segments中，保证所有段均在sealed_segments中
                     _sealed_segments.push_back(_active_segment);
+                    _sealSegment(*_segments[_active_segment]);
                     // print_sealed_free_segments();
                     // DEBUG("do gc\n");
                     // DEBUG("item id:%lu\n", item._lba);
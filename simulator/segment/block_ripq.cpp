@@ -161,6 +161,7 @@ namespace flashCache
         // printSegment();
         std::vector<Block> evicted;
         // DEBUG("group idx: %d, old_active_seg: %d\n", group_idx, *_group[group_idx]._active_seg);
+        _sealSegment(*_segments[*_group[group_idx]._active_seg]);
         _group[group_idx]._active_seg++;
         // 新的开放块
         if (_group[group_idx]._active_seg == _group[group_idx]._segments.end())
@@ -239,6 +240,15 @@ namespace flashCache
 
             // _log_stats["numLogFlushes"]++;
         }
+        if (_gc_trace)
+        {
+            // RIPQ没有空闲段列表，空闲段数记为-1
+            GCRecord record = _gcRecord(*_group[group_idx]._active_seg, 0, evicted.size());
+            record[GC_FREE_BEFORE] = -1;
+            record[GC_FREE_AFTER] = -1;
+            _gc_trace->record(record.data());
+        }
+        _num_gc++;
         current_segment.reset(); // 重置当前擦除块
 
         return evicted;
@@ -400,10 +410,10 @@ namespace flashCache
             std::vector<Block> local_evict = group_insert({item}, new_group);
             evicted.insert(evicted.end(), local_evict.begin(), local_evict.end());
 
-            if (_segments[vir_seg]->_items.size() != _segments[vir_seg]->_size / 4096)
+            if (_segments[vir_seg]->_items.size() != _segments[vir_seg]->_size / Block::_capacity)
             {
-                ERROR("vir_seg:%d, group:%d, items_num:%lu, size/4096:%lu\n",
-                      vir_seg, new_group, _segments[vir_seg]->_items.size(), _segments[vir_seg]->_size / 4096);
+                ERROR("vir_seg:%d, group:%d, items_num:%lu, size/capacity:%lu\n",
+                      vir_seg, new_group, _segments[vir_seg]->_items.size(), _segments[vir_seg]->_size / Block::_capacity);
             }
 
             // print_group();
@@ -454,10 +464,10 @@ namespace flashCache
                 old_seg._size -= item._capacity;
                 old_seg._items.erase(item._lba);
                 _vir_seg_map.erase(item._lba);
-                if (old_seg._items.size() != old_seg._size / 4096)
+                if (old_seg._items.size() != old_seg._size / Block::_capacity)
                 {
-                    ERROR("block id:%lu, vir_seg:%d, group:%d, items_num:%lu, size/4096:%lu\n", item._lba,
-                          vir_seg, _group_map[vir_seg], old_seg._items.size(), old_seg._size / 4096);
+                    ERROR("block id:%lu, vir_seg:%d, group:%d, items_num:%lu, size/capacity:%lu\n", item._lba,
+                          vir_seg, _group_map[vir_seg], old_seg._items.size(), old_seg._size / Block::_capacity);
                 }
 
                 // 若虚拟段为空，且其不为开放虚拟段
@@ -498,10 +508,10 @@ namespace flashCache
             // DEBUG("group[%d] open_vir_seg:%d\n\n", _group_map[it->second], _open_vir_seg[_group_map[it->second]]);
             new_group = old_group == (int)_group.size() - 1 ? old_group : old_group + 1;
             open_vir_seg = _open_vir_seg[new_group];
-            if (_segments[open_vir_seg]->_items.size() != _segments[open_vir_seg]->_size / 4096)
+            if (_segments[open_vir_seg]->_items.size() != _segments[open_vir_seg]->_size / Block::_capacity)
             {
-                ERROR("vir_seg:%d, group:%d, items_num:%lu, size/4096:%lu\n",
-                      open_vir_seg, new_group, _segments[open_vir_seg]->_items.size(), _segments[open_vir_seg]->_size / 4096);
+                ERROR("vir_seg:%d, group:%d, items_num:%lu, size/capacity:%lu\n",
+                      open_vir_seg, new_group, _segments[open_vir_seg]->_items.size(), _segments[open_vir_seg]->_size / Block::_capacity);
             }
             // DEBUG("new group:%d, open_vir_seg:%d\n", new_group, open_vir_seg);
             // 若虚拟段已满，刷新虚拟段
@@ -521,11 +531,11 @@ namespace flashCache
             // 从原虚拟段中删除
             _old_segment._size -= Block::_capacity;
             _old_segment._items.erase(id);
-            if (_old_segment._items.size() != _old_segment._size / 4096)
+            if (_old_segment._items.size() != _old_segment._size / Block::_capacity)
             {
                 DEBUG("block id:%ld, old seg idx:%d, new seg idx:%d\n", id, old_seg_idx, open_vir_seg);
-                ERROR("vir_seg:%d, group:%d, items_num:%lu, size/4096:%lu\n",
-                      open_vir_seg, new_group, _old_segment._items.size(), _old_segment._size / 4096);
+                ERROR("vir_seg:%d, group:%d, items_num:%lu, size/capacity:%lu\n",
+                      open_vir_seg, new_group, _old_segment._items.size(), _old_segment._size / Block::_capacity);
             }
             // 插入到新虚拟段
             _segments[open_vir_seg]->_items.insert({id, block});
@@ -555,10 +565,10 @@ namespace flashCache
             old_group = _group_map[_item_active[id]];
             new_group = old_group == (int)_group.size() - 1 ? old_group : old_group + 1;
             open_vir_seg = _open_vir_seg[new_group];
-            if (_segments[open_vir_seg]->_items.size() != _segments[open_vir_seg]->_size / 4096)
+            if (_segments[open_vir_seg]->_items.size() != _segments[open_vir_seg]->_size / Block::_capacity)
             {
-                ERROR("vir_seg:%d, group:%d, items_num:%lu, size/4096:%lu\n",
-                      open_vir_seg, new_group, _segments[open_vir_seg]->_items.size(), _segments[open_vir_seg]->_size / 4096);
+                ERROR("vir_seg:%d, group:%d, items_num:%lu, size/capacity:%lu\n",
+                      open_vir_seg, new_group, _segments[open_vir_seg]->_items.size(), _segments[open_vir_seg]->_size / Block::_capacity);
             }
             // 若虚拟段已满，刷新虚拟段
             if (_segments[open_vir_seg]->_size + Block::_capacity > _segments[open_vir_seg]->_capacity)
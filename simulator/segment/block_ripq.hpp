@@ -25,6 +25,12 @@ namespace flashCache
         std::vector<Block> insert(std::vector<Block> items);
         void update(std::vector<Block> items);
         void check();
+        void registerMemory(misc::MemoryAccounting &mem, const std::string &name)
+        {
+            BlockLogAbstract::registerMemory(mem, name);
+            mem.add(name + "VirSegMap", [this]() { return misc::hashTableBytes(_vir_seg_map); },
+                    [this]() { return (uint64_t)_vir_seg_map.size(); });
+        }
 
         // int64_t get_current_size();
         // int64_t get_total_size();
@@ -37,6 +43,17 @@ namespace flashCache
         void _vir_incrementSegmentAndFlush(int32_t group_idx);
         std::vector<Block> group_insert(std::vector<Block> items, int32_t group_idx);
         bool find(uint64_t id, bool updateStats = false);
+        // 命中需要提升对象所在的组，逐页调用find
+        uint64_t findRange(uint64_t lba, uint64_t count, bool updateStats, char *hit)
+        {
+            uint64_t hits = 0;
+            for (uint64_t i = 0; i < count; i++)
+            {
+                hit[i] = find(lba + i, updateStats);
+                hits += hit[i];
+            }
+            return hits;
+        }
         void _increase(Block &block);
         void _group_insert(Block &item, int group_idx);
         void print_group();
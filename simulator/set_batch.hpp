@@ -0,0 +1,108 @@
+#pragma once
+
+#include <stdint.h>
+#include <algorithm>
+#include <vector>
+#include "candidate.hpp"
+
+namespace flashCache
+{
+
+    /* stable LSD radix sort on an unsigned 64-bit key, 8 bits per pass and
+     * only as many passes as the largest key needs; already ordered input
+     * (eg a batch that was grouped upstream) is left untouched */
+    template <typename T, typename KeyFn>
+    void radixSortBy(std::vector<T> &v, std::vector<T> &scratch, KeyFn key)
+    {
+        size_t n = v.size();
+        if (n < 2)
+        {
+            return;
+        }
+        uint64_t max_key = key(v[0]);
+        bool sorted = true;
+        for (size_t i = 1; i < n; i++)
+        {
+            uint64_t k = key(v[i]);
+            sorted = sorted && key(v[i - 1]) <= k;
+            max_key = std::max(max_key, k);
+        }
+        if (sorted)
+        {
+            return;
+        }
+
+        scratch.resize(n);
+        for (int shift = 0; shift < 64 && (max_key >> shift); shift += 8)
+        {
+            size_t offsets[257] = {0};
+            for (size_t i = 0; i < n; i++)
+            {
+                offsets[((key(v[i]) >> shift) & 0xFF) + 1]++;
+            }
+            for (int b = 0; b < 256; b++)
+            {
+                offsets[b + 1] += offsets[b];
+            }
+            for (size_t i = 0; i < n; i++)
+            {
+                scratch[offsets[(key(v[i]) >> shift) & 0xFF]++] = v[i];
+            }
+            v.swap(scratch);
+        }
+    }
+
+    /* a flush batch grouped by set: items are ordered by set number (stably,
+     * so per-set insertion order is kept) and each run covers all items of
+     * one set, runs are in ascending set order */
+    struct SetBatch
+    {
+        struct Run
+        {
+            uint64_t set_num;
+            uint32_t begin;
+            uint32_t end;
+
+            uint32_t size() const { return end - begin; }
+        };
+
+        std::vector<candidate_t> items;
+        std::vector<Run> runs;
+
+        const candidate_t *begin(const Run &run) const { return items.data() + run.begin; }
+        const candidate_t *end(const Run &run) const { return items.data() + run.end; }
+
+        /* keeps items for which keep(run, item) holds, compacting items and
+         * runs in place; dropped items are appended to rejected and runs
+         * left empty are removed */
+        template <typename Pred>
+        void filter(Pred keep, std::vector<candidate_t> &rejected)
+        {
+            uint32_t out = 0;
+            size_t out_runs = 0;
+            for (size_t r = 0; r < runs.size(); r++)
+            {
+                Run run = runs[r];
+                uint32_t run_begin = out;
+                for (uint32_t i = run.begin; i < run.end; i++)
+                {
+                    if (keep(run, items[i]))
+                    {
+                        items[out++] = items[i];
+                    }
+                    else
+                    {
+                        rejected.push_back(items[i]);
+                    }
+                }
+                if (out > run_begin)
+                {
+                    runs[out_runs++] = {run.set_num, run_begin, out};
+                }
+            }
+            items.resize(out);
+            runs.resize(out_runs);
+        }
+    };
+
+} // namespace flashCache
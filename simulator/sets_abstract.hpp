@@ -1,14 +1,60 @@
 #pragma once
 
 #include <vector>
-#include <unordered_set>
 #include "candidate.hpp"
+#include "common/hash.hpp"
+#include "constants.hpp"
 #include "log_abstract.hpp"
+#include "set_batch.hpp"
 #include "stats/stats.hpp"
 
 namespace flashCache
 {
 
+    /* set numbers an item could be mapped to, deduplicated and in hash order,
+     * kept inline so lookups do not allocate */
+    struct SetNums
+    {
+        uint64_t nums[MAX_SET_CHOICES];
+        int count = 0;
+
+        const uint64_t *begin() const { return nums; }
+        const uint64_t *end() const { return nums + count; }
+        uint64_t front() const { return nums[0]; }
+
+        bool contains(uint64_t set_num) const
+        {
+            for (int i = 0; i < count; i++)
+            {
+                if (nums[i] == set_num)
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        void add(uint64_t set_num)
+        {
+            if (!contains(set_num))
+            {
+                nums[count++] = set_num;
+            }
+        }
+    };
+
+    /* num_hash_functions + 1 choices from a seeded 64-bit mixer,
+     * deterministic for a fixed SET_HASH_SEED */
+    inline SetNums calcSetNums(uint64_t id, uint64_t num_sets, int num_hash_functions)
+    {
+        SetNums possibilities;
+        for (int i = 0; i <= num_hash_functions; i++)
+        {
+            possibilities.add(misc::fastRange(misc::mix64(id, SET_HASH_SEED + i), num_sets));
+        }
+        return possibilities;
+    }
+
     class SetsAbstract
     {
 
@@ -27,13 +73,16 @@ namespace flashCache
          */
         virtual std::vector<candidate_t> insert(uint64_t set_num, std::vector<candidate_t> items) = 0;
 
+        /* same as above for a contiguous run of a grouped batch, avoids copying runs out */
+        virtual std::vector<candidate_t> insert(uint64_t set_num, const candidate_t *first, const candidate_t *last) = 0;
+
         /* returns true if the item is in sets layer */
         virtual bool find(candidate_t item) = 0;
 
         /* ----------- Useful for Admission Policies --------------- */
 
         /* returns the set numbers that item could be mapped to */
-        virtual std::unordered_set<uint64_t> findSetNums(candidate_t item) = 0;
+        virtual SetNums findSetNums(candidate_t item) = 0;
 
         /* returns ratio of total capacity used */
         virtual double ratioCapacityUsed() = 0;
@@ -41,6 +90,7 @@ namespace flashCache
         /* ----------- Other Bookeeping --------------- */
 
         virtual double calcWriteAmp() = 0;
+        virtual double calcReadAmp() = 0; // flash pages read per lookup
         virtual double ratioEvictedToCapacity() = 0;
         virtual void flushStats() = 0; // does not print update before clearing
         virtual uint64_t calcMemoryConsumption() = 0;
@@ -49,4 +99,36 @@ namespace flashCache
         virtual void enableHitDistributionOverSets() = 0;
     };
 
+    /* groups a batch by the first set each item maps to: set numbers are computed
+     * once for the whole batch and radix sorted, so later stages walk contiguous runs */
+    inline SetBatch groupBySet(SetsAbstract *sets, const std::vector<candidate_t> &items)
+    {
+        struct Keyed
+        {
+            uint64_t set_num;
+            candidate_t item;
+        };
+        std::vector<Keyed> keyed, scratch;
+        keyed.reserve(items.size());
+        for (auto &item : items)
+        {
+            keyed.push_back({sets->findSetNums(item).front(), item});
+        }
+        radixSortBy(keyed, scratch, [](const Keyed &k)
+                    { return k.set_num; });
+
+        SetBatch batch;
+        batch.items.reserve(keyed.size());
+        for (uint32_t i = 0; i < keyed.size(); i++)
+        {
+            if (batch.runs.empty() || batch.runs.back().set_num != keyed[i].set_num)
+            {
+                batch.runs.push_back({keyed[i].set_num, i, i});
+            }
+            batch.runs.back().end = i + 1;
+            batch.items.push_back(keyed[i].item);
+        }
+        return batch;
+    }
+
 } // namespace flashCache
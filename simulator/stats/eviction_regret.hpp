@@ -0,0 +1,181 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "common/hash.hpp"
+#include "common/log_bucket.hpp"
+#include "common/logging.h"
+#include "stats/stats.hpp"
+
+namespace stats
+{
+
+    /* remembers recently evicted ids to tell whether, and how soon, an
+     * eviction was regretted. Every eviction leaves a 30-bit fingerprint,
+     * its source and a timestamp in a 4-way set-associative table; when the
+     * id is requested again while its entry is still there, the distance in
+     * requests since the eviction is counted in a log-bucketed histogram of
+     * that source (same buckets as CacheAlgoAbstract::log_eviction_age_cnt).
+     * Entries pushed out of a full set are counted as "forgotten", ie not
+     * re-requested within the table's horizon. Counts go straight into the
+     * given stats collector: <source>Evictions/Regrets/Forgotten and a
+     * <source>Distance child keyed by the largest distance of each bucket.
+     * Time is the number of accessed() calls; fingerprint collisions may
+     * report a few false regrets. */
+    class EvictionRegret
+    {
+    public:
+        enum Source
+        {
+            SOURCE_SMALL_FIFO, // S3FIFO试用队列
+            SOURCE_MAIN_FIFO,  // S3FIFO主队列
+            SOURCE_CACHE_ALGO, // 其他替换算法
+            SOURCE_LOG,        // flash日志段被回收时驱逐的块
+            NUM_SOURCES
+        };
+
+        EvictionRegret(uint64_t num_entries, LocalStatsCollector &regret_stats)
+            : _num_sets(std::max<uint64_t>(num_entries / WAYS, 1)),
+              _sets(_num_sets),
+              _buckets(LOG_BASE, NUM_BUCKETS)
+        {
+            // 计数器直接累加到统计信息中，距离直方图的桶在第一次命中时才创建
+            for (int s = 0; s < NUM_SOURCES; s++)
+            {
+                std::string name = SOURCE_NAMES[s];
+                _evictions[s] = &regret_stats[name + "Evictions"];
+                _regrets[s] = &regret_stats[name + "Regrets"];
+                _forgotten[s] = &regret_stats[name + "Forgotten"];
+                _distance_stats[s] = &regret_stats.createChild(name + "Distance");
+                _hist[s].assign(_buckets.size(), nullptr);
+            }
+            INFO("Eviction regret: %lu sets x %d fingerprints, %lu bytes\n", _num_sets, WAYS,
+                 _num_sets * sizeof(Set));
+        }
+
+        inline void evicted(uint64_t id, Source source)
+        {
+            uint64_t h = misc::mix64(id, SEED);
+            Set &set = _sets[misc::fastRange(h, _num_sets)];
+            // 放到空位，否则替换最早驱逐的一项
+            int victim = 0;
+            uint32_t oldest = 0;
+            for (int w = 0; w < WAYS; w++)
+            {
+                if (set.tags[w] == 0)
+                {
+                    victim = w;
+                    break;
+                }
+                uint32_t age = _now - set.times[w];
+                if (age >= oldest)
+                {
+                    oldest = age;
+                    victim = w;
+                }
+            }
+            if (set.tags[victim] != 0)
+            {
+                (*_forgotten[set.tags[victim] >> TAG_BITS])++;
+            }
+            set.tags[victim] = _tag(h) | ((uint32_t)source << TAG_BITS);
+            set.times[victim] = _now;
+            (*_evictions[source])++;
+        }
+
+        inline void accessed(uint64_t id)
+        {
+            _now++;
+            uint64_t h = misc::mix64(id, SEED);
+            Set &set = _sets[misc::fastRange(h, _num_sets)];
+            uint32_t tag = _tag(h);
+            for (int w = 0; w < WAYS; w++)
+            {
+                if ((set.tags[w] & TAG_MASK) == tag)
+                {
+                    int source = set.tags[w] >> TAG_BITS;
+                    (*_regrets[source])++;
+                    (*_histBucket(source, _buckets.bucket(_now - set.times[w])))++;
+                    set.tags[w] = 0;
+                    return;
+                }
+            }
+        }
+
+        void print()
+        {
+            for (int s = 0; s < NUM_SOURCES; s++)
+            {
+                double evictions = *_evictions[s];
+                if (evictions > 0)
+                {
+                    INFO("Eviction regret %-9s: %ld evictions, %.4lf re-requested, %.4lf forgotten\n",
+                         SOURCE_NAMES[s], *_evictions[s], *_regrets[s] / evictions, *_forgotten[s] / evictions);
+                }
+            }
+        }
+
+        // 预热结束时清零计数，表中的驱逐记录保留
+        void flush()
+        {
+            for (int s = 0; s < NUM_SOURCES; s++)
+            {
+                *_evictions[s] = 0;
+                *_regrets[s] = 0;
+                *_forgotten[s] = 0;
+                for (int64_t *count : _hist[s])
+                {
+                    if (count != nullptr)
+                        *count = 0;
+                }
+            }
+        }
+
+    private:
+        static constexpr int WAYS = 4;
+        static constexpr double LOG_BASE = 1.08; // 与EVICTION_AGE_LOG_BASE、EVICTION_AGE_ARRAY_SZE一致
+        static constexpr int NUM_BUCKETS = 320;
+        static constexpr int TAG_BITS = 30;
+        static constexpr uint32_t TAG_MASK = (1u << TAG_BITS) - 1;
+        static constexpr uint64_t SEED = 0x9e3779b97f4a7c15ULL;
+        static constexpr const char *SOURCE_NAMES[NUM_SOURCES] = {"smallFifo", "mainFifo", "cacheAlgo", "log"};
+
+        // 高2位为驱逐来源，低30位为指纹，0表示空位
+        struct Set
+        {
+            uint32_t tags[WAYS];
+            uint32_t times[WAYS];
+        };
+
+        static inline uint32_t _tag(uint64_t h)
+        {
+            uint32_t tag = (h >> 32) & TAG_MASK;
+            return tag == 0 ? 1 : tag;
+        }
+
+        // 直方图的桶以桶中最大的距离命名
+        inline int64_t *_histBucket(int source, int bucket)
+        {
+            int64_t *&count = _hist[source][bucket];
+            if (count == nullptr)
+            {
+                count = &(*_distance_stats[source])[std::to_string(_buckets.bound(bucket))];
+            }
+            return count;
+        }
+
+        uint64_t _num_sets;
+        std::vector<Set> _sets;
+        uint32_t _now = 0; // 按32位回绕，距离小于2^32个请求时正确
+
+        misc::LogBuckets _buckets;
+        int64_t *_evictions[NUM_SOURCES];
+        int64_t *_regrets[NUM_SOURCES];
+        int64_t *_forgotten[NUM_SOURCES];
+        std::vector<int64_t *> _hist[NUM_SOURCES];
+        LocalStatsCollector *_distance_stats[NUM_SOURCES];
+    };
+
+} // namespace stats
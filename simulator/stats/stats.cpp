@@ -1,13 +1,168 @@
+#include <condition_variable>
+#include <cstring>
+#include <deque>
 #include <fstream>
 #include <iostream>
+#include <mutex>
+#include <thread>
 
 #include "lib/json.hpp"
 #include "stats.hpp"
 #include "common/logging.h"
+#include "common/profile.hpp"
+#include "constants.hpp"
 
 namespace stats
 {
 
+    /* background appender for csv/bin snapshots. Rows live in a fixed pool
+     * of STATS_WRITER_ROWS buffers: print() fills a free one and queues it,
+     * the writer thread formats it and hands it back, and print() only
+     * blocks when every buffer is still waiting to be written. */
+    class RowWriter
+    {
+    public:
+        RowWriter(std::ofstream &out, bool binary) : _out(out), _binary(binary), _rows(STATS_WRITER_ROWS)
+        {
+            for (uint64_t i = 0; i < STATS_WRITER_ROWS; i++)
+            {
+                _free.push_back(i);
+            }
+            if (_binary)
+            {
+                _out.write(STATS_BINARY_MAGIC, 8);
+            }
+            _thread = std::thread(&RowWriter::_run, this);
+        }
+
+        ~RowWriter()
+        {
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _done = true;
+            }
+            _ready.notify_one();
+            _thread.join();
+            _out.flush();
+        }
+
+        // 列发生变化，在下一行之前写入新的表头
+        void header(const std::vector<std::string> &names)
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _queue.push_back({-1, names});
+            _ready.notify_one();
+        }
+
+        // 取得一个空闲的行缓冲区
+        std::vector<int64_t> &acquire(int &slot)
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _returned.wait(lock, [this]
+                           { return !_free.empty(); });
+            slot = _free.back();
+            _free.pop_back();
+            return _rows[slot];
+        }
+
+        void submit(int slot)
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _queue.push_back({slot, {}});
+            _ready.notify_one();
+        }
+
+    private:
+        struct Item
+        {
+            int slot; // -1表示表头
+            std::vector<std::string> names;
+        };
+
+        void _run()
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            while (true)
+            {
+                _ready.wait(lock, [this]
+                            { return _done || !_queue.empty(); });
+                if (_queue.empty())
+                {
+                    return;
+                }
+                Item item = std::move(_queue.front());
+                _queue.pop_front();
+                lock.unlock();
+                if (item.slot < 0)
+                {
+                    _writeHeader(item.names);
+                }
+                else
+                {
+                    _writeRow(_rows[item.slot]);
+                }
+                lock.lock();
+                if (item.slot >= 0)
+                {
+                    _free.push_back(item.slot);
+                    _returned.notify_one();
+                }
+            }
+        }
+
+        void _writeHeader(const std::vector<std::string> &names)
+        {
+            if (!_binary)
+            {
+                for (size_t i = 0; i < names.size(); i++)
+                {
+                    _out << (i ? "," : "") << names[i];
+                }
+                _out << "\n";
+                return;
+            }
+            uint32_t n = names.size();
+            _out.put('H');
+            _out.write((const char *)&n, sizeof(n));
+            for (auto &name : names)
+            {
+                uint16_t len = name.size();
+                _out.write((const char *)&len, sizeof(len));
+                _out.write(name.data(), len);
+            }
+        }
+
+        void _writeRow(const std::vector<int64_t> &row)
+        {
+            if (!_binary)
+            {
+                char buf[24];
+                for (size_t i = 0; i < row.size(); i++)
+                {
+                    int len = snprintf(buf, sizeof(buf), i ? ",%ld" : "%ld", (long)row[i]);
+                    _out.write(buf, len);
+                }
+                _out.put('\n');
+                return;
+            }
+            uint32_t n = row.size();
+            _out.put('R');
+            _out.write((const char *)&n, sizeof(n));
+            _out.write((const char *)row.data(), n * sizeof(int64_t));
+        }
+
+        std::ofstream &_out;
+        bool _binary;
+        std::vector<std::vector<int64_t>> _rows;
+        std::vector<int> _free;
+        std::deque<Item> _queue;
+        std::mutex _mutex;
+        std::condition_variable _ready;    // 有新的行或表头
+        std::condition_variable _returned; // 有行缓冲区被写完归还
+        bool _done = false;
+        std::thread _thread;
+    };
+
     LocalStatsCollector::LocalStatsCollector(StatsCollector &parent) : _parent(parent) {}
 
     void LocalStatsCollector::addChild(std::string name, LocalStatsCollector *child)
@@ -47,15 +202,53 @@ namespace stats
         return counters[name];
     }
 
-    StatsCollector::StatsCollector(std::string output_filename)
+    uint64_t LocalStatsCollector::numCounters()
+    {
+        uint64_t n = counters.size();
+        for (const auto &child : children)
+        {
+            n += child.second->numCounters();
+        }
+        return n;
+    }
+
+    void LocalStatsCollector::collectColumns(const std::string &prefix, std::vector<std::string> &names,
+                                             std::vector<int64_t *> &values)
+    {
+        for (auto &counter : counters)
+        {
+            names.push_back(prefix + "/" + counter.first);
+            values.push_back(&counter.second);
+        }
+        // 与toJson一致，子收集器位于children下
+        for (const auto &child : children)
+        {
+            child.second->collectColumns(prefix + "/children/" + child.first, names, values);
+        }
+    }
+
+    StatsCollector::StatsCollector(std::string output_filename, std::string format)
     {
         DEBUG("Stats file at %s\n", output_filename.c_str());
         // std::cout << "Stats file at " << output_filename << std::endl;
-        _outputFile.open(output_filename);
+        if (format == "json")
+        {
+            _outputFile.open(output_filename);
+            return;
+        }
+        if (format != "csv" && format != "bin")
+        {
+            ERROR("unknown stats.format %s, expected json, csv or bin\n", format.c_str());
+        }
+        bool binary = format == "bin";
+        _outputFile.open(output_filename, binary ? std::ios::out | std::ios::binary : std::ios::out);
+        _writer.reset(new RowWriter(_outputFile, binary));
     }
 
     StatsCollector::~StatsCollector()
     {
+        // 先写完所有排队的行，再释放计数器
+        _writer.reset();
         auto itr = locals.begin();
         while (itr != locals.end())
         {
@@ -66,8 +259,45 @@ namespace stats
         _outputFile.close();
     }
 
+    void StatsCollector::_refreshColumns()
+    {
+        uint64_t n = 0;
+        for (const auto &local : locals)
+        {
+            n += local.second->numCounters();
+        }
+        // 计数器只会增加不会删除，数量不变则列不变
+        if (n == _num_counters)
+        {
+            return;
+        }
+        _num_counters = n;
+        std::vector<std::string> names;
+        _columns.clear();
+        for (const auto &local : locals)
+        {
+            local.second->collectColumns(local.first, names, _columns);
+        }
+        _writer->header(names);
+    }
+
     void StatsCollector::print()
     {
+        PROFILE_SCOPE(misc::PHASE_STATS);
+        if (_writer)
+        {
+            _refreshColumns();
+            int slot;
+            std::vector<int64_t> &row = _writer->acquire(slot);
+            row.resize(_columns.size());
+            for (size_t i = 0; i < _columns.size(); i++)
+            {
+                row[i] = *_columns[i];
+            }
+            _writer->submit(slot);
+            return;
+        }
+
         // INFO("Printing stats\n");
         json blob;
         for (const auto &local : locals)
@@ -80,6 +310,33 @@ namespace stats
         _outputFile << blob.dump(PRETTY_JSON_SPACES) << std::endl;
     }
 
+    EventStream::EventStream(std::string output_filename, const std::vector<std::string> &columns)
+        : _num_columns(columns.size())
+    {
+        DEBUG("Event stream at %s\n", output_filename.c_str());
+        _outputFile.open(output_filename, std::ios::out | std::ios::binary);
+        if (!_outputFile)
+        {
+            ERROR("cannot open %s\n", output_filename.c_str());
+        }
+        _writer.reset(new RowWriter(_outputFile, true));
+        _writer->header(columns);
+    }
+
+    EventStream::~EventStream()
+    {
+        _writer.reset();
+        _outputFile.close();
+    }
+
+    void EventStream::record(const int64_t *values)
+    {
+        int slot;
+        std::vector<int64_t> &row = _writer->acquire(slot);
+        row.assign(values, values + _num_columns);
+        _writer->submit(slot);
+    }
+
     LocalStatsCollector &StatsCollector::createLocalCollector(std::string name)
     {
         locals[name] = new LocalStatsCollector(*this);
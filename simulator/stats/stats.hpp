@@ -3,6 +3,7 @@
 #include <fstream>
 #include <memory>
 #include <unordered_map>
+#include <vector>
 
 #include "lib/json.hpp"
 
@@ -15,6 +16,7 @@ namespace stats
     using json = nlohmann::json;
 
     class StatsCollector;
+    class RowWriter;
 
     class LocalStatsCollector
     {
@@ -30,23 +32,62 @@ namespace stats
         json toJson();
 
     private:
+        // 统计当前的计数器数量（包括子收集器），用于发现新增的列
+        uint64_t numCounters();
+        // 按"名字/子名字/计数器"的路径收集所有计数器
+        void collectColumns(const std::string &prefix, std::vector<std::string> &names,
+                            std::vector<int64_t *> &values);
+
         std::unordered_map<std::string, int64_t> counters;     // 计数
         std::map<std::string, LocalStatsCollector *> children; // 存储子LocalStatsCollector的容器
         LocalStatsCollector(StatsCollector &parent);
         StatsCollector &_parent;
     };
 
+    /* collects the counters of every local collector and writes one snapshot
+     * per print(). format "json" (default) pretty-prints the whole tree to
+     * the output file synchronously, as before. "csv" and "bin" instead
+     * copy the counter values into a preallocated row, which a background
+     * thread appends to the file, so print() costs one pass over the
+     * counters. Columns are the '/'-joined JSON paths of the counters
+     * (eg "log/bytes_written", "log/children/<name>/<counter>"); when new
+     * counters appear a new header is written before the next row. See
+     * graph-scripts/logcache/stats_reader.py for the file layouts. */
     class StatsCollector
     {
     public:
-        StatsCollector(std::string output_filename);
+        StatsCollector(std::string output_filename, std::string format = "json");
         ~StatsCollector();
         LocalStatsCollector &createLocalCollector(std::string name);
         void print();
 
     private:
+        void _refreshColumns();
+
         std::ofstream _outputFile;
         std::unordered_map<std::string, LocalStatsCollector *> locals;
+
+        std::unique_ptr<RowWriter> _writer;  // 非json格式时的后台写线程
+        std::vector<int64_t *> _columns;     // 每一列对应的计数器，unordered_map的元素地址不会失效
+        uint64_t _num_counters = 0;          // 上次收集列时的计数器总数
+    };
+
+    /* appends one fixed set of int64 columns per event to its own file in
+     * the "bin" layout above (one header, then one row per record()),
+     * through the same background writer, so event traces such as the GC
+     * trace also load with stats_reader.read_stats */
+    class EventStream
+    {
+    public:
+        EventStream(std::string output_filename, const std::vector<std::string> &columns);
+        ~EventStream();
+        // values按构造时的列顺序排列
+        void record(const int64_t *values);
+
+    private:
+        std::ofstream _outputFile;
+        std::unique_ptr<RowWriter> _writer;
+        size_t _num_columns;
     };
 
 } // namespace stats